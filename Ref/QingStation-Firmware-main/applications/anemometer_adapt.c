@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <string.h>
+#include "anemometer_adapt.h"
+
+// values of the peaks from/to the reference, the positions are not changed.
+static void values_get(float v[4][PEAK_LEN], float ref[4][PEAK_LEN][2])
+{
+    for(int ch=0; ch<4; ch++)
+        for(int i=0; i<PEAK_LEN; i++)
+            v[ch][i] = ref[ch][i][1];
+}
+
+static void values_set(float ref[4][PEAK_LEN][2], float v[4][PEAK_LEN])
+{
+    for(int ch=0; ch<4; ch++)
+        for(int i=0; i<PEAK_LEN; i++)
+            ref[ch][i][1] = v[ch][i];
+}
+
+void ane_adapt_reset(ane_adapt_t *ad, ane_calib_t *calib)
+{
+    memset(ad, 0, sizeof(ane_adapt_t));
+    values_get(ad->cand, calib->ref_shape);
+    values_get(ad->backup, calib->ref_shape);
+}
+
+// the shapes of a cycle are only taken when all channels match well in calm wind.
+static bool is_acceptable(ane_ch_result_t res[4], int err, float speed)
+{
+    if(err != NORMAL || speed > ANE_ADAPT_CALM)
+        return false;
+    for(int ch=0; ch<4; ch++)
+        if(res[ch].err != NORMAL || res[ch].peak_off != 0 || res[ch].quality < ANE_ADAPT_QUALITY)
+            return false;
+    return true;
+}
+
+// update the candidate, and the mean mse of the shapes to the reference and the candidate.
+static void accept(ane_adapt_t *ad, ane_calib_t *calib, float shape[4][PEAK_LEN])
+{
+    float mse_ref = 0, mse_cand = 0;
+    int num = 0;
+    for(int ch=0; ch<4; ch++)
+    {
+        for(int i=0; i<PEAK_LEN; i++)
+        {
+            if(shape[ch][i] == 0 || calib->ref_shape[ch][i][0] == 0)
+                continue;
+            float d_ref = calib->ref_shape[ch][i][1] - shape[ch][i];
+            float d_cand = ad->cand[ch][i] - shape[ch][i];
+            mse_ref += d_ref * d_ref;
+            mse_cand += d_cand * d_cand;
+            ad->cand[ch][i] += ANE_ADAPT_RATE * (shape[ch][i] - ad->cand[ch][i]);
+            num++;
+        }
+    }
+    if(num == 0)
+        return;
+    mse_ref /= num;
+    mse_cand /= num;
+    if(ad->accepted == 0)
+    {
+        ad->mse_ref = mse_ref;
+        ad->mse_cand = mse_cand;
+    }
+    else
+    {
+        ad->mse_ref += ANE_ADAPT_RATE * (mse_ref - ad->mse_ref);
+        ad->mse_cand += ANE_ADAPT_RATE * (mse_cand - ad->mse_cand);
+    }
+    ad->accepted++;
+}
+
+int ane_adapt_update(ane_adapt_t *ad, ane_calib_t *calib, float shape[4][PEAK_LEN], ane_ch_result_t res[4],
+        int err, float speed)
+{
+    bool is_err = err != NORMAL;
+    ad->err_rate += (is_err - ad->err_rate) / ANE_ADAPT_TRIAL;
+
+    // trial of the last update, roll back as soon as it cannot pass.
+    if(ad->trial)
+    {
+        ad->trial++;
+        ad->trial_err += is_err;
+        if(ad->trial_err > (ad->err_base + ANE_ADAPT_ERR_MARGIN) * ANE_ADAPT_TRIAL)
+        {
+            values_set(calib->ref_shape, ad->backup);
+            memcpy(ad->cand, ad->backup, sizeof(ad->cand));
+            ad->accepted = 0;
+            ad->trial = 0;
+            ad->rollbacks++;
+            return ANE_ADAPT_ROLLBACK;
+        }
+        if(ad->trial > ANE_ADAPT_TRIAL)
+        {
+            ad->trial = 0;
+            ad->confirmed++;
+            return ANE_ADAPT_CONFIRMED;
+        }
+    }
+
+    if(is_acceptable(res, err, speed))
+        accept(ad, calib, shape);
+
+    // the candidate replaces the reference if it fits the recent echoes clearly better.
+    if(ad->trial == 0 && ad->accepted >= ANE_ADAPT_MIN_CYCLES && ad->mse_cand < ANE_ADAPT_GAIN * ad->mse_ref)
+    {
+        values_get(ad->backup, calib->ref_shape);
+        values_set(calib->ref_shape, ad->cand);
+        ad->err_base = ad->err_rate;
+        ad->trial = 1;
+        ad->trial_err = 0;
+        ad->accepted = 0;
+        ad->updates++;
+        return ANE_ADAPT_UPDATED;
+    }
+    return ANE_ADAPT_NONE;
+}
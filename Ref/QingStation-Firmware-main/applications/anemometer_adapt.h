@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_ADAPT_H__
+#define __ANEMOMETER_ADAPT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Background adaptation of the reference echo shape.
+// The echo of the transducers changes slowly with age, dirt and temperature, the shape matching error against
+// the calibrated shape grows until the channels are rejected. A candidate shape follows the echoes by EMA,
+// it only takes the cycles in calm wind that match well. When the candidate fits the recent echoes clearly
+// better than the reference, it replaces the reference and is on trial for a while, it is rolled back
+// if more cycles are rejected than before. The measurement does not stop, only the values of the peaks are
+// adapted, their positions stay as calibrated.
+
+#define ANE_ADAPT_RATE          (0.01f)     // EMA of the accepted shapes
+#define ANE_ADAPT_CALM          (2.0f)      // m/s, shapes are only taken under it
+#define ANE_ADAPT_QUALITY       (0.7f)      // match quality of every channel to take the shapes
+#define ANE_ADAPT_MIN_CYCLES    (300)       // accepted cycles before a candidate is tried
+#define ANE_ADAPT_GAIN          (0.8f)      // mse of the candidate to the reference must be under this to update
+#define ANE_ADAPT_TRIAL         (300)       // cycles of the trial
+#define ANE_ADAPT_ERR_MARGIN    (0.02f)     // rejected cycles allowed over the rate before the update
+
+enum {
+    ANE_ADAPT_NONE = 0,
+    ANE_ADAPT_UPDATED,      // the reference is replaced, trial starts
+    ANE_ADAPT_CONFIRMED,    // trial passed
+    ANE_ADAPT_ROLLBACK,     // trial failed, the reference before the update is restored
+};
+
+typedef struct _ane_adapt_t
+{
+    float cand[4][PEAK_LEN];    // candidate, EMA of the accepted shapes
+    float backup[4][PEAK_LEN];  // the reference before the last update
+    float mse_ref;              // mean mse of the accepted shapes to the reference
+    float mse_cand;             // and to the candidate
+    float err_rate;             // rejected cycles, EMA
+    float err_base;             // err_rate before the update
+    uint32_t accepted;          // shapes taken since the candidate restarted
+    uint32_t trial;             // cycles of the trial so far, 0 = not in trial
+    uint32_t trial_err;         // rejected cycles in the trial
+    uint32_t updates;
+    uint32_t confirmed;
+    uint32_t rollbacks;
+} ane_adapt_t;
+
+// start with the candidate from the reference in calib.
+void ane_adapt_reset(ane_adapt_t *ad, ane_calib_t *calib);
+// a finished cycle, shape is from ane_process_cycle(), speed in m/s. return ANE_ADAPT_xxx
+// calib->ref_shape is changed on ANE_ADAPT_UPDATED and ANE_ADAPT_ROLLBACK.
+int ane_adapt_update(ane_adapt_t *ad, ane_calib_t *calib, float shape[4][PEAK_LEN], ane_ch_result_t res[4],
+        int err, float speed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_ADAPT_H__ */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+#include "anemometer_burst.h"
+
+#define RING_MASK   (ANE_BURST_BUF_LEN - 1)
+
+void ane_burst_ring_reset(ane_burst_ring_t *ring)
+{
+    memset(ring, 0, sizeof(ane_burst_ring_t));
+}
+
+void ane_burst_ring_push(ane_burst_ring_t *ring, const ane_burst_sample_t *s)
+{
+    ring->buf[ring->head & RING_MASK] = *s;
+    __sync_synchronize(); // the sample is written before it is published
+    ring->head++;
+}
+
+void ane_burst_reader_init(ane_burst_ring_t *ring, ane_burst_reader_t *rd)
+{
+    rd->tail = ring->head;
+    rd->lost = 0;
+}
+
+int ane_burst_ring_read(ane_burst_ring_t *ring, ane_burst_reader_t *rd, ane_burst_sample_t *out, int max)
+{
+    uint32_t head = ring->head;
+    __sync_synchronize();
+    // the writer has lapped the reader.
+    // the slot of the sample head is the next written, it is the oldest one, so LEN-1 samples can be read.
+    if(head - rd->tail >= ANE_BURST_BUF_LEN)
+    {
+        rd->lost += head - rd->tail - ANE_BURST_BUF_LEN + 1;
+        rd->tail = head - ANE_BURST_BUF_LEN + 1;
+    }
+    int num = head - rd->tail;
+    if(num > max)
+        num = max;
+    for(int i=0; i<num; i++)
+        out[i] = ring->buf[(rd->tail + i) & RING_MASK];
+    __sync_synchronize();
+
+    // samples overwritten while copying are dropped.
+    uint32_t over = ring->head - rd->tail;
+    if(over >= ANE_BURST_BUF_LEN)
+    {
+        int bad = over - ANE_BURST_BUF_LEN + 1;
+        if(bad > num)
+            bad = num;
+        memmove(out, &out[bad], (num - bad) * sizeof(ane_burst_sample_t));
+        rd->lost += bad;
+        rd->tail += bad;
+        num -= bad;
+    }
+    rd->tail += num;
+    return num;
+}
+
+void ane_burst_init(ane_burst_t *b, int rate, uint32_t on_s, uint32_t interval_s, uint32_t now)
+{
+    memset(b, 0, sizeof(ane_burst_t));
+    if(rate < ANE_BURST_RATE_MIN || rate > ANE_BURST_RATE_MAX || interval_s == 0)
+        return;
+    b->rate = rate;
+    b->on_ms = (on_s < interval_s ? on_s : interval_s) * 1000;
+    b->interval_ms = interval_s * 1000;
+    b->start = now;
+}
+
+uint32_t ane_burst_period(ane_burst_t *b, uint32_t now, uint32_t normal_period)
+{
+    if(b->rate == 0)
+        return normal_period;
+    // a new interval.
+    if(now - b->start >= b->interval_ms)
+    {
+        b->start += (now - b->start) / b->interval_ms * b->interval_ms;
+        b->is_suspended = false;
+        b->overruns = 0;
+    }
+    b->is_active = !b->is_suspended && (now - b->start < b->on_ms);
+    return b->is_active ? 1000 / b->rate : normal_period;
+}
+
+bool ane_burst_guard(ane_burst_t *b, float cost)
+{
+    if(!b->is_active)
+        return false;
+    if(cost > b->cost_max)
+        b->cost_max = cost;
+    if(cost * 100 <= (1000.f / b->rate) * ANE_BURST_CPU_LIMIT)
+    {
+        b->overruns = 0;
+        return false;
+    }
+    if(++b->overruns < ANE_BURST_OVERRUNS)
+        return false;
+    b->is_suspended = true;
+    b->is_active = false;
+    b->fallbacks++;
+    return true;
+}
+
+int ane_burst_format(const ane_burst_sample_t *s, char *buf, int size)
+{
+    return snprintf(buf, size, "%lu,%d,%d,%u,%u", (unsigned long)s->tick, s->ns, s->ew, s->c, s->err);
+}
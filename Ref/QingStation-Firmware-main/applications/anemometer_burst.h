@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_BURST_H__
+#define __ANEMOMETER_BURST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Burst (turbulence) mode.
+// For a few seconds in every interval the anemometer measures at 4~10Hz, every cycle is a sample in a ring buffer,
+// rejected cycles included with their error, so the stream has no gap. The recorder and the uplink drain
+// the ring in blocks with their own readers, the 1Hz data pool is not involved.
+// When a cycle takes longer than the burst period allows, the burst falls back to the normal rate
+// until the next interval.
+
+#define ANE_BURST_RATE_MIN  (4)     // Hz
+#define ANE_BURST_RATE_MAX  (10)    // Hz
+#define ANE_BURST_BUF_LEN   (512)   // samples, power of 2. 51s at 10Hz
+#define ANE_BURST_CPU_LIMIT (80)    // %, of the burst period a cycle may take
+#define ANE_BURST_OVERRUNS  (5)     // consecutive cycles over the limit to fall back
+
+// a sample of the stream, 12 bytes.
+typedef struct _ane_burst_sample_t
+{
+    uint32_t tick;      // ms, start of the cycle
+    int16_t ns;         // wind, cm/s, as ane_wind_t
+    int16_t ew;
+    uint16_t c;         // sound speed, cm/s
+    uint8_t err;        // error code of the cycle, the wind is 0 if not NORMAL
+    uint8_t shots;      // captures stacked
+} ane_burst_sample_t;
+
+// single writer, each reader has its own position, and can fall behind by ANE_BURST_BUF_LEN-1 samples.
+typedef struct _ane_burst_ring_t
+{
+    ane_burst_sample_t buf[ANE_BURST_BUF_LEN];
+    volatile uint32_t head;     // samples written so far
+} ane_burst_ring_t;
+
+typedef struct _ane_burst_reader_t
+{
+    uint32_t tail;      // samples read so far
+    uint32_t lost;      // samples overwritten before they were read
+} ane_burst_reader_t;
+
+typedef struct _ane_burst_t
+{
+    uint8_t rate;           // Hz, 0 = off
+    uint32_t on_ms;         // burst length in every interval
+    uint32_t interval_ms;
+    uint32_t start;         // tick the current interval started
+    bool is_active;
+    bool is_suspended;      // fell back, until the next interval
+    uint8_t overruns;       // consecutive cycles over the cpu limit
+    uint32_t fallbacks;
+    uint32_t samples;
+    float cost_max;         // ms, the longest cycle in burst
+} ane_burst_t;
+
+void ane_burst_ring_reset(ane_burst_ring_t *ring);
+void ane_burst_ring_push(ane_burst_ring_t *ring, const ane_burst_sample_t *s);
+// the reader starts from the newest sample.
+void ane_burst_reader_init(ane_burst_ring_t *ring, ane_burst_reader_t *rd);
+// copy up to max samples, oldest first. return the number of samples.
+int ane_burst_ring_read(ane_burst_ring_t *ring, ane_burst_reader_t *rd, ane_burst_sample_t *out, int max);
+
+// on_s seconds of burst in every interval_s seconds, the duty cycle is limited to on_s <= interval_s.
+// rate out of 4~10Hz or interval_s = 0 disable the burst.
+void ane_burst_init(ane_burst_t *b, int rate, uint32_t on_s, uint32_t interval_s, uint32_t now);
+// period of the next cycle, ms.
+uint32_t ane_burst_period(ane_burst_t *b, uint32_t now, uint32_t normal_period);
+// run time of the last burst cycle, ms. return true if the burst falls back.
+bool ane_burst_guard(ane_burst_t *b, float cost);
+// a sample as ANE_BURST_HEADER, in integers (cm/s) so it does not need the float printf. return the length.
+#define ANE_BURST_HEADER    "tick,ns,ew,c,err"
+int ane_burst_format(const ane_burst_sample_t *s, char *buf, int size);
+
+// stream of the anemometer, in anemometer.c
+extern ane_burst_ring_t ane_burst_ring;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_BURST_H__ */
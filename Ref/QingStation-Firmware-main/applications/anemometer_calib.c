@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "stddef.h"
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_calib.h"
+
+uint32_t ane_crc32(uint32_t crc, const void *data, uint32_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *p++;
+        for(int i=0; i<8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+void ane_calib_pack(ane_calib_blob_t *blob, const ane_calib_t *calib, const ane_filter_t *flt,
+        const ane_geometry_t *geo, float temperature)
+{
+    memset(blob, 0, sizeof(ane_calib_blob_t));
+    blob->magic = ANE_CALIB_MAGIC;
+    blob->version = ANE_CALIB_VERSION;
+    blob->size = sizeof(ane_calib_blob_t);
+    blob->filter_type = flt->type;
+    blob->filter_order = flt->sections;
+    blob->pulse_len = pulse_len;
+    blob->height = geo->height;
+    blob->pitch = geo->pitch;
+    blob->temperature = temperature;
+    memcpy(&blob->calib, calib, sizeof(ane_calib_t));
+    blob->crc = ane_crc32(0, blob, offsetof(ane_calib_blob_t, crc));
+}
+
+int ane_calib_check(const ane_calib_blob_t *blob, const ane_filter_t *flt, const ane_geometry_t *geo)
+{
+    if(blob->magic != ANE_CALIB_MAGIC || blob->version != ANE_CALIB_VERSION || blob->size != sizeof(ane_calib_blob_t))
+        return ANE_CALIB_ERR_FORMAT;
+    if(blob->crc != ane_crc32(0, blob, offsetof(ane_calib_blob_t, crc)))
+        return ANE_CALIB_ERR_CRC;
+    if(blob->filter_type != flt->type || blob->filter_order != flt->sections || blob->pulse_len != pulse_len ||
+       blob->height != geo->height || blob->pitch != geo->pitch)
+        return ANE_CALIB_ERR_SETUP;
+    return ANE_CALIB_OK;
+}
+
+int ane_calib_validate(ane_calib_t *calib, ane_geometry_t *geo, float est_c, uint16_t adc[][ADC_SAMPLE_LEN], int cycles)
+{
+    ane_baseline_t baseline[4] = {0};
+    ane_ch_result_t res[4];
+    ane_wind_t wind;
+    float sig_level[4];
+    float mse_history[4] = {0};
+    float dt[4];
+    float T = ane_propagation_time(geo, est_c);
+    int pass = 0;
+
+    for(int i=0; i<cycles; i++)
+    {
+        ane_measure_cycle(adc, baseline, sig_level);
+        if(ane_process_cycle(adc, sig_level, calib, NULL, mse_history, res, NULL) != NORMAL)
+            continue;
+        for(int ch=0; ch<4; ch++)
+            dt[ch] = res[ch].dt;
+        if(ane_wind_from_dt(geo, dt, T, &wind) != NORMAL)
+            continue;
+        if(fabsf(wind.c - est_c) > ANE_CALIB_CHECK_C_TOL)
+            continue;
+        pass++;
+    }
+    return pass;
+}
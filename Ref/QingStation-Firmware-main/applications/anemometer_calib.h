@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_CALIB_H__
+#define __ANEMOMETER_CALIB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Stored calibration.
+// The calibration is saved as a binary blob after a full calibration. On boot the blob is checked,
+// then validated with a few measurements, the full calibration is only done when it does not match any more.
+#define ANE_CALIB_FILE          "/ane_calib.bin"
+#define ANE_CALIB_MAGIC         (0x43454E41)    // "ANEC"
+#define ANE_CALIB_VERSION       (1)             // increase when ane_calib_t or the signal processing changes.
+
+#define ANE_CALIB_CHECK_CYCLES  (8)     // measurements to validate a stored calibration
+#define ANE_CALIB_CHECK_PASS    (6)     // measurements must pass
+#define ANE_CALIB_CHECK_C_TOL   (8.0f)  // m/s, sound speed vs temperature. half period slip of the zero crossings is ~15m/s
+
+typedef struct _ane_calib_blob_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;          // size of the blob
+    uint8_t  filter_type;   // setup of the calibration, the blob is invalid when any of them is changed.
+    uint8_t  filter_order;
+    uint16_t pulse_len;
+    float    height;
+    float    pitch;
+    float    temperature;   // air temperature when calibrated
+    ane_calib_t calib;
+    uint32_t crc;           // crc32 of all above
+} ane_calib_blob_t;
+
+enum {
+    ANE_CALIB_OK = 0,
+    ANE_CALIB_ERR_FORMAT = -1,  // magic, version or size
+    ANE_CALIB_ERR_CRC = -2,
+    ANE_CALIB_ERR_SETUP = -3,   // filter, pulse or geometry changed
+};
+
+// crc32 (IEEE 802.3), crc = 0 to start.
+uint32_t ane_crc32(uint32_t crc, const void *data, uint32_t len);
+
+void ane_calib_pack(ane_calib_blob_t *blob, const ane_calib_t *calib, const ane_filter_t *flt,
+        const ane_geometry_t *geo, float temperature);
+// return ANE_CALIB_OK if the blob is intact and made with the same setup.
+int ane_calib_check(const ane_calib_blob_t *blob, const ane_filter_t *flt, const ane_geometry_t *geo);
+
+// measure and process a few cycles with the calibration, est_c = speed of sound from temperature.
+// a cycle passes when all channels match the shape and the sound speed agrees with the temperature.
+// return the number of cycles passed.
+int ane_calib_validate(ane_calib_t *calib, ane_geometry_t *geo, float est_c, uint16_t adc[][ADC_SAMPLE_LEN], int cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_CALIB_H__ */
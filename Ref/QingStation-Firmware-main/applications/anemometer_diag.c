@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <string.h>
+#include <math.h>
+#include "anemometer_diag.h"
+
+void ane_diag_reset(ane_diag_t *d)
+{
+    memset(d, 0, sizeof(ane_diag_t));
+}
+
+static float ema(float avg, float x, float alpha, bool is_first)
+{
+    return is_first ? x : avg + alpha * (x - avg);
+}
+
+// peak of the echo in the window, and the rms noise of quiet samples.
+// the noise is taken after the deadzone, where the transducers stopped ringing, and before the echo window,
+// or at the end of the capture if the window starts too close to the deadzone.
+static void signal_level(uint16_t *raw, float zero, int start, int len, float *amp, float *noise)
+{
+    int32_t sum = 0;
+    float mean, var = 0, peak = 0;
+    if(start < DEADZONE_OFFSET || len <= 0 || start + len > ADC_SAMPLE_LEN)
+    {
+        start = DEADZONE_OFFSET;
+        len = VALID_LEN;
+    }
+
+    // 2 passes, the variance of 12bit samples on a ~2048 offset cancels out in float with 1 pass.
+    int quiet = start >= DEADZONE_OFFSET + BASELINE_LEN ? DEADZONE_OFFSET : ADC_SAMPLE_LEN - BASELINE_LEN;
+    for(int i=quiet; i<quiet + BASELINE_LEN; i++)
+        sum += raw[i];
+    mean = (float)sum / BASELINE_LEN;
+    for(int i=quiet; i<quiet + BASELINE_LEN; i++)
+        var += (raw[i] - mean) * (raw[i] - mean);
+    var /= BASELINE_LEN;
+    *noise = var > ANE_DIAG_NOISE_MIN * ANE_DIAG_NOISE_MIN ? sqrtf(var) : ANE_DIAG_NOISE_MIN;
+
+    for(int i=start; i<start + len; i++)
+        peak = MAX(peak, fabsf(raw[i] - zero));
+    *amp = peak;
+}
+
+void ane_diag_signal(ane_diag_t *d, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], int win[4][2],
+        ane_ch_result_t res[4])
+{
+    bool is_first = d->signals == 0;
+    for(int ch=0; ch<4; ch++)
+    {
+        float amp, noise;
+        signal_level(adc[ch], sig_level[ch], win[ch][0], win[ch][1], &amp, &noise);
+        d->amp[ch] = ema(d->amp[ch], amp, ANE_DIAG_EMA, is_first);
+        d->snr[ch] = ema(d->snr[ch], 20 * log10f(MAX(amp, ANE_DIAG_NOISE_MIN) / noise), ANE_DIAG_EMA, is_first);
+        // the shape is not matched if the echo is not found, the amplitude and snr tell why.
+        float mse = res[ch].mse[res[ch].mini_mse];
+        if(res[ch].dt != 0 && !isnan(mse))
+        {
+            d->mse[ch] = ema(d->mse[ch], mse, ANE_DIAG_EMA, d->mse[ch] == 0);
+            d->peak_off[ch] = res[ch].peak_off;
+        }
+    }
+    d->signals++;
+}
+
+void ane_diag_cycle(ane_diag_t *d, int err, bool is_retry)
+{
+    bool is_first = d->cycles == 0;
+    if(err < 0 || err >= ERR_CODE_NUM)
+        return;
+    d->cycles++;
+    d->err[err]++;
+    for(int i=0; i<ERR_CODE_NUM; i++)
+        d->err_rate[i] = ema(d->err_rate[i], i == err, ANE_DIAG_RATE_EMA, is_first);
+    if(is_retry)
+        d->retries++;
+    d->retry_rate = ema(d->retry_rate, is_retry, ANE_DIAG_RATE_EMA, is_first);
+}
+
+// 4 buckets per octave, the 2 bits below the leading one select the bucket in the octave.
+static int bucket_of(uint32_t us)
+{
+    int msb = 0;
+    if(us < 4)
+        return us;
+    while(us >> (msb + 1))
+        msb++;
+    return msb * 4 + ((us >> (msb - 2)) & 3);
+}
+
+static uint32_t bucket_upper(int b)
+{
+    if(b < 4)
+        return b;
+    int msb = b / 4;
+    uint64_t upper = ((uint64_t)(4 + (b & 3) + 1) << (msb - 2)) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : upper;
+}
+
+void ane_diag_cost(ane_diag_t *d, uint32_t us)
+{
+    // halve the old samples, the percentiles follow the recent processing time.
+    if(d->hist_num >= ANE_DIAG_HIST_MAX)
+    {
+        d->hist_num = 0;
+        for(int i=0; i<ANE_DIAG_HIST_LEN; i++)
+        {
+            d->hist[i] /= 2;
+            d->hist_num += d->hist[i];
+        }
+    }
+    d->hist[bucket_of(us)]++;
+    d->hist_num++;
+    d->cost_max = MAX(d->cost_max, us);
+}
+
+uint32_t ane_diag_percentile(ane_diag_t *d, float p)
+{
+    uint32_t sum = 0;
+    uint32_t target = ceilf(p * d->hist_num);
+    if(d->hist_num == 0)
+        return 0;
+    target = MIN(MAX(target, 1), d->hist_num);
+    for(int i=0; i<ANE_DIAG_HIST_LEN; i++)
+    {
+        sum += d->hist[i];
+        if(sum >= target)
+            return MIN(bucket_upper(i), d->cost_max);
+    }
+    return d->cost_max;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_DIAG_H__
+#define __ANEMOMETER_DIAG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Signal quality and error telemetry of the wind pipeline.
+// Cheap enough to run on every cycle: the echo amplitude and the noise are taken from the samples the DSP reads
+// anyway, the values are averaged by EMA and the processing time goes to a histogram of fixed buckets,
+// the percentiles are only searched when they are read.
+// A fouled or wet transducer shows as a falling amplitude and SNR on its channels, a worn one as a rising MSE.
+
+#define ANE_DIAG_EMA        (0.05f)     // signal quality, ~20 cycles
+#define ANE_DIAG_RATE_EMA   (0.01f)     // error and retry rates, ~100 cycles
+#define ANE_DIAG_NOISE_MIN  (0.29f)     // LSB, the quantisation noise, 1/sqrt(12)
+#define ANE_DIAG_HIST_LEN   (128)       // 4 buckets per octave of us, up to 2^32us
+#define ANE_DIAG_HIST_MAX   (4096)      // samples in the histogram before it is halved, keeps it recent
+
+typedef struct _ane_diag_t
+{
+    // per channel
+    float snr[4];           // dB, echo peak over the rms noise out of the echo
+    float amp[4];           // ADC LSB, echo peak from the zero level
+    float mse[4];           // shape matching error of the best match
+    int   peak_off[4];      // last offset of the main peak found by shape matching
+    uint32_t signals;       // cycles the signal quality is updated with
+
+    // per cycle
+    uint32_t cycles;        // cycles finished, retries included
+    uint32_t retries;
+    uint32_t err[ERR_CODE_NUM];     // cycles ended by each error code
+    float err_rate[ERR_CODE_NUM];   // 0~1 of the cycles
+    float retry_rate;       // 0~1 of the cycles are a retry
+
+    // processing time
+    uint16_t hist[ANE_DIAG_HIST_LEN];
+    uint32_t hist_num;
+    uint32_t cost_max;      // us
+} ane_diag_t;
+
+void ane_diag_reset(ane_diag_t *d);
+// update the signal quality with the captures and results of a cycle, win is the processed window of each channel.
+void ane_diag_signal(ane_diag_t *d, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], int win[4][2],
+        ane_ch_result_t res[4]);
+// a cycle finished with err, is_retry if it is a measurement again of a rejected one.
+void ane_diag_cycle(ane_diag_t *d, int err, bool is_retry);
+// the processing time of a cycle, in us.
+void ane_diag_cost(ane_diag_t *d, uint32_t us);
+// the processing time of the p (0~1) percentile, in us. the upper edge of the bucket, within 19%, not over the max.
+uint32_t ane_diag_percentile(ane_diag_t *d, float p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_DIAG_H__ */
@@ -0,0 +1,988 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2021-02-06     Jianjia Ma       the first version
+ * 2026-10-16     Jianjia Ma       split from anemometer.c
+ */
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_extract.h"
+
+// pulse generation/modulation, pulse are pwm with 0~99 = 0%~100%
+#define H 98
+#define L 0
+#define X 49
+
+#define P H,L
+#define N L,H
+
+// Double rate (80k), to control the +1 or −1 phase
+// this is a bit tricky -- this is the only way to make it work.
+// STM32's timer seems to require the first cycle not to be 100% width.
+// So there is a dummy 'L' in each pulse, as well as a dummy 'L' in each end if the end is not L.
+// A '+' is 'H, L', A '-' is 'L, H', phase of 40Khz
+// M = modulation frequency
+// B = barker code type
+
+
+const uint16_t cpulse[] = {P,P,P,P,P,P,N,N,N};
+//const uint16_t cpulse[] = {P,P,P,P,P,P,N,N,N,N,P,P,N};
+//const uint16_t cpulse[] = {P,P,P,P,P,P,P,N,N,L,X,L,X,L,X,L};
+
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, H, L, H, L, H, L, H, L, L, X, L, X, L, X, L, X, L, X, L}; // xx++++++---
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, H, L, H, L, H, H, L, H, L, H, L, H, H, L, H, L, L, H}; // ++++++---++-+
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, H, L, H, H, L, H, L, H, L, H, H, L, H, L, L, H}; // +++++---++-+
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, H, L, H, H, L, H, L, H, L, H, H, L, H, L}; // +++++---++ // best for single peak method
+
+
+//const uint16_t cpulse[] = {L, H, L,  H, L, L, H, L, H, H, L, H, L, H, L, H, L}; // 1011 M20
+//const uint16_t cpulse[] = {L, H, L, H, L, L, H, L, H, L, H, L, H, L, L, H, L, H, L}; // ++----++// B2, M:10k
+//const uint16_t cpulse[] = {L, H, L, H, L, L, H, L, H, L, H, L, H, L, L, H, L, H, L, H, L, H, L, L, H, L, H, L}; // ++--++----++ B3, M10k
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, H, L};                   // normal -> ++++
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, L, H, L, H, L};          // +++--
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, L, H, L, H, L, H, L};    // +++---
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, H, L, H, H, L, H, L, H, L, H, L}; // +++++---
+//const uint16_t cpulse[] = {L, H, L, H, L, L, H, H, L};                   // ++-+ B4.1, M40k
+//const uint16_t cpulse[] = {L, H, L, L, H, H, L, L, H, L, H, H, L, H, L, L, H, L}; // +-+--++- B4.1 M20k
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, L, H, L};                // +++- B4.2 M40k
+//const uint16_t cpulse[] = {L, H, L, H, L, H, L, L, H, L, H,  H, L, L, H, L}; // barker-code 7 -> +++--+-
+const uint32_t pulse_len = sizeof(cpulse) / sizeof(uint16_t);
+
+// names of ULTRASONIC_CHANNEL
+const char ane_ch_names[][2] = {
+    "N",
+    "E",
+    "S",
+    "W"
+};
+
+#define IS_SIGN_DIFF(a, b) (!(signbit(a) == signbit(b))) // this cover 0, but have fixed width
+
+// filters
+#define COEFF_40K_2K_BP_1ORDER {{0.0124111,1.0},{0.0,-1.9132751},{-0.0124111,0.9751779}}
+#define COEFF_40K_2K_BP_2ORDER {{0.0001551,1.0},{0.0,-3.840213},{-0.0003103,5.6515555},{0.0,-3.7725641},{0.0001551,0.9650812}}
+#define COEFF_40K_2K_BP_3ORDER {{1.9e-06,1.0},{0.0,-5.763269},{-5.8e-06,14.02188},{0.0,-18.4249013},{5.8e-06,13.7888872},{0.0,-5.5733324},{-1.9e-06,0.9509757}}
+
+#define COEFF_40K_10K_BP_1ORDER {{0.0304687,1.0},{0.0,-1.8790705},{-0.0304687,0.9390625}}
+#define COEFF_40K_10K_BP_2ORDER {{0.0009447,1.0},{0.0,-3.7901898},{-0.0018894,5.504279},{0.0,-3.6254026},{0.0009447,0.9149758}}
+#define COEFF_40K_10K_BP_3ORDER {{2.91e-05,1.0},{0.0,-5.6926121},{-8.74e-05,13.6786558},{0.0,-17.7500413},{8.74e-05,13.1173539},{0.0,-5.2350269},{-2.91e-05,0.8818931}}
+
+const float bp_coeff[][2] = COEFF_40K_10K_BP_1ORDER;
+const int   bp_coeff_order = sizeof(bp_coeff)/2/sizeof(float)/2;
+
+const char *ane_stage_names[ANE_STAGE_NUM] = {
+        "extract",
+        "peaks",
+        "match",
+        "zerocross"
+};
+
+#ifdef ANE_DSP_PROFILE
+ane_dsp_prof_t ane_dsp_prof;
+static void prof_stage(int stage, uint32_t *t)
+{
+    uint32_t now = ane_dsp_cycle_get();
+    uint32_t cost = now - *t;
+    ane_dsp_prof.total[stage] += cost;
+    ane_dsp_prof.max[stage] = MAX(ane_dsp_prof.max[stage], cost);
+    ane_dsp_prof.count[stage]++;
+    *t = ane_dsp_cycle_get(); // exclude the profiler itself
+}
+#define PROF_START(t)           uint32_t t = ane_dsp_cycle_get()
+#define PROF_STAGE(t, stage)    prof_stage(stage, &t)
+#else
+#define PROF_START(t)
+#define PROF_STAGE(t, stage)
+#endif
+
+// return offset
+uint32_t match_filter(float* signal, uint32_t signal_len, float* pattern, uint32_t pattern_len, float* output)
+{
+   float max = 0;
+   float sum = 0;
+   uint32_t idx = 0;
+   for(uint32_t i=0; i<signal_len-pattern_len; i++)
+   {
+       for(uint32_t j=0; j<pattern_len; j++)
+           sum += pattern[j] * signal[i+j];
+       if(output)
+           output[i] = sum;
+       if(sum > max)
+       {
+           max = sum;
+           idx = i;
+       }
+       sum = 0;
+   }
+   return idx;
+}
+
+float maxf(float* sig, int len)
+{
+    float max = sig[0];
+    for(int i=1; i<len; i++)
+        max = MAX(sig[i], max);
+    return max;
+}
+
+// find the max index
+int32_t argmaxf(float* sig, int32_t len)
+{
+    float max = sig[0];
+    uint32_t arg = 0;
+
+    for(uint32_t i=0; i<len; i++)
+    {
+        if(sig[i] > max)
+        {
+            arg = i;
+            max = sig[i];
+        }
+    }
+    return arg;
+}
+
+float minf(float* sig, int len)
+{
+    float min = sig[0];
+    for(int i=1; i<len; i++)
+        min = MIN(sig[i], min);
+    return min;
+}
+
+int arg_minf(float* sig, int len)
+{
+    float min = sig[0];
+    int arg = 0;
+    for(uint32_t i=0; i<len; i++){
+        if(sig[i] < min){
+            arg = i;
+            min = sig[i];
+        }
+    }
+    return arg;
+}
+
+// to normalize the signal to -1 ~1
+void normalize(float* pattern, uint32_t len)
+{
+    float max = 0;
+    for(int i=0; i<len; i++)
+        max = MAX(abs(pattern[i]), max);
+    for(int i=0; i<len; i++)
+        pattern[i] = pattern[i] / max;
+}
+
+
+// insert sort
+static void sort(float arr[], uint32_t len)
+{
+    uint32_t i,j;
+    for (i=1; i<len;i++)
+    {
+        float temp = arr[i];
+        for (j=i; j>0 && arr[j-1]>temp; j--)
+            arr[j] = arr[j-1];
+        arr[j] = temp;
+    }
+}
+
+// trimmed mean of the quiet samples, the upper and lower quarters are dropped.
+float baseline_estimate(uint16_t *raw)
+{
+    float buf[BASELINE_LEN];
+    float sum = 0;
+    for(int i=0; i<BASELINE_LEN; i++)
+        buf[i] = raw[BASELINE_START + i];
+    sort(buf, BASELINE_LEN);
+    for(int i=BASELINE_LEN/4; i<BASELINE_LEN - BASELINE_LEN/4; i++)
+        sum += buf[i];
+    return sum / (BASELINE_LEN - BASELINE_LEN/4*2);
+}
+
+bool baseline_need_anchor(ane_baseline_t *bl)
+{
+    if(!bl->is_valid || bl->age >= BASELINE_MAX_AGE)
+        return true;
+    // a sudden change that last for a few cycles
+    if(bl->outliers >= 3)
+        return true;
+    // slowly drifting away from the last pulse-less capture
+    if(fabs(bl->level - bl->anchor_level) > BASELINE_TOLERANCE)
+        return true;
+    return false;
+}
+
+void baseline_anchor(ane_baseline_t *bl, float no_pulse_level, uint16_t *raw)
+{
+    bl->level = baseline_estimate(raw);
+    bl->anchor_level = bl->level;
+    bl->bias = no_pulse_level - bl->level;
+    bl->age = 0;
+    bl->outliers = 0;
+    bl->is_valid = true;
+}
+
+float baseline_update(ane_baseline_t *bl, uint16_t *raw)
+{
+    float est = baseline_estimate(raw);
+    bl->age++;
+    if(fabs(est - bl->level) > BASELINE_TOLERANCE)
+    {
+        // do not follow a single outlier, it is normally an interference.
+        bl->outliers++;
+    }
+    else
+    {
+        bl->outliers = 0;
+        bl->level = 0.9f*bl->level + 0.1f*est;
+    }
+    return bl->level + bl->bias;
+}
+
+// find the exact interpolation
+// output the offset of the signal in sub-digit resolution.
+int linear_interpolation_zerocrossing(float* sig, uint32_t sig_len, float* out, uint32_t num_zero_cross)
+{
+    #define IS_SIGN_DIFF_NO_ZERO(a, b) (a*b<0)
+    uint32_t cross = 0;
+    for(uint32_t i=0; i<sig_len-1 && cross<num_zero_cross; i++)
+    {
+        if(sig[i] == 0) // in case there is a zero.
+        {
+            out[cross] = i;
+            cross++;
+        }
+        else if(IS_SIGN_DIFF_NO_ZERO(sig[i], sig[i+1]))
+        {
+            // do interpolation using y=ax+b
+            float a = sig[i+1] - sig[i];    // a=(y2 - y1)/(x2 - x1) while x2 - x1 = 1
+            float b = sig[i];               // b=y1
+            float x = -b/a;                 // x=(y-b)/a zero crossing.
+            out[cross] = x + i;
+            // cross
+            cross++;
+        }
+    }
+    return  cross;
+}
+
+// input the calibration signal (sampled when no signal)
+float get_zero_level(uint16_t* raw, uint32_t len)
+{
+    float sum = 0;
+    for(uint32_t i=0; i<len; i++)
+        sum += raw[i];
+    return sum/len;
+}
+
+int find_next_turning(float *sig, int len)
+{
+    float pre_dt = sig[3]-sig[2]; // jump the first point for better stability
+    float dt = 0;
+    for(int i=3; i<len-1; i++)
+    {
+        dt = sig[i+1] - sig[i];
+        if(IS_SIGN_DIFF(pre_dt, dt))
+            return i;
+        pre_dt = dt;
+    }
+    return 0;
+}
+
+int find_prev_turning(float *sig, int len)
+{
+    float *p = sig;
+    float pre_dt = *(p-2) - *(p-3);
+    float dt = 0;
+    for(int i=3; i<len-1; i++)
+    {
+        dt = *(p-i) - *(p-i-1);
+        if(IS_SIGN_DIFF(pre_dt, dt))
+            return -i;
+        pre_dt = dt;
+    }
+    return 0;
+}
+
+
+int capture_peaks_from(float* sig, int sig_len, float peaks[][2], int peak_len, float threshold)
+{
+    int peak_detected_len = 0;
+    int max_idx = argmaxf(sig, sig_len); // this is the middle peak (main).
+    int prev_peak = -MINI_PEAK_DISTANCE; // the first peak is always taken
+    int max_distance_right = 25 * (peak_len +2);
+    threshold = sig[max_idx] * threshold;
+
+    int sig_idx =0;
+    for(int i=0; i<peak_len; i++)
+    {
+       int turning_idx = find_next_turning(&sig[sig_idx], sig_len - sig_idx);
+       if(turning_idx == 0)
+           break;
+       sig_idx += turning_idx;
+       if(sig_idx > sig_len || sig_idx - max_idx > max_distance_right) // max searching distance
+           break;
+
+       if(fabs(sig[sig_idx]) >= threshold && fabs(prev_peak - sig_idx) >= MINI_PEAK_DISTANCE)
+       {
+           peaks[i][0] = sig_idx;
+           peaks[i][1] = sig[sig_idx];
+           peak_detected_len ++;
+           prev_peak = sig_idx;
+       }
+    }
+
+    return peak_detected_len;
+}
+
+// capture a few peak moment around the peak points
+// buffer size should equal to (peak_left_len + 1 + peak_right_len)
+// buffer is stored in peaks[][0] = index, peaks[][1] = value.
+int capture_peaks(float* sig, int sig_len, float peaks[][2], int peak_left_len, int peak_right_len, float threshold)
+{
+    int peak_detected_len = 0;
+    int max_idx = argmaxf(sig, sig_len); // this is the middle peak (main).
+    int peak_idx;
+    int prev_peak;
+    int max_distance_left = 25 * (peak_left_len +2);
+    int max_distance_right = 25 * (peak_right_len +2);
+    threshold = sig[max_idx] * threshold;
+
+    // main peak
+    peak_idx = peak_left_len;
+    peaks[peak_idx][0] = max_idx;
+    peaks[peak_idx][1] = sig[max_idx];
+    peak_detected_len ++;
+
+    // scan for the peak after max. (right)
+    int sig_idx = max_idx;          // signal start form the right of main peak.
+    peak_idx = peak_left_len + 1;  // start from the right of main peak.
+    prev_peak = 0;
+    for(int i=0; i<peak_right_len; i++)
+    {
+       int turning_idx = find_next_turning(&sig[sig_idx], sig_len - sig_idx);
+       if(turning_idx == 0)
+           break;
+       sig_idx += turning_idx;
+       if(sig_idx > sig_len || sig_idx - max_idx > max_distance_right) // max searching distance
+           break;
+
+       if(fabs(sig[sig_idx]) >= threshold && fabs(prev_peak - sig_idx) >= MINI_PEAK_DISTANCE)
+       {
+           peaks[peak_idx][0] = sig_idx;
+           peaks[peak_idx][1] = sig[sig_idx];
+           peak_idx ++;
+           peak_detected_len ++;
+           prev_peak = sig_idx;
+       }
+    }
+
+    // scan for the peak before max. (left)
+    sig_idx = max_idx;          // signal start form the left of main peak.
+    peak_idx = peak_left_len - 1;  // start from the left of main peak.
+    for(int i=peak_idx; i>=0 && peak_idx>=0; i--)
+    {
+       int turning_idx = find_prev_turning(&sig[sig_idx], sig_idx);
+       if(turning_idx == 0)
+           break;
+       sig_idx += turning_idx;
+       if(max_idx - sig_idx > max_distance_left) // maximum searching distance
+           break;
+
+       if(fabs(sig[sig_idx]) >= threshold && fabs(prev_peak - sig_idx) >= MINI_PEAK_DISTANCE)
+       {
+           peaks[peak_idx][0] = sig_idx;
+           peaks[peak_idx][1] = sig[sig_idx];
+           peak_idx --;
+           peak_detected_len ++;
+           prev_peak = peak_idx;
+       }
+    }
+    return peak_detected_len;
+}
+
+
+int locate_main_peak(float peaks[][2], int peak_len)
+{
+    // locate the main peak by the interception of 2 linear functions
+    // the first function is from the peaks before the maximum peaks,
+    // the second function is from the peaks after.
+    float a1, b1, a2, b2;
+    float p[6][2]; // points (x,y) y=ax+b
+    p[0][0] = peaks[0][0];
+    p[0][1] = peaks[0][1];
+    p[1][0] = peaks[2][0];
+    p[1][1] = peaks[2][1];
+    p[2][0] = peaks[4][0];
+    p[2][1] = peaks[4][1];
+
+    p[3][0] = peaks[peak_len-5][0];
+    p[3][1] = peaks[peak_len-5][1];
+    p[4][0] = peaks[peak_len-3][0];
+    p[4][1] = peaks[peak_len-3][1];
+    p[5][0] = peaks[peak_len-1][0];
+    p[5][1] = peaks[peak_len-1][1];
+
+    float avg_x = 0;
+    float avg_y = 0;
+    float n = 0;
+    float m = 0;
+    for(int i=0; i<3; i++) // average x
+        avg_x += p[i][0];
+    avg_x /= 3;
+
+    for(int i=0; i<3; i++) // average y
+        avg_y += p[i][1];
+    avg_y /= 3;
+
+    for(int i=0; i<3; i++){
+        n += (p[i][0] - avg_x)*(p[i][1] - avg_y);
+        m += (p[i][0] - avg_x)*(p[i][0] - avg_x);
+    }
+    a1 = n/m;
+    b1 = avg_y - avg_x *a1;
+
+    avg_x = 0; avg_y = 0; n = 0; m = 0;
+    for(int i=3; i<6; i++) // average x
+        avg_x += p[i][0];
+    avg_x /= 3;
+    for(int i=3; i<6; i++) // average y
+        avg_y += p[i][1];
+    avg_y /= 3;
+    for(int i=3; i<6; i++){
+        n += (p[i][0] - avg_x)*(p[i][1] - avg_y);
+        m += (p[i][0] - avg_x)*(p[i][0] - avg_x);
+    }
+    a2 = n/m;
+    b2 = avg_y - avg_x *a2;
+
+    float x = (b2-b1)/(a1-a2);
+
+    // search for main peak
+    int idx;
+    for(idx=0; idx<peak_len; idx++)
+    {
+        if(peaks[idx][1] > 0){
+            if(peaks[idx][0] > x)
+                break;
+        }
+    }
+    return idx; // return the offset of the main peak
+}
+
+// compare 2 peaks arrays, find offset of it.
+int match_shape(float peaks1[][2], float peaks2[][2], int len, float mse[], int search_range)
+{
+    memset(mse, 0, sizeof(float)*search_range);
+    for(int off = -search_range/2; off<=search_range/2; off++)
+    {
+        float sum = 0;
+        float count = 0;
+        int start_idx = -off;
+        int stop_idx = len + off;
+        if(start_idx < 0) start_idx = 0;
+        if(stop_idx > len) stop_idx = len - off;
+        for(int i=start_idx; i<stop_idx; i++)
+        {
+            if(peaks1[i][0] !=0 && peaks2[i][0] != 0) //
+            {
+                float v = peaks1[i][1] - peaks2[i+off][1];
+                sum += v*v;
+                count++;
+            }
+        }
+        mse[off+search_range/2] = sum/count;
+    }
+    return arg_minf(mse, search_range);
+}
+
+// int16 -> float, also move data to zero_level. see if we need to scale it?
+int preprocess(uint16_t *raw, float* out, float zero_level, uint32_t len)
+{
+    for(uint32_t i=0; i<len; i++){
+        out[i] = ((float)raw[i] - zero_level);
+    }
+    return len;
+}
+// this version use the current signal's zero_level. no calibration needed.
+float preprocess2(uint16_t *raw, float* out, uint32_t len)
+{
+    float zero_level = 0;
+    for(uint32_t i=0; i<len; i++){
+        zero_level += raw[i];
+    }
+    zero_level /= len;
+
+    for(uint32_t i=0; i<len; i++){
+        out[i] = ((float)raw[i] - zero_level);
+    }
+    return zero_level;
+}
+
+/*
+// add a small LPF to avoid equal number, which cause turning point detection fail
+void small_lpf(float* sig, uint32_t len)
+{
+    float momentum = sig[0];
+    for(uint32_t i=1; i<len; i++){
+        sig[i] = sig[i]*0.9 + momentum*0.1;
+        momentum = sig[i];
+    }
+}*/
+
+// this is a moving sum version, windows size = half wave of 40k
+void small_lpf(float* sig, uint32_t len)
+{
+    #define WIN_SIZE 12
+    float sum =0;
+    for(uint32_t i=1; i<len-WIN_SIZE; i++){
+        for(int j=0; j<WIN_SIZE; j++)
+            sum+= sig[i+j];
+        sig[i] = sum;
+        sum = 0;
+    }
+}
+
+// a generic fileters using pre-calculated b-a coefficient.
+// y[i] = b[0] * x[i] + b[1] * x[i - 1] + b[2] * x[i - 2] - a[1] * y[i - 1] - a[2] * y[i - 2]...
+void filter(float* x, float* y, uint32_t signal_len, const float ba[][2], const uint32_t orders)
+{
+    memset(y, 0, sizeof(float)*(orders*2+1)); // we dont use the first few data.
+    for(int i=(orders*2+1); i<signal_len; i++)
+    {
+       y[i] = 0;
+       for(int c=0; c < (orders*2+1); c++)
+           y[i] += ba[c][0] * x[i-c] - ba[c][1] * y[i-c];
+    }
+}
+
+// ref http://www.sengpielaudio.com/calculator-airpressure.htm
+// Speed of sound c ≈ 331.3 + 0.6 ϑ  (m/s)
+// Temperature ϑ ≈ (331.3 − c) / 0.6
+float speed_of_sound_from_T(float temperature){
+    return 20.05f*sqrtf(temperature + 273.15); // more accurate.
+    //return 331.3+0.6*temperature;
+}
+
+float average(float sig[], int num)
+{
+    float sum=0;
+    for(int i=0; i<num; i++)
+        sum += sig[i];
+    return sum/num;
+}
+
+void get_pulse_offset(float offset[], float zero_cross[][ZEROCROSS_LEN], float propagation_time)
+{
+    // the offset between the first valid crossing to the wave that actually start.
+    offset[NORTH] = propagation_time - average(zero_cross[NORTH], NUM_ZC_AVG);
+    offset[SOUTH] = propagation_time - average(zero_cross[SOUTH], NUM_ZC_AVG);
+    offset[EAST] = propagation_time - average(zero_cross[EAST], NUM_ZC_AVG);
+    offset[WEST] = propagation_time - average(zero_cross[WEST], NUM_ZC_AVG);
+}
+
+// this update a normal peak values at a rate (represent a portion of new peaks)
+void update_shape(float ref[PEAK_LEN][2], float curr[PEAK_LEN][2], float rate)
+{
+    for(int i=0; i<PEAK_LEN; i++)
+        ref[i][0] = ref[i][0] * (1-rate) + curr[i][0]*rate;
+}
+
+void correlation(float* sig1, int len1, float* sig2, int len2, float* out)
+{
+    int len = len1 + len2;
+    for (int i = 0; i < len; i++)
+    {
+        int32_t start2 = MAX(0, (len2-i)); // bracket needed.
+        int32_t end2 = MIN(len2, (len2 - (i-len1)));
+        int32_t start1 = MAX(0, (i - len2));
+        float sum = 0;
+        for (int n = start2; n < end2; n++)
+            sum += sig1[start1++] * sig2[n];
+        out[i] = sum;
+    }
+}
+
+int get_pattern_len(int pulse_len, int samplerate){
+    return  (int)((1000000/(float)samplerate)*pulse_len);
+}
+
+// reference pattern of the pulse for correlation, square wave.
+// polarity = -1 or 1
+void create_pattern(const uint16_t p[], int pulse_len, float* pattern, int samplerate, float polarity)
+{
+    int pulse_idx = 0;
+    int pattern_len = get_pattern_len(pulse_len, samplerate);
+    float amplitude = 1/(float)pattern_len * 4 * polarity; // polarity control and normalized
+    float step = (1000000/(float)samplerate);
+
+    for(int i=0; i<pattern_len; i++)
+    {
+        pulse_idx = i / step;
+        if(p[pulse_idx] > 0)
+            pattern[i] = amplitude;
+        else
+            pattern[i] = -amplitude;
+    }
+}
+
+// reference pattern of the pulse for correlation, sine wave with the phase of each pulse.
+// polarity = -1 or 1
+void create_pattern2(const uint16_t p[], int pulse_len, float* pattern, int freq, float polarity)
+{
+    int pulse_idx = 0;
+    int pattern_len = get_pattern_len(pulse_len, freq);
+    float amplitude = 1/(float)pattern_len * 4 * polarity; // polarity control and normalized
+    float step = (1000000/(float)freq);
+
+    for(int i=0; i<pattern_len; i++)
+    {
+        pulse_idx = i / step / 2;
+        if(p[pulse_idx*2] > 0 && p[pulse_idx*2+1] ==0)
+            pattern[i] = amplitude * sinf(3.1415926f * (i/step));
+        else
+            pattern[i] = -amplitude * sinf(3.1415926f * (i/step));
+    }
+}
+
+// output:
+// -> zero_crossing
+// -> calibrated shapes (peaks)
+int calibration2(float* static_zero_cross, float* echo_shape, float* sig, float* sig2,
+        uint16_t adc[][ADC_SAMPLE_LEN], float distance[4], const uint16_t *pulse, const uint16_t pulse_len)
+{
+    float sig_level[4];
+    memset(static_zero_cross, 0, sizeof(float) * ZEROCROSS_LEN * 4);
+    memset(echo_shape, 0, sizeof(float) * PEAK_LEN* 2 *4);
+
+    // make a good masurement.
+    for (int i = 0; i<16; i++){
+        sig_level[NORTH] = ane_measure_ch(NORTH,  pulse, pulse_len, adc[NORTH], ADC_SAMPLE_LEN, true);
+        sig_level[SOUTH] = ane_measure_ch(SOUTH,  pulse, pulse_len, adc[SOUTH], ADC_SAMPLE_LEN, true);
+        sig_level[EAST] = ane_measure_ch(EAST,  pulse, pulse_len, adc[EAST], ADC_SAMPLE_LEN, true);
+        sig_level[WEST] = ane_measure_ch(WEST,  pulse, pulse_len, adc[WEST], ADC_SAMPLE_LEN, true);
+        if(fabs(sig_level[NORTH]-sig_level[SOUTH]) < 2 && fabs(sig_level[EAST]-sig_level[WEST]) < 2)
+            break;
+    }
+    // find peaks and select a good channel as template.
+    float peaks_zero[4][PEAK_LEN][2] = {0}; // collect 4 more.
+    for(int idx=0; idx<4; idx++)
+    {
+        preprocess(adc[idx], sig2, sig_level[idx], ADC_SAMPLE_LEN);
+        ane_filter_run(&ane_bp_filter, sig2, sig, ADC_SAMPLE_LEN);
+        normalize(&sig[DEADZONE_OFFSET], VALID_LEN);
+        capture_peaks(&sig[DEADZONE_OFFSET], VALID_LEN, peaks_zero[idx], PEAK_LEFT, PEAK_RIGHT, 0.2);
+        // find the maximum distance between the main and its near 2 peaks.
+        distance[idx] = (peaks_zero[idx][PEAK_MAIN][1] - peaks_zero[idx][PEAK_MAIN - 2][1]) +
+                (peaks_zero[idx][PEAK_MAIN][1] - peaks_zero[idx][PEAK_MAIN + 2][1]);
+    }
+    // select the channel which has max distance to the side peaks.
+    int selected_ch;
+    selected_ch = argmaxf(distance, 4);
+
+    // when we have the peaks, we can now use it as a template to capture all others channels.
+    // add some small offset in case of little misalignment between channels.
+    int start_idx = peaks_zero[selected_ch][0][0] - 8;
+
+    // capture pattern.
+    int count = 0;
+    for (int i = 0; i<256 && count<32; i++)
+    {
+        sig_level[NORTH] = ane_measure_ch(NORTH,  pulse, pulse_len, adc[NORTH], ADC_SAMPLE_LEN, true);
+        sig_level[SOUTH] = ane_measure_ch(SOUTH,  pulse, pulse_len, adc[SOUTH], ADC_SAMPLE_LEN, true);
+        sig_level[EAST] = ane_measure_ch(EAST,  pulse, pulse_len, adc[EAST], ADC_SAMPLE_LEN, true);
+        sig_level[WEST] = ane_measure_ch(WEST,  pulse, pulse_len, adc[WEST], ADC_SAMPLE_LEN, true);
+
+        float zero_cross[4][ZEROCROSS_LEN] = {0};
+        for(int idx = 0; idx < 4; idx++)
+        {
+            // convert to float
+            preprocess(adc[idx], sig2, sig_level[idx], ADC_SAMPLE_LEN);
+            // band pass filter.
+            ane_filter_run(&ane_bp_filter, sig2, sig, ADC_SAMPLE_LEN);
+            // normalize to -1 to 1
+            normalize(&sig[DEADZONE_OFFSET], VALID_LEN);
+            // search original peaks, use to rough estimate the data.
+            capture_peaks_from(&sig[DEADZONE_OFFSET + start_idx],  VALID_LEN-start_idx, peaks_zero[idx], PEAK_LEN, 0.02);
+            //capture_peaks(&sig[DEADZONE_OFFSET + start_idx], VALID_LEN, peaks_zero[idx], 0, PEAK_RIGHT+PEAK_LEFT, 0.02);
+            // recover timestamp
+            for(int j=0; j<PEAK_LEN; j++)
+                peaks_zero[idx][j][0] += DEADZONE_OFFSET + start_idx;
+            // measure zero cross
+            int off = peaks_zero[idx][PEAK_ZC][0];
+            linear_interpolation_zerocrossing(&sig[off], ADC_SAMPLE_LEN-off, zero_cross[idx], ZEROCROSS_LEN);
+            // recover the actual timestamp from start
+            for(int j=0; j<ZEROCROSS_LEN; j++)
+                zero_cross[idx][j] += off;
+        }
+
+        // record if the numbers looks correct
+        if(fabs(zero_cross[NORTH][PEAK_ZC] - zero_cross[SOUTH][PEAK_ZC]) < 2 && // same channel
+           fabs(zero_cross[WEST][PEAK_ZC] - zero_cross[EAST][PEAK_ZC]) < 2 &&
+           fabs(zero_cross[NORTH][PEAK_ZC] - zero_cross[EAST][PEAK_ZC]) < 10 &&  // cross channel
+           fabs(zero_cross[SOUTH][PEAK_ZC] - zero_cross[WEST][PEAK_ZC]) < 10)
+        {
+            count++;
+            // sum them up
+            for(int idx = 0; idx < 4; idx++)
+            for(int j=0; j<ZEROCROSS_LEN; j++)
+                *(static_zero_cross + idx*ZEROCROSS_LEN + j) += zero_cross[idx][j];
+
+            // index average
+            for(int idx = 0; idx < 4; idx++)
+            for(int j=0; j<PEAK_LEN; j++)
+            {
+                *(echo_shape + (idx*PEAK_LEN + j)*2 + 0) += peaks_zero[idx][j][0];
+                *(echo_shape + (idx*PEAK_LEN + j)*2 + 1) += peaks_zero[idx][j][1];
+            }
+        }
+    }
+    if(count == 0)
+        return 0;
+    // generate static zero cross.
+    for(int idx = 0; idx < 4; idx ++)
+        for(int j=0; j<ZEROCROSS_LEN; j++)
+            *(static_zero_cross + idx*ZEROCROSS_LEN + j) /= count;
+
+    for(int idx = 0; idx < 4; idx ++)
+        for(int j=0; j<PEAK_LEN; j++){
+            *(echo_shape + (idx*PEAK_LEN + j)*2 + 0) /= count;
+            *(echo_shape + (idx*PEAK_LEN + j)*2 + 1) /= count;
+        }
+    return count;
+}
+
+// processing a channel from raw ADC data to time of flight.
+int ane_measure_cycle(uint16_t adc[][ADC_SAMPLE_LEN], ane_baseline_t baseline[4], float sig_level[4])
+{
+    return ane_measure_stack(adc, baseline, sig_level, 1);
+}
+
+int ane_measure_stack(uint16_t adc[][ADC_SAMPLE_LEN], ane_baseline_t baseline[4], float sig_level[4], int shots)
+{
+    const ULTRASONIC_CHANNEL order[4] = {NORTH, SOUTH, EAST, WEST};
+    return ane_measure_src(&ane_drv_src, order, adc, baseline, sig_level, shots, NULL);
+}
+
+static float drv_capture(void *user, ULTRASONIC_CHANNEL ch, uint16_t *adc, bool is_calibrate)
+{
+    (void)user;
+    return ane_measure_ch(ch, cpulse, pulse_len, adc, ADC_SAMPLE_LEN, is_calibrate);
+}
+
+const ane_capture_src_t ane_drv_src = {
+        .capture = drv_capture,
+};
+
+int ane_measure_src(const ane_capture_src_t *src, const ULTRASONIC_CHANNEL order[4], uint16_t adc[][ADC_SAMPLE_LEN],
+        ane_baseline_t baseline[4], float sig_level[4], int shots, uint32_t ts[4])
+{
+    static uint16_t shot[ADC_SAMPLE_LEN];
+    bool is_anchor[4];
+    float level[4];
+    uint32_t t0 = 0, count = 0;
+    uint32_t ts_sum[4] = {0}; // relative to the first capture, wrapping of the counter does not matter.
+    int num_anchor = 0;
+    shots = MIN(MAX(shots, 1), ANE_STACK_MAX_SHOTS);
+
+    // the pulse-less capture is only taken with the first shot.
+    for(int i=0; i<4; i++)
+    {
+        ULTRASONIC_CHANNEL ch = order[i];
+        is_anchor[ch] = baseline_need_anchor(&baseline[ch]);
+        level[ch] = src->capture(src->user, ch, adc[ch], is_anchor[ch]);
+        uint32_t t = src->timestamp ? src->timestamp(src->user) : count++;
+        if(i == 0)
+            t0 = t;
+        ts_sum[ch] = t - t0;
+    }
+    // sum the other shots, then average.
+    if(shots > 1)
+    {
+        for(int n=1; n<shots; n++)
+        {
+            for(int i=0; i<4; i++)
+            {
+                ULTRASONIC_CHANNEL ch = (n & 1) ? order[3 - i] : order[i];
+                src->capture(src->user, ch, shot, false);
+                ts_sum[ch] += (src->timestamp ? src->timestamp(src->user) : count++) - t0;
+                for(int j=0; j<ADC_SAMPLE_LEN; j++)
+                    adc[ch][j] += shot[j];
+            }
+        }
+        for(int ch=0; ch<4; ch++)
+            for(int j=0; j<ADC_SAMPLE_LEN; j++)
+                adc[ch][j] = (adc[ch][j] + shots/2) / shots;
+    }
+    if(ts)
+        for(int ch=0; ch<4; ch++)
+            ts[ch] = t0 + ts_sum[ch] / shots;
+
+    for(int ch=0; ch<4; ch++)
+    {
+        if(is_anchor[ch])
+        {
+            baseline_anchor(&baseline[ch], level[ch], adc[ch]);
+            sig_level[ch] = level[ch];
+            num_anchor++;
+        }
+        else
+            sig_level[ch] = baseline_update(&baseline[ch], adc[ch]);
+    }
+    return num_anchor;
+}
+
+int ane_process_channel(uint16_t *raw, float zero_level, float ref_shape[PEAK_LEN][2], float pulse_offset,
+        int start, int len, float *mse_history, ane_ch_result_t *res, float aligned[PEAK_LEN])
+{
+    static ane_features_t ft; // ~0.6KB, off the stack, only the anemometer thread processes the captures.
+    float shape[PEAK_LEN][2];
+    float zero_cross[ZEROCROSS_LEN] = {0};
+    int pz, off;
+    // the filter starts a bit earlier than the window to settle down, the full window filters from the beginning.
+    int filter_start = (start <= DEADZONE_OFFSET) ? 0 : MAX(0, start - FILTER_GUARD_LEN);
+    PROF_START(t);
+
+    memset(res, 0, sizeof(ane_ch_result_t));
+    if(aligned)
+        memset(aligned, 0, sizeof(float) * PEAK_LEN);
+    if(start < DEADZONE_OFFSET || len <= 0 || start + len > ADC_SAMPLE_LEN)
+        return NORMAL; // dt stays 0, it will not pass the alignment check.
+
+    // convert, filter and search the turning points and zero crossings in one pass.
+    ane_extract(raw, zero_level, filter_start, start, len, &ft);
+    PROF_STAGE(t, ANE_STAGE_EXTRACT);
+
+    // Beside to use the signal peak to calculate the rough propagation time,
+    // We use a few more peak and valley around the main peaks.
+    // And use MSE to match the signals.  This is a shape detector.
+    // detect peaks as shape.
+    memset(shape, 0, sizeof(shape));
+    pz = ane_features_shape(&ft, shape, 0.02);
+    PROF_STAGE(t, ANE_STAGE_PEAKS);
+    if(pz != PEAK_LEN) // only process if the we have capture the correct len.
+        return NORMAL;  // dt stays 0, it will not pass the alignment check.
+
+    // use peak to find the offset if there is any on the main peak
+    res->mini_mse = match_shape(ref_shape, shape, PEAK_LEN, res->mse, MSE_RANGE);
+    // use linear functions to locate the main peak, this is different from the mse method in realtime measurement.
+    //peak_off = locate_main_peak(shape, PEAK_LEN);
+    res->peak_off = res->mini_mse - MSE_RANGE/2;
+    if(aligned)
+        for(int i=MAX(0, -res->peak_off); i<MIN(PEAK_LEN, PEAK_LEN - res->peak_off); i++)
+            if(ref_shape[i][0] != 0 && shape[i + res->peak_off][0] != 0)
+                aligned[i] = shape[i + res->peak_off][1];
+    *mse_history = 0.9*(*mse_history) + 0.1*res->mse[res->mini_mse];
+    if(isnan(res->mse[0]))
+        res->err = ERR_MSE_NAN;
+    if(res->mse[res->mini_mse] > *mse_history*10)
+        res->err = ERR_SHAPE_MISMATCH;
+    // 1 = perfect match, 0 = at the mismatch limit
+    res->quality = *mse_history > 0 ? 1 - MIN(1, res->mse[res->mini_mse] / (*mse_history*10)) : 1;
+    if(res->err == ERR_MSE_NAN)
+        res->quality = 0;
+    PROF_STAGE(t, ANE_STAGE_MATCH);
+
+    // we start the crossing point from the PEAK_ZC + offset detected by shape
+    off = shape[PEAK_ZC + res->peak_off][0];
+    if(ane_features_zerocross(&ft, off, zero_cross, ZEROCROSS_LEN) < 0)
+        return res->err; // dt stays 0
+    // recover the offsets for these zero cross
+    for(int j=0; j<ZEROCROSS_LEN; j++)
+        zero_cross[j] += off + start;
+
+    // finally, uses a few zero crossing points to calculate the propagation time.
+    res->dt = average(zero_cross, NUM_ZC_AVG) + pulse_offset;
+    PROF_STAGE(t, ANE_STAGE_ZEROCROSS);
+    return res->err;
+}
+
+int ane_process_cycle(uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], ane_calib_t *calib, int win[4][2],
+        float mse_history[4], ane_ch_result_t res[4], float shape[4][PEAK_LEN])
+{
+    int err = NORMAL;
+    for(int idx = 0; idx < 4; idx ++)
+    {
+        int start = win ? win[idx][0] : DEADZONE_OFFSET;
+        int len = win ? win[idx][1] : VALID_LEN;
+        int rslt = ane_process_channel(adc[idx], sig_level[idx], calib->ref_shape[idx], calib->pulse_offset[idx],
+                start, len, &mse_history[idx], &res[idx], shape ? shape[idx] : NULL);
+        if(rslt != NORMAL)
+            err = rslt;
+    }
+    return err;
+}
+
+void ane_geometry_init(ane_geometry_t *geo, float height, float pitch)
+{
+    // D=distance to reflector; alpha=angle of reflection.
+    // wind speed: v = d/sin(a)*cos(a)((1/T_forward) - (1/T_backward))
+    // sound speed: c = d/sin(a)*((1/T_forward) + (1/T_backward)
+    float alpha = atanf(2*height/pitch);
+    geo->height = height;
+    geo->pitch = pitch;
+    geo->cos_a = cosf(alpha);
+    geo->sin_a = sinf(alpha);
+}
+
+// propagation time in us when there is no wind.
+float ane_propagation_time(ane_geometry_t *geo, float c)
+{
+    return 2* geo->height / (geo->sin_a * c) * 1000000;
+}
+
+int ane_wind_from_dt(ane_geometry_t *geo, float dt[4], float T, ane_wind_t *wind)
+{
+    float t[4];
+    float height = geo->height;
+
+    // check if one of the distance drift too much from the other.
+    if(fabs(fabs(dt[NORTH] - T) - fabs(dt[SOUTH] - T)) > 12 ||
+       fabs(fabs(dt[EAST] - T) - fabs(dt[WEST] - T)) > 12)
+        return ERR_MISALIGN;
+
+    //convert 'us' to 'second'
+    for(int i=0; i<4; i++)
+        t[i] = dt[i] / 1000000.f;
+
+    // wind speed.
+    wind->ns_v = height / (geo->sin_a * geo->cos_a) * (1.0f/t[NORTH] - 1.0f/t[SOUTH]);
+    wind->ew_v = height / (geo->sin_a * geo->cos_a) * (1.0f/t[EAST] - 1.0f/t[WEST]);
+    wind->v = sqrtf(wind->ns_v*wind->ns_v + wind->ew_v*wind->ew_v);
+
+    // sound speed
+    wind->ns_c = height / geo->sin_a * (1.0f/t[NORTH] + 1.0f/t[SOUTH]);
+    wind->ew_c = height / geo->sin_a * (1.0f/t[EAST] + 1.0f/t[WEST]);
+    wind->c = (wind->ns_c + wind->ew_c)/2;
+
+    // a basic hard check
+    if(270 > wind->c || wind->c > 365)
+        return ERR_WINDSPEED;
+
+    // course
+    wind->course = atan2f(-wind->ew_v, -wind->ns_v)/3.1415926*180 + 180;
+    return NORMAL;
+}
+
+int ane_wind_check(ane_wind_t *wind, float *c_history, float est_c)
+{
+    if(*c_history == 0)
+        *c_history = wind->c;
+    *c_history = *c_history*0.9 + wind->c*0.1;
+
+    // final check, if wind speed abnormal, then resample
+    if(fabs(est_c - wind->c) > 20 || fabs(wind->c - *c_history) > 2)
+        return ERR_WINDSPEED;
+    return NORMAL;
+}
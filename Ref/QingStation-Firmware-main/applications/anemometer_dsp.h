@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       split from anemometer.c
+ */
+#ifndef __ANEMOMETER_DSP_H__
+#define __ANEMOMETER_DSP_H__
+
+// The signal processing chain of the ultrasonic anemometer.
+// Nothing in here depends on RT-Thread, only the capture functions in drv_anemometer.h,
+// so the same code can be compiled on a PC against a stub driver (see host/).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drv_anemometer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum{
+    NORMAL = 0,
+    ERR_MSE_NAN = 1,
+    ERR_SHAPE_MISMATCH = 2,
+    ERR_MISALIGN = 3,       // one of the channel has capture misaligned data.
+    ERR_WINDSPEED = 4,
+    ERR_CODE_NUM
+};
+
+// excitation pulse, see anemometer_dsp.c
+extern const uint16_t cpulse[];
+extern const uint32_t pulse_len;
+
+// pulse freqency, timer pwm cycle.
+#define PULSE_FREQ (80*1000)
+
+// ADC = 1Msps, 500sample = 0.5ms ToF ~= 0.17m
+// speed of sound: ~340m/s
+// 500 sample  = 0.5ms ~= 0.17m
+// 1000 sample = 1ms   ~= 0.34m
+#define ADC_SAMPLE_LEN (1000)
+
+// where the process started -> to avoid the direct sound propagation at the beginning. Depended on the mechanical structure.
+// Same unit of ADC sampling -> us.
+#define DEADZONE_OFFSET ((int)(pulse_len * 12.5) + 25) // AVOID overlapping the pulse
+#define VALID_LEN  (ADC_SAMPLE_LEN - DEADZONE_OFFSET)
+#define ZEROCROSS_LEN   (6)
+#define NUM_ZC_AVG      (6) // number of zerocrossing to calculate the beam location. better to be even number
+
+// to define the shape of to identify the echo beam
+#define PEAK_LEFT   (8)
+#define PEAK_MAIN   PEAK_LEFT
+#define PEAK_RIGHT  (8)
+#define PEAK_LEN    (PEAK_LEFT + PEAK_RIGHT + 1)
+#define PEAK_ZC     (5)  // start from which peak to identify the zero crossing. (2=3rd)
+
+// peak to peak mini distance in peak detection.
+#define MINI_PEAK_DISTANCE  (5)
+
+// samples filtered before a processing window, for the band pass filter to settle.
+#define FILTER_GUARD_LEN    (50)
+
+// search range of the shape matching (peaks)
+#define MSE_RANGE   (13)
+
+// band pass filter coefficient in use.
+extern const float bp_coeff[][2];
+extern const int   bp_coeff_order;
+
+// calibration result of a station, all the channels
+typedef struct _ane_calib_t
+{
+    float static_zero_cross[4][ZEROCROSS_LEN];
+    float ref_shape[4][PEAK_LEN][2];    // shape of the echo, [][0]=index, [][1]=value
+    float pulse_offset[4];              // offset between the zero crossings and the start of the wave.
+} ane_calib_t;
+
+// result of one channel
+typedef struct _ane_ch_result_t
+{
+    float dt;               // time of flight in us, pulse offset included. 0 = not available
+    float mse[MSE_RANGE];   // shape matching result
+    int   mini_mse;         // index of the best match in mse[]
+    int   peak_off;         // offset of the main peak found by shape matching
+    float quality;          // 0~1, how well the echo matches the reference of the estimator
+    int   err;
+} ane_ch_result_t;
+
+// the dimension of the sensor
+typedef struct _ane_geometry_t
+{
+    float height;   // height of reflective plate to transducer.
+    float pitch;    // pitch size between transducer.
+    float sin_a;
+    float cos_a;
+} ane_geometry_t;
+
+// output of a valid measurement
+typedef struct _ane_wind_t
+{
+    float ns_v, ew_v;   // wind speed
+    float ns_c, ew_c;   // sound speed -> these measurements should be very close, other wise the measurment is wrong.
+    float v;
+    float c;
+    float course;
+} ane_wind_t;
+
+// basic operation
+uint32_t match_filter(float* signal, uint32_t signal_len, float* pattern, uint32_t pattern_len, float* output);
+float maxf(float* sig, int len);
+int32_t argmaxf(float* sig, int32_t len);
+float minf(float* sig, int len);
+int arg_minf(float* sig, int len);
+void normalize(float* pattern, uint32_t len);
+float average(float sig[], int num);
+void correlation(float* sig1, int len1, float* sig2, int len2, float* out);
+
+// reference patterns of the excitation pulse for correlation, see anemometer_fft.h for the fast version.
+int get_pattern_len(int pulse_len, int samplerate);
+void create_pattern(const uint16_t p[], int pulse_len, float* pattern, int samplerate, float polarity);
+void create_pattern2(const uint16_t p[], int pulse_len, float* pattern, int freq, float polarity);
+
+// signal processing
+int preprocess(uint16_t *raw, float* out, float zero_level, uint32_t len);
+float preprocess2(uint16_t *raw, float* out, uint32_t len);
+float get_zero_level(uint16_t* raw, uint32_t len);
+void small_lpf(float* sig, uint32_t len);
+void filter(float* x, float* y, uint32_t signal_len, const float ba[][2], const uint32_t orders);
+
+// baseline (zero level) of a capture.
+// The level is estimated from the quiet samples between the end of the pulse and the echo,
+// 2 periods of 40kHz so the ringing of the transducer is cancelled by the trimmed mean.
+// A pulse-less capture is only needed when the tracker sees the level drifting.
+#define BASELINE_START      ((int)(pulse_len * 12.5))
+#define BASELINE_LEN        (50)
+#define BASELINE_TOLERANCE  (3.0f)  // in ADC LSB
+#define BASELINE_MAX_AGE    (600)   // cycles between 2 pulse-less captures at most.
+
+typedef struct _ane_baseline_t
+{
+    float level;        // tracked level of the quiet samples
+    float anchor_level; // level when the last pulse-less capture was taken
+    float bias;         // pulse-less level - quiet samples level, at the last pulse-less capture
+    uint32_t age;       // cycles since the last pulse-less capture
+    uint8_t outliers;   // consecutive estimations out of tolerance
+    bool is_valid;
+} ane_baseline_t;
+
+float baseline_estimate(uint16_t *raw);
+bool baseline_need_anchor(ane_baseline_t *bl);
+// no_pulse_level is the level measured by a pulse-less capture, raw is the capture with pulse.
+void baseline_anchor(ane_baseline_t *bl, float no_pulse_level, uint16_t *raw);
+// update with a new capture, return the zero level to use.
+float baseline_update(ane_baseline_t *bl, uint16_t *raw);
+
+// echo detection
+int linear_interpolation_zerocrossing(float* sig, uint32_t sig_len, float* out, uint32_t num_zero_cross);
+int find_next_turning(float *sig, int len);
+int find_prev_turning(float *sig, int len);
+int capture_peaks_from(float* sig, int sig_len, float peaks[][2], int peak_len, float threshold);
+int capture_peaks(float* sig, int sig_len, float peaks[][2], int peak_left_len, int peak_right_len, float threshold);
+int locate_main_peak(float peaks[][2], int peak_len);
+int match_shape(float peaks1[][2], float peaks2[][2], int len, float mse[], int search_range);
+void update_shape(float ref[PEAK_LEN][2], float curr[PEAK_LEN][2], float rate);
+
+// calibration, this will perform the measurement.
+// distance[] output the shape quality of each channel, the template is taken from the max.
+int calibration2(float* static_zero_cross, float* echo_shape, float* sig, float* sig2,
+        uint16_t adc[][ADC_SAMPLE_LEN], float distance[4], const uint16_t *pulse, const uint16_t pulse_len);
+void get_pulse_offset(float offset[], float zero_cross[][ZEROCROSS_LEN], float propagation_time);
+
+// sample all channels with the pulse, the zero levels are from the baseline trackers.
+// a pulse-less capture is only made on the channel that need it. return the number of pulse-less capture made.
+int ane_measure_cycle(uint16_t adc[][ADC_SAMPLE_LEN], ane_baseline_t baseline[4], float sig_level[4]);
+
+// coherent stacking, same as ane_measure_cycle() but each channel is the average of a few shots.
+// the shots are taken in turn over the channels, so the ringing of the last shot is gone.
+// the order is reversed every shot, see ane_measure_src().
+#define ANE_STACK_MAX_SHOTS (16)    // 12bit ADC, the sum of 16 shots still fits in uint16
+int ane_measure_stack(uint16_t adc[][ADC_SAMPLE_LEN], ane_baseline_t baseline[4], float sig_level[4], int shots);
+
+// source of the captures, the driver on the station, replayed or synthetic captures on PC.
+typedef struct _ane_capture_src_t
+{
+    // a capture of the channel with the pulse, same as ane_measure_ch(), return the signal level.
+    float (*capture)(void *user, ULTRASONIC_CHANNEL ch, uint16_t *adc, bool is_calibrate);
+    // free running counter taken after a capture, any unit. NULL to count the captures instead.
+    uint32_t (*timestamp)(void *user);
+    void *user;
+} ane_capture_src_t;
+
+extern const ane_capture_src_t ane_drv_src; // ane_measure_ch() without timestamp
+
+// ane_measure_stack() from a source, the first shot in the order given, the next in reverse and so on,
+// so all channels of an even number of shots are centred at the same instant.
+// ts[ch] is the average timestamp of the shots of the channel, NULL if not needed.
+int ane_measure_src(const ane_capture_src_t *src, const ULTRASONIC_CHANNEL order[4], uint16_t adc[][ADC_SAMPLE_LEN],
+        ane_baseline_t baseline[4], float sig_level[4], int shots, uint32_t ts[4]);
+
+// processing a channel from raw ADC data to time of flight.
+// only the window [start, start+len) is processed, start >= DEADZONE_OFFSET, the full window is (DEADZONE_OFFSET, VALID_LEN)
+// mse_history is updated. The capture is processed in a single pass, see anemometer_extract.h
+// shape is the values of the echo peaks aligned to the reference by the match, 0 if not found. NULL if not needed.
+int ane_process_channel(uint16_t *raw, float zero_level, float ref_shape[PEAK_LEN][2], float pulse_offset,
+        int start, int len, float *mse_history, ane_ch_result_t *res, float shape[PEAK_LEN]);
+// processing all 4 channels, the last error detected is returned.
+// win[ch][0] = start, win[ch][1] = len, NULL to use the full window. shape can be NULL.
+int ane_process_cycle(uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], ane_calib_t *calib, int win[4][2],
+        float mse_history[4], ane_ch_result_t res[4], float shape[4][PEAK_LEN]);
+
+// wind calculation
+float speed_of_sound_from_T(float temperature);
+void ane_geometry_init(ane_geometry_t *geo, float height, float pitch);
+float ane_propagation_time(ane_geometry_t *geo, float c); // in us
+// dt[] in us, T = the propagation time without wind.
+int ane_wind_from_dt(ane_geometry_t *geo, float dt[4], float T, ane_wind_t *wind);
+// check the sound speed with history and temperature. c_history is updated.
+int ane_wind_check(ane_wind_t *wind, float *c_history, float est_c);
+
+// stage profiling, build with ANE_DSP_PROFILE and provide ane_dsp_cycle_get() to enable.
+enum{
+    ANE_STAGE_EXTRACT = 0,  // convert, filter, turning points and zero crossings
+    ANE_STAGE_PEAKS,
+    ANE_STAGE_MATCH,
+    ANE_STAGE_ZEROCROSS,
+    ANE_STAGE_NUM
+};
+
+typedef struct _ane_dsp_prof_t
+{
+    uint64_t total[ANE_STAGE_NUM];
+    uint32_t max[ANE_STAGE_NUM];
+    uint32_t count[ANE_STAGE_NUM];
+} ane_dsp_prof_t;
+
+extern const char *ane_stage_names[ANE_STAGE_NUM];
+#ifdef ANE_DSP_PROFILE
+extern ane_dsp_prof_t ane_dsp_prof;
+uint32_t ane_dsp_cycle_get(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_DSP_H__ */
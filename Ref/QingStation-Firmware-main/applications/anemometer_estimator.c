@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "stdlib.h"
+#include "math.h"
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_fft.h"
+#include "anemometer_estimator.h"
+
+// shape matching, the production path.
+static int shapematch_process(ane_est_ctx_t *ctx, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], int win[4][2],
+        ane_ch_result_t res[4])
+{
+    return ane_process_cycle(adc, sig_level, ctx->calib, win, ctx->mse_history, res, ctx->shape);
+}
+
+static const ane_estimator_t ane_est_shapematch = {
+        .name = "shapematch",
+        .process = shapematch_process,
+};
+
+// pulse compression, as the variants in unused/anemometer_pulse_compression*.c,
+// the band passed echo is correlated with the excitation pattern by FFT, the peak is refined by a parabola.
+// the delay between the peak and the time of flight is referenced to the shape matching.
+#define XCORR_BLOCK_LEN     (32)
+#define XCORR_PATTERN_MAX   (256)
+#define XCORR_MIN_QUALITY   (0.5f)  // normalized correlation of the peak
+
+typedef struct _xcorr_data_t
+{
+    ane_xcorr_t xc;
+    float pattern[XCORR_PATTERN_MAX];
+    uint32_t pattern_len;
+    float pattern_energy;
+    float sig[ADC_SAMPLE_LEN];      // band passed, from DEADZONE_OFFSET
+    float work[ANE_FFT_LEN];
+    float offset[4];                // time of flight - peak
+    float ref[ANE_EST_REF_CYCLES][4];
+    int ref_num;
+} xcorr_data_t;
+
+static int xcorr_init(ane_est_ctx_t *ctx)
+{
+    xcorr_data_t *d;
+    uint32_t len = get_pattern_len(pulse_len - 1, PULSE_FREQ);
+    if(len > XCORR_PATTERN_MAX || len >= VALID_LEN)
+        return -1;
+    d = malloc(sizeof(xcorr_data_t));
+    if(!d)
+        return -1;
+    memset(d, 0, sizeof(xcorr_data_t));
+    create_pattern2(&cpulse[1], pulse_len - 1, d->pattern, PULSE_FREQ, 1); // ignore first L
+    d->pattern_len = len;
+    for(int i=0; i<len; i++)
+        d->pattern_energy += d->pattern[i] * d->pattern[i];
+    if(ane_xcorr_init(&d->xc, d->pattern, len))
+    {
+        free(d);
+        return -1;
+    }
+    ctx->priv = d;
+    return 0;
+}
+
+static void xcorr_deinit(ane_est_ctx_t *ctx)
+{
+    free(ctx->priv);
+    ctx->priv = NULL;
+}
+
+static float dot(const float *a, const float *b, int len)
+{
+    float sum = 0;
+    for(int i=0; i<len; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+// peak of the correlation in the capture, relative to the start of the capture. return the quality, 0 = no peak.
+static float xcorr_peak(xcorr_data_t *d, uint16_t *raw, float zero_level, float *peak)
+{
+    float x[XCORR_BLOCK_LEN];
+    float y[XCORR_BLOCK_LEN];
+    ane_filter_state_t st;
+    int len = VALID_LEN;
+    int pl = d->pattern_len;
+
+    // the filter runs from the beginning, same as the full window of the shape matching.
+    ane_filter_reset(&st);
+    for(int n=0; n<ADC_SAMPLE_LEN; n+=XCORR_BLOCK_LEN)
+    {
+        int blk = MIN(XCORR_BLOCK_LEN, ADC_SAMPLE_LEN - n);
+        preprocess(&raw[n], x, zero_level, blk);
+        ane_filter_block(&ane_bp_filter, &st, x, y, blk);
+        for(int b=0; b<blk; b++)
+            if(n + b >= DEADZONE_OFFSET)
+                d->sig[n + b - DEADZONE_OFFSET] = y[b];
+    }
+
+    int p = ane_xcorr(&d->xc, d->sig, len, d->work, NULL);
+    if(p < 1 || p + 1 >= len - pl)
+        return 0;
+    float c0 = dot(d->pattern, &d->sig[p], pl);
+    float cm = dot(d->pattern, &d->sig[p-1], pl);
+    float cp = dot(d->pattern, &d->sig[p+1], pl);
+    float energy = dot(&d->sig[p], &d->sig[p], pl);
+    float den = cm - 2*c0 + cp;
+    *peak = DEADZONE_OFFSET + p + (den < 0 ? 0.5f * (cm - cp) / den : 0);
+    if(energy <= 0 || c0 <= 0)
+        return 0;
+    return c0 / sqrtf(energy * d->pattern_energy);
+}
+
+static int xcorr_process(ane_est_ctx_t *ctx, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], int win[4][2],
+        ane_ch_result_t res[4])
+{
+    xcorr_data_t *d = ctx->priv;
+    int err = NORMAL;
+    for(int ch=0; ch<4; ch++)
+    {
+        float peak;
+        memset(&res[ch], 0, sizeof(ane_ch_result_t));
+        res[ch].quality = xcorr_peak(d, adc[ch], sig_level[ch], &peak);
+        if(res[ch].quality <= 0)
+            continue; // dt stays 0
+        res[ch].dt = peak + d->offset[ch];
+        if(res[ch].quality < XCORR_MIN_QUALITY)
+        {
+            res[ch].err = ERR_SHAPE_MISMATCH;
+            err = ERR_SHAPE_MISMATCH;
+        }
+    }
+    return err;
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static int xcorr_reference(ane_est_ctx_t *ctx, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], float ref_dt[4])
+{
+    xcorr_data_t *d = ctx->priv;
+    float peak[4];
+    for(int ch=0; ch<4; ch++)
+        if(xcorr_peak(d, adc[ch], sig_level[ch], &peak[ch]) < XCORR_MIN_QUALITY)
+            return ANE_EST_REF_CYCLES - d->ref_num;
+    for(int ch=0; ch<4; ch++)
+        d->ref[d->ref_num][ch] = ref_dt[ch] - peak[ch];
+    d->ref_num++;
+    if(d->ref_num < ANE_EST_REF_CYCLES)
+        return ANE_EST_REF_CYCLES - d->ref_num;
+
+    // median, a cycle slip of one of them does not move it.
+    for(int ch=0; ch<4; ch++)
+    {
+        float v[ANE_EST_REF_CYCLES];
+        for(int i=0; i<ANE_EST_REF_CYCLES; i++)
+            v[i] = d->ref[i][ch];
+        qsort(v, ANE_EST_REF_CYCLES, sizeof(float), cmp_float);
+        d->offset[ch] = (v[ANE_EST_REF_CYCLES/2 - 1] + v[ANE_EST_REF_CYCLES/2]) / 2;
+    }
+    d->ref_num = 0;
+    return 0;
+}
+
+static const ane_estimator_t ane_est_xcorr = {
+        .name = "xcorr",
+        .init = xcorr_init,
+        .deinit = xcorr_deinit,
+        .reference = xcorr_reference,
+        .process = xcorr_process,
+};
+
+static const ane_estimator_t *estimators[ANE_EST_TYPE_NUM] = {
+        &ane_est_shapematch,
+        &ane_est_xcorr,
+};
+
+const ane_estimator_t* ane_est_get(int type)
+{
+    if(type < 0 || type >= ANE_EST_TYPE_NUM)
+        return NULL;
+    return estimators[type];
+}
+
+const char* ane_est_name(int type)
+{
+    const ane_estimator_t *est = ane_est_get(type);
+    return est ? est->name : "none";
+}
+
+int ane_est_init(ane_est_ctx_t *ctx, const ane_estimator_t *est, ane_calib_t *calib)
+{
+    memset(ctx, 0, sizeof(ane_est_ctx_t));
+    ctx->calib = calib;
+    if(est->init)
+        return est->init(ctx);
+    return 0;
+}
+
+void ane_est_deinit(ane_est_ctx_t *ctx, const ane_estimator_t *est)
+{
+    if(est->deinit)
+        est->deinit(ctx);
+}
+
+int ane_est_reference(ane_est_ctx_t *ctx, const ane_estimator_t *est, uint16_t adc[][ADC_SAMPLE_LEN])
+{
+    ane_baseline_t baseline[4] = {0};
+    ane_ch_result_t res[4];
+    float sig_level[4];
+    float mse_history[4] = {0};
+    float dt[4];
+    if(!est->reference)
+        return 0;
+
+    for(int i=0; i<ANE_EST_REF_TRIES; i++)
+    {
+        ane_measure_cycle(adc, baseline, sig_level);
+        if(ane_process_cycle(adc, sig_level, ctx->calib, NULL, mse_history, res, NULL) != NORMAL)
+            continue;
+        for(int ch=0; ch<4; ch++)
+            dt[ch] = res[ch].dt;
+        if(dt[NORTH] == 0 || dt[EAST] == 0 || dt[SOUTH] == 0 || dt[WEST] == 0)
+            continue;
+        if(est->reference(ctx, adc, sig_level, dt) == 0)
+            return 0;
+    }
+    return -1;
+}
+
+void ane_shadow_reset(ane_shadow_t *sh)
+{
+    memset(sh, 0, sizeof(ane_shadow_t));
+}
+
+static bool is_cycle_valid(ane_ch_result_t res[4])
+{
+    for(int ch=0; ch<4; ch++)
+        if(res[ch].err != NORMAL || res[ch].dt == 0)
+            return false;
+    return true;
+}
+
+void ane_shadow_update(ane_shadow_t *sh, ane_ch_result_t primary[4], ane_ch_result_t shadow[4],
+        float cost_primary, float cost_shadow)
+{
+    sh->runs++;
+    sh->cost[0] += (cost_primary - sh->cost[0]) / sh->runs;
+    sh->cost[1] += (cost_shadow - sh->cost[1]) / sh->runs;
+    sh->cost_max[0] = MAX(sh->cost_max[0], cost_primary);
+    sh->cost_max[1] = MAX(sh->cost_max[1], cost_shadow);
+
+    if(!is_cycle_valid(primary))
+        return;
+    if(!is_cycle_valid(shadow))
+    {
+        sh->missed++;
+        return;
+    }
+    sh->cycles++;
+    bool is_disagree = false;
+    for(int ch=0; ch<4; ch++)
+    {
+        float diff = shadow[ch].dt - primary[ch].dt;
+        sh->diff_mean[ch] += (diff - sh->diff_mean[ch]) / sh->cycles;
+        sh->diff_sq[ch] += (diff * diff - sh->diff_sq[ch]) / sh->cycles;
+        sh->max_diff = MAX(sh->max_diff, fabsf(diff));
+        if(fabsf(diff) > ANE_SHADOW_TOL)
+            is_disagree = true;
+    }
+    if(is_disagree)
+        sh->disagree++;
+}
+
+float ane_shadow_rms(ane_shadow_t *sh)
+{
+    return sqrtf((sh->diff_sq[NORTH] + sh->diff_sq[EAST] + sh->diff_sq[SOUTH] + sh->diff_sq[WEST]) / 4);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_ESTIMATOR_H__
+#define __ANEMOMETER_ESTIMATOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time of flight estimators.
+// An estimator turns the captures of a cycle to the time of flight of each channel, res[].dt and res[].quality.
+// The shape matching is the reference, the others are referenced to its time of flight on boot,
+// so a constant delay of their own (filter, pattern) does not matter.
+// A second estimator can run in shadow on the same captures, to compare the cost and the result.
+
+typedef enum {
+    ANE_EST_SHAPEMATCH = 0, // shape of the echo peaks + zero crossings, the calibrated one.
+    ANE_EST_XCORR,          // pulse compression, correlation with the excitation pattern.
+    ANE_EST_TYPE_NUM
+} ane_est_type_t;
+
+#define ANE_EST_NONE            (-1)    // no shadow estimator
+#define ANE_EST_REF_CYCLES      (8)     // cycles to reference an estimator to the shape matching.
+#define ANE_EST_REF_TRIES       (20)    // measurements at most to collect the cycles.
+
+typedef struct _ane_est_ctx_t
+{
+    ane_calib_t *calib;         // calibration of the station, shared.
+    float mse_history[4];       // shape matching abnormal checking
+    float shape[4][PEAK_LEN];   // echo shape of the last cycle aligned to the reference, shape matching only
+    void *priv;                 // data of the estimator
+} ane_est_ctx_t;
+
+typedef struct _ane_estimator_t
+{
+    const char *name;
+    // allocate the data of the estimator. return 0 if succeed.
+    int  (*init)(ane_est_ctx_t *ctx);
+    void (*deinit)(ane_est_ctx_t *ctx);
+    // a cycle with the time of flight from the shape matching, return the cycles still needed. NULL = not needed.
+    int  (*reference)(ane_est_ctx_t *ctx, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], float ref_dt[4]);
+    // captures to time of flight. win is the same as ane_process_cycle(), an estimator may search the full window.
+    // return the last error.
+    int  (*process)(ane_est_ctx_t *ctx, uint16_t adc[][ADC_SAMPLE_LEN], float sig_level[4], int win[4][2],
+            ane_ch_result_t res[4]);
+} ane_estimator_t;
+
+// NULL if not supported.
+const ane_estimator_t* ane_est_get(int type);
+const char* ane_est_name(int type);
+
+// init the context and the estimator, return 0 if succeed.
+int  ane_est_init(ane_est_ctx_t *ctx, const ane_estimator_t *est, ane_calib_t *calib);
+void ane_est_deinit(ane_est_ctx_t *ctx, const ane_estimator_t *est);
+// measure and reference the estimator to the shape matching. return 0 if succeed.
+int  ane_est_reference(ane_est_ctx_t *ctx, const ane_estimator_t *est, uint16_t adc[][ADC_SAMPLE_LEN]);
+
+// comparison of a shadow estimator to the primary one.
+#define ANE_SHADOW_TOL      (2.0f)  // us, time of flight difference counted as disagreement.
+
+typedef struct _ane_shadow_t
+{
+    uint32_t cycles;        // cycles compared, both have all the channels.
+    uint32_t missed;        // cycles only the primary has all the channels.
+    uint32_t disagree;      // cycles with a channel differs more than ANE_SHADOW_TOL
+    float diff_mean[4];     // mean and mean square of shadow - primary, us
+    float diff_sq[4];
+    float max_diff;
+    float cost[2];          // average cost of primary and shadow, us
+    float cost_max[2];
+    uint32_t runs;
+} ane_shadow_t;
+
+void ane_shadow_reset(ane_shadow_t *sh);
+// cost in us.
+void ane_shadow_update(ane_shadow_t *sh, ane_ch_result_t primary[4], ane_ch_result_t shadow[4],
+        float cost_primary, float cost_shadow);
+// root mean square of the difference of all channels, us.
+float ane_shadow_rms(ane_shadow_t *sh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_ESTIMATOR_H__ */
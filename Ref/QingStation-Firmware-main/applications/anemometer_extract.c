@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "stdlib.h"
+#include "math.h"
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_extract.h"
+
+#define IS_SIGN_DIFF(a, b) (!(signbit(a) == signbit(b)))
+
+// A turning point is where the slope changes its sign, sig[i]-sig[i-1] vs sig[i+1]-sig[i].
+// find_next_turning() and find_prev_turning() both skip the 2 samples next to the start,
+// so the next turning point of p is the first one >= p+3, the previous one is the last one <= p-3.
+
+// The left side of a maximum is only searched when it is still the maximum after a few more turning points,
+// or at the end of the pass, the maximum is replaced many times on the rising edge of the echo.
+// The rings are twice the size kept for a peak, so they are not overwritten before the search.
+#define TURN_RING   (EXTRACT_TURN_LEN * 2)
+#define ZC_RING     (EXTRACT_ZC_LEN * 2)
+
+// working states of the pass, not needed after.
+typedef struct _extract_state_t
+{
+    float turn[TURN_RING][2];       // ring of the last turning points
+    uint32_t turn_num;
+    float zc[ZC_RING][3];           // ring of the last zero crossings
+    uint32_t zc_num;
+    uint32_t turn_at_peak;          // number of turning points and crossings when the maximum is found.
+    uint32_t zc_at_peak;
+    bool is_pending;                // the left side of the maximum is not searched yet.
+    int next_turn;                  // the right side search takes the next turning point from here
+    bool right_stop;                // right side search is out of range.
+} extract_state_t;
+
+// search the left side of the maximum in the history.
+static void resolve_peak(ane_features_t *ft, extract_state_t *es)
+{
+    int max_distance_left = 25 * (PEAK_LEFT + 2);
+    uint32_t oldest = es->turn_at_peak > EXTRACT_TURN_LEN ? es->turn_at_peak - EXTRACT_TURN_LEN : 0;
+    uint32_t k = es->turn_at_peak;
+    int p = ft->max_idx;
+
+    ft->left_len = 0;
+    while(ft->left_len < PEAK_LEFT)
+    {
+        while(k > oldest && es->turn[(k-1) % TURN_RING][0] > p - 3)
+            k--;
+        if(k == oldest) // no more, or it is not kept.
+            break;
+        float *tp = es->turn[(k-1) % TURN_RING];
+        if(tp[0] < 2 || ft->max_idx - tp[0] > max_distance_left)
+            break;
+        ft->left[ft->left_len][0] = tp[0];
+        ft->left[ft->left_len][1] = tp[1];
+        ft->left_len++;
+        p = tp[0];
+        k--;
+    }
+
+    // crossings before the peak, in order.
+    uint32_t n = MIN(es->zc_at_peak, EXTRACT_ZC_LEN);
+    uint32_t first = es->zc_at_peak - n;
+    for(uint32_t i=0; i<n; i++)
+        memcpy(ft->zc_before[i], es->zc[(first + i) % ZC_RING], sizeof(ft->zc_before[i]));
+    ft->zc_before_len = n;
+    ft->zc_lost = first > 0 ? es->zc[(first - 1) % ZC_RING][0] : -1;
+    es->is_pending = false;
+}
+
+// a new maximum, restart the right side.
+static void new_peak(ane_features_t *ft, extract_state_t *es, int idx, float val)
+{
+    ft->max_idx = idx;
+    ft->max_val = val;
+    ft->right_len = 0;
+    ft->zc_after_len = 0;
+    ft->zc_after_full = false;
+    es->next_turn = idx + 3;
+    es->right_stop = false;
+    es->turn_at_peak = es->turn_num;
+    es->zc_at_peak = es->zc_num;
+    es->is_pending = true;
+}
+
+static void new_turning(ane_features_t *ft, extract_state_t *es, int idx, float val)
+{
+    int max_distance_right = 25 * (PEAK_RIGHT + 2);
+    if(es->is_pending && es->turn_num - es->turn_at_peak >= TURN_RING - EXTRACT_TURN_LEN)
+        resolve_peak(ft, es);
+    float *tp = es->turn[es->turn_num % TURN_RING];
+    tp[0] = idx;
+    tp[1] = val;
+    es->turn_num++;
+
+    if(es->right_stop || ft->right_len >= PEAK_RIGHT || idx < es->next_turn)
+        return;
+    if(idx - ft->max_idx > max_distance_right)
+    {
+        es->right_stop = true;
+        return;
+    }
+    ft->right[ft->right_len][0] = idx;
+    ft->right[ft->right_len][1] = val;
+    ft->right_len++;
+    es->next_turn = idx + 3;
+}
+
+static void new_zerocross(ane_features_t *ft, extract_state_t *es, int idx, float v0, float v1)
+{
+    if(es->is_pending && es->zc_num - es->zc_at_peak >= ZC_RING - EXTRACT_ZC_LEN - 1)
+        resolve_peak(ft, es);
+    float *zc = es->zc[es->zc_num % ZC_RING];
+    zc[0] = idx;
+    zc[1] = v0;
+    zc[2] = v1;
+    es->zc_num++;
+
+    if(idx < ft->max_idx)
+        return;
+    if(ft->zc_after_len >= EXTRACT_ZC_LEN)
+    {
+        ft->zc_after_full = true;
+        return;
+    }
+    memcpy(ft->zc_after[ft->zc_after_len], zc, sizeof(ft->zc_after[0]));
+    ft->zc_after_len++;
+}
+
+void ane_extract(uint16_t *raw, float zero_level, int filter_start, int start, int len, ane_features_t *ft)
+{
+    float x[EXTRACT_BLOCK_LEN];
+    float y[EXTRACT_BLOCK_LEN];
+    ane_filter_state_t flt_state;
+    static extract_state_t es; // ~1KB, off the stack of the anemometer thread, the only caller.
+    float y1 = 0, y2 = 0; // sig[j-1], sig[j-2]
+    float min_val = 0;
+    int stop = start + len;
+
+    memset(ft, 0, sizeof(ane_features_t));
+    memset(&es, 0, sizeof(es));
+    ane_filter_reset(&flt_state);
+
+    // the filter settles before the window.
+    for(int n=filter_start; n<start; n+=EXTRACT_BLOCK_LEN)
+    {
+        int blk = MIN(EXTRACT_BLOCK_LEN, start - n);
+        preprocess(&raw[n], x, zero_level, blk);
+        ane_filter_block(&ane_bp_filter, &flt_state, x, y, blk);
+    }
+
+    for(int n=start; n<stop; n+=EXTRACT_BLOCK_LEN)
+    {
+        int blk = MIN(EXTRACT_BLOCK_LEN, stop - n);
+        preprocess(&raw[n], x, zero_level, blk);
+        ane_filter_block(&ane_bp_filter, &flt_state, x, y, blk);
+
+        for(int b=0; b<blk; b++)
+        {
+            int j = n + b - start; // index in the window
+            float v = y[b];
+            min_val = MIN(v, min_val);
+            if(j >= 1 && (y1 == 0 || y1 * v < 0))
+                new_zerocross(ft, &es, j-1, y1, v);
+            if(j >= 2 && IS_SIGN_DIFF(y1 - y2, v - y1))
+                new_turning(ft, &es, j-1, y1);
+            if(j == 0 || v > ft->max_val)
+                new_peak(ft, &es, j, v);
+            y2 = y1;
+            y1 = v;
+        }
+    }
+    if(es.is_pending)
+        resolve_peak(ft, &es);
+    // same as normalize(), which takes the integer part of the absolute value.
+    ft->scale = MAX(abs((int)ft->max_val), abs((int)min_val));
+}
+
+int ane_features_shape(ane_features_t *ft, float peaks[][2], float threshold)
+{
+    int peak_detected_len = 0;
+    int peak_idx;
+    int prev_peak;
+    threshold = ft->max_val / ft->scale * threshold;
+
+    // main peak
+    peak_idx = PEAK_LEFT;
+    peaks[peak_idx][0] = ft->max_idx;
+    peaks[peak_idx][1] = ft->max_val / ft->scale;
+    peak_detected_len ++;
+
+    // right
+    peak_idx = PEAK_LEFT + 1;
+    prev_peak = 0;
+    for(int i=0; i<ft->right_len; i++)
+    {
+        int idx = ft->right[i][0];
+        float v = ft->right[i][1] / ft->scale;
+        if(fabs(v) >= threshold && fabs(prev_peak - idx) >= MINI_PEAK_DISTANCE)
+        {
+            peaks[peak_idx][0] = idx;
+            peaks[peak_idx][1] = v;
+            peak_idx ++;
+            peak_detected_len ++;
+            prev_peak = idx;
+        }
+    }
+
+    // left, prev_peak is updated with the peak number as capture_peaks() does.
+    peak_idx = PEAK_LEFT - 1;
+    for(int i=0; i<ft->left_len && peak_idx>=0; i++)
+    {
+        int idx = ft->left[i][0];
+        float v = ft->left[i][1] / ft->scale;
+        if(fabs(v) >= threshold && fabs(prev_peak - idx) >= MINI_PEAK_DISTANCE)
+        {
+            peaks[peak_idx][0] = idx;
+            peaks[peak_idx][1] = v;
+            peak_idx --;
+            peak_detected_len ++;
+            prev_peak = peak_idx;
+        }
+    }
+    return peak_detected_len;
+}
+
+int ane_features_zerocross(ane_features_t *ft, int off, float *out, int num)
+{
+    int cross = 0;
+    int total = ft->zc_before_len + ft->zc_after_len;
+    if(ft->zc_lost >= off)
+        return -1;
+
+    for(int k=0; k<total && cross<num; k++)
+    {
+        float *zc = k < ft->zc_before_len ? ft->zc_before[k] : ft->zc_after[k - ft->zc_before_len];
+        if(zc[0] < off)
+            continue;
+        uint32_t i = (int)zc[0] - off;
+        float s0 = zc[1] / ft->scale;
+        float s1 = zc[2] / ft->scale;
+        if(s0 == 0)
+            out[cross] = i;
+        else
+        {
+            // y=ax+b, x2 - x1 = 1
+            float a = s1 - s0;
+            float b = s0;
+            float x = -b/a;
+            out[cross] = x + i;
+        }
+        cross++;
+    }
+    if(cross < num && ft->zc_after_full)
+        return -1;
+    return cross;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_EXTRACT_H__
+#define __ANEMOMETER_EXTRACT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Single pass feature extractor of an echo.
+// The raw ADC samples are converted, filtered and searched in one pass, block by block,
+// only the turning points and zero crossings around the main peak are kept.
+// The result is the same as preprocess() -> filter -> normalize() -> capture_peaks() -> linear_interpolation_zerocrossing()
+// but without the float copies of the capture.
+// It is not faster: the filter and the searches cost the same, the block loop adds a little, host/ane_extract_bench
+// measures it from ~5% faster to ~15% slower than the buffered chain on the full window. The gain is the RAM,
+// 8000 bytes of float buffers to ~1.7KB of stack.
+
+#define EXTRACT_BLOCK_LEN   (32)    // samples converted and filtered at a time.
+#define EXTRACT_TURN_LEN    (32)    // turning points kept for the search on the left of the main peak, >= 3*PEAK_LEFT
+#define EXTRACT_ZC_LEN      (16)    // zero crossings kept on each side of the main peak.
+
+typedef struct _ane_features_t
+{
+    float scale;                    // normalization, same as normalize()
+    int   max_idx;                  // main peak, index in the window
+    float max_val;
+    float left[PEAK_LEFT][2];       // turning points before the main peak, nearest first. [0]=index, [1]=value
+    int   left_len;
+    float right[PEAK_RIGHT][2];     // turning points after the main peak
+    int   right_len;
+    float zc_before[EXTRACT_ZC_LEN][3]; // zero crossings before the main peak, [0]=i, [1]=sig[i], [2]=sig[i+1]
+    int   zc_before_len;
+    int   zc_lost;                  // index of the last crossing dropped before the main peak, -1 = none
+    float zc_after[EXTRACT_ZC_LEN][3];  // zero crossings from the main peak
+    int   zc_after_len;
+    bool  zc_after_full;
+} ane_features_t;
+
+// filter from filter_start, search the window [start, start+len). indexes of the features are relative to start.
+void ane_extract(uint16_t *raw, float zero_level, int filter_start, int start, int len, ane_features_t *ft);
+
+// shape of the echo, same as capture_peaks(sig, len, peaks, PEAK_LEFT, PEAK_RIGHT, threshold). return number of peaks.
+int ane_features_shape(ane_features_t *ft, float peaks[][2], float threshold);
+
+// zero crossings from index off, same as linear_interpolation_zerocrossing(&sig[off], len-off, out, num).
+// return the number of crossings, -1 if the crossings after off were not kept.
+int ane_features_zerocross(ane_features_t *ft, int off, float *out, int num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_EXTRACT_H__ */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_fft.h"
+
+#define CFFT_LEN    (ANE_FFT_LEN / 2)   // complex points
+#define PI_D        (3.14159265358979323846)
+
+// twiddle of the complex fft, W_M^k = exp(-2*pi*i*k/M), k < 3M/4 (radix-4 uses k, 2k, 3k)
+static float cfft_twiddle[CFFT_LEN * 3 / 4][2];
+// twiddle of the real split step, W_N^k, k <= N/4
+static float rfft_twiddle[ANE_FFT_LEN / 4 + 1][2];
+// bit reversal swap pairs
+static uint16_t bitrev_table[CFFT_LEN][2];
+static uint32_t bitrev_num = 0;
+static uint32_t log2_len = 0;
+
+int ane_rfft_init(void)
+{
+    uint32_t bits = 0;
+    if(bitrev_num)
+        return 0;
+    while((1UL << bits) < CFFT_LEN)
+        bits++;
+    if((1UL << bits) != CFFT_LEN)
+        return -1;
+    log2_len = bits;
+
+    for(int k=0; k<CFFT_LEN * 3 / 4; k++)
+    {
+        cfft_twiddle[k][0] = cos(2 * PI_D * k / CFFT_LEN);
+        cfft_twiddle[k][1] = -sin(2 * PI_D * k / CFFT_LEN);
+    }
+    for(int k=0; k<=ANE_FFT_LEN / 4; k++)
+    {
+        rfft_twiddle[k][0] = cos(2 * PI_D * k / ANE_FFT_LEN);
+        rfft_twiddle[k][1] = -sin(2 * PI_D * k / ANE_FFT_LEN);
+    }
+    for(uint32_t i=0; i<CFFT_LEN; i++)
+    {
+        uint32_t r = 0;
+        for(uint32_t b=0; b<bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        if(r > i)
+        {
+            bitrev_table[bitrev_num][0] = i;
+            bitrev_table[bitrev_num][1] = r;
+            bitrev_num++;
+        }
+    }
+    return 0;
+}
+
+// complex fft, in place, forward. x[k][0] = re, x[k][1] = im
+// decimation in time, bit reversed input.
+// a radix-2 stage first if log2(M) is odd, then radix-4 stages (two radix-2 stages fused, 3 complex mult).
+static void cfft(float (*x)[2])
+{
+    uint32_t h, j, k;
+    float tmp;
+
+    for(uint32_t i=0; i<bitrev_num; i++)
+    {
+        float *a = x[bitrev_table[i][0]];
+        float *b = x[bitrev_table[i][1]];
+        tmp = a[0]; a[0] = b[0]; b[0] = tmp;
+        tmp = a[1]; a[1] = b[1]; b[1] = tmp;
+    }
+
+    h = 1;
+    if(log2_len & 1)
+    {
+        for(k=0; k<CFFT_LEN; k+=2)
+        {
+            float r = x[k+1][0], i = x[k+1][1];
+            x[k+1][0] = x[k][0] - r;
+            x[k+1][1] = x[k][1] - i;
+            x[k][0] += r;
+            x[k][1] += i;
+        }
+        h = 2;
+    }
+
+    for(; h<CFFT_LEN; h*=4)
+    {
+        uint32_t stride = CFFT_LEN / (4 * h); // W_4h^j = W_M^(j*stride)
+        for(j=0; j<h; j++)
+        {
+            float w1r = cfft_twiddle[2*j*stride][0], w1i = cfft_twiddle[2*j*stride][1];
+            float w2r = cfft_twiddle[j*stride][0],   w2i = cfft_twiddle[j*stride][1];
+            float w3r = cfft_twiddle[3*j*stride][0], w3i = cfft_twiddle[3*j*stride][1];
+            for(k=j; k<CFFT_LEN; k+=4*h)
+            {
+                float *x0 = x[k], *x1 = x[k+h], *x2 = x[k+2*h], *x3 = x[k+3*h];
+                // t1 = W^2j * x1, t2 = W^j * x2, t3 = W^3j * x3
+                float t1r = w1r * x1[0] - w1i * x1[1], t1i = w1r * x1[1] + w1i * x1[0];
+                float t2r = w2r * x2[0] - w2i * x2[1], t2i = w2r * x2[1] + w2i * x2[0];
+                float t3r = w3r * x3[0] - w3i * x3[1], t3i = w3r * x3[1] + w3i * x3[0];
+                float a0r = x0[0] + t1r, a0i = x0[1] + t1i;
+                float a1r = x0[0] - t1r, a1i = x0[1] - t1i;
+                float sr = t2r + t3r, si = t2i + t3i;
+                float dr = t2r - t3r, di = t2i - t3i;
+                x0[0] = a0r + sr;   x0[1] = a0i + si;
+                x2[0] = a0r - sr;   x2[1] = a0i - si;
+                x1[0] = a1r + di;   x1[1] = a1i - dr;   // a1 - i*d
+                x3[0] = a1r - di;   x3[1] = a1i + dr;   // a1 + i*d
+            }
+        }
+    }
+}
+
+static void cifft(float (*x)[2])
+{
+    // ifft(x) = conj(fft(conj(x))), scaling is done by the caller.
+    for(int k=0; k<CFFT_LEN; k++)
+        x[k][1] = -x[k][1];
+    cfft(x);
+    for(int k=0; k<CFFT_LEN; k++)
+        x[k][1] = -x[k][1];
+}
+
+void ane_rfft(float *buf)
+{
+    float (*z)[2] = (float (*)[2])buf;
+    // even samples as real, odd as imaginary.
+    cfft(z);
+
+    // split, X[k] = E + W^k*O, X[M-k] = conj(E - W^k*O)
+    // E = (Z[k] + conj(Z[M-k]))/2, O = -i(Z[k] - conj(Z[M-k]))/2
+    float z0r = z[0][0], z0i = z[0][1];
+    buf[0] = z0r + z0i;     // X[0]
+    buf[1] = z0r - z0i;     // X[M]
+    for(uint32_t k=1; k<=CFFT_LEN/2; k++)
+    {
+        uint32_t m = CFFT_LEN - k;
+        float er = (z[k][0] + z[m][0]) * 0.5f;
+        float ei = (z[k][1] - z[m][1]) * 0.5f;
+        float or = (z[k][1] + z[m][1]) * 0.5f;
+        float oi = -(z[k][0] - z[m][0]) * 0.5f;
+        float wr = rfft_twiddle[k][0], wi = rfft_twiddle[k][1];
+        float tr = wr * or - wi * oi;
+        float ti = wr * oi + wi * or;
+        z[k][0] = er + tr;
+        z[k][1] = ei + ti;
+        if(m != k)
+        {
+            z[m][0] = er - tr;
+            z[m][1] = -(ei - ti);
+        }
+    }
+}
+
+void ane_irfft(float *buf)
+{
+    float (*z)[2] = (float (*)[2])buf;
+    float x0 = buf[0], xm = buf[1];
+    float scale = 2.0f / ANE_FFT_LEN;
+
+    // merge, E = (X[k] + conj(X[M-k]))/2, W^k*O = (X[k] - conj(X[M-k]))/2, Z[k] = E + i*O
+    z[0][0] = (x0 + xm) * 0.5f;
+    z[0][1] = (x0 - xm) * 0.5f;
+    for(uint32_t k=1; k<=CFFT_LEN/2; k++)
+    {
+        uint32_t m = CFFT_LEN - k;
+        float xkr = z[k][0], xki = z[k][1];
+        float xmr = z[m][0], xmi = z[m][1];
+        float wr = rfft_twiddle[k][0], wi = rfft_twiddle[k][1];
+        // for Z[k]
+        float er = (xkr + xmr) * 0.5f, ei = (xki - xmi) * 0.5f;
+        float dr = (xkr - xmr) * 0.5f, di = (xki + xmi) * 0.5f;
+        float or = wr * dr + wi * di;   // conj(W^k) * d
+        float oi = wr * di - wi * dr;
+        z[k][0] = er - oi;
+        z[k][1] = ei + or;
+        if(m != k)
+        {
+            // Z[M-k] = conj(E) + i*conj(O)
+            z[m][0] = er + oi;
+            z[m][1] = -ei + or;
+        }
+    }
+    cifft(z);
+    // ifft of M points is scaled by 1/M = 2/N
+    for(int i=0; i<ANE_FFT_LEN; i++)
+        buf[i] *= scale;
+}
+
+int ane_xcorr_init(ane_xcorr_t *xc, const float *pattern, uint32_t pattern_len)
+{
+    if(pattern_len == 0 || pattern_len >= ANE_FFT_LEN || ane_rfft_init())
+        return -1;
+    memset(xc->spectrum, 0, sizeof(xc->spectrum));
+    memcpy(xc->spectrum, pattern, pattern_len * sizeof(float));
+    ane_rfft(xc->spectrum);
+    xc->pattern_len = pattern_len;
+    return 0;
+}
+
+uint32_t ane_xcorr(const ane_xcorr_t *xc, const float *signal, uint32_t signal_len, float *work, float *output)
+{
+    const float *p = xc->spectrum;
+    float max = 0;
+    uint32_t idx = 0;
+
+    if(signal_len > ANE_FFT_LEN)
+        signal_len = ANE_FFT_LEN;
+    if(signal_len <= xc->pattern_len)
+        return 0;
+    memcpy(work, signal, signal_len * sizeof(float));
+    memset(&work[signal_len], 0, (ANE_FFT_LEN - signal_len) * sizeof(float));
+    ane_rfft(work);
+
+    // S * conj(P)
+    work[0] *= p[0];
+    work[1] *= p[1];
+    for(int k=2; k<ANE_FFT_LEN; k+=2)
+    {
+        float sr = work[k], si = work[k+1];
+        work[k]   = sr * p[k] + si * p[k+1];
+        work[k+1] = si * p[k] - sr * p[k+1];
+    }
+    ane_irfft(work);
+
+    // only the positive lags are used, they do not wrap around as the signal is zero padded to N.
+    for(uint32_t i=0; i<signal_len - xc->pattern_len; i++)
+    {
+        if(output)
+            output[i] = work[i];
+        if(work[i] > max)
+        {
+            max = work[i];
+            idx = i;
+        }
+    }
+    return idx;
+}
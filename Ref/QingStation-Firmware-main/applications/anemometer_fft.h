@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_FFT_H__
+#define __ANEMOMETER_FFT_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Real FFT and frequency domain cross-correlation (pulse compression).
+// The real FFT of N points is done by a complex radix-2/4 FFT of N/2 points plus a split step.
+// N must be a power of 2 and hold a full capture (ADC_SAMPLE_LEN).
+#define ANE_FFT_LEN     (1024)
+
+// spectrum layout (same as CMSIS arm_rfft_fast_f32):
+// buf[0] = X[0].re, buf[1] = X[N/2].re, buf[2k] = X[k].re, buf[2k+1] = X[k].im, k = 1 ~ N/2-1
+int  ane_rfft_init(void);   // build the twiddle tables, called once. return 0 if succeed.
+void ane_rfft(float *buf);  // in place, N real -> spectrum
+void ane_irfft(float *buf); // in place, spectrum -> N real, scaled by 1/N
+
+// cached spectrum of a reference pattern
+typedef struct _ane_xcorr_t
+{
+    float spectrum[ANE_FFT_LEN];
+    uint32_t pattern_len;
+} ane_xcorr_t;
+
+// pattern_len < ANE_FFT_LEN. return 0 if succeed.
+int ane_xcorr_init(ane_xcorr_t *xc, const float *pattern, uint32_t pattern_len);
+
+// same output as match_filter(): output[i] = sum(pattern[j] * signal[i+j]), i = 0 ~ signal_len-pattern_len-1
+// signal_len <= ANE_FFT_LEN. work is a buffer of ANE_FFT_LEN floats, output can be NULL.
+// return the index of the maximum.
+uint32_t ane_xcorr(const ane_xcorr_t *xc, const float *signal, uint32_t signal_len, float *work, float *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_FFT_H__ */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+
+// generated by tools/filter_design.py, {b0, b1, b2, a1, a2} per section, a0 = 1
+#define SOS_40K_2K_BP_1ORDER {{0.00624403526,0,-0.00624403526,-1.92510859,0.98751193}}
+#define SOS_40K_2K_BP_2ORDER {{0.00080387657,0.00160775314,0.00080387657,-1.9262503,0.991001157},{0.0486768825,-0.0973537651,0.0486768825,-1.93094573,0.991306058}}
+#define SOS_40K_10K_BP_1ORDER {{0.0304687733,0,-0.0304687733,-1.8790705,0.939062506}}
+#define SOS_40K_10K_BP_2ORDER {{0.00420012737,0.00840025474,0.00420012737,-1.88068937,0.952841969},{0.224919808,-0.449839617,0.224919808,-1.90950048,0.960259796}}
+
+static const float sos_order1[1][5] = SOS_40K_10K_BP_1ORDER;
+static const float sos_order2[2][5] = SOS_40K_10K_BP_2ORDER;
+static const float (*sos_table[ANE_SOS_MAX_ORDER])[5] = {sos_order1, sos_order2};
+
+#define Q31_COEFF_SHIFT (30)
+#define Q31_SIG_SHIFT   (15)    // 12bit ADC -> Q16.15, leave headroom for the transient
+#define Q15_COEFF_SHIFT (14)
+
+ane_filter_t ane_bp_filter = {0};
+
+static const char *filter_names[ANE_FILTER_TYPE_NUM] = {
+        "ba",
+        "sos_f32",
+        "sos_q31",
+        "sos_q15"
+};
+
+const char* ane_filter_name(int type)
+{
+    if(type < 0 || type >= ANE_FILTER_TYPE_NUM)
+        return "unknown";
+    return filter_names[type];
+}
+
+int ane_filter_init(ane_filter_t *flt, int type, int order)
+{
+    memset(flt, 0, sizeof(ane_filter_t));
+    if(type == ANE_FILTER_BA)
+        return 0;
+    if(type < 0 || type >= ANE_FILTER_TYPE_NUM || order < 1 || order > ANE_SOS_MAX_ORDER)
+        return -1;
+
+    const float (*sos)[5] = sos_table[order-1];
+    flt->type = type;
+    flt->sections = order;
+    for(int k=0; k<order; k++)
+    {
+        for(int j=0; j<5; j++)
+        {
+            if(type == ANE_FILTER_SOS_F32)
+                flt->coeff.f32[k][j] = sos[k][j];
+            else if(type == ANE_FILTER_SOS_Q31)
+                flt->coeff.q31[k][j] = (int32_t)lrint(sos[k][j] * (double)(1UL << Q31_COEFF_SHIFT));
+            else
+                flt->coeff.q15[k][j] = (int16_t)lrintf(sos[k][j] * (1 << Q15_COEFF_SHIFT));
+        }
+    }
+    return 0;
+}
+
+// One section per step, the section loop is expanded by the macros below so each section count has its
+// own straight inner loop with the states in registers.
+// f32: direct form II transposed, s[k][0..1] = states
+#define SOS_F32_STEP(k) { \
+    float out = c[k][0] * v + s[k][0]; \
+    s[k][0] = c[k][1] * v - c[k][3] * out + s[k][1]; \
+    s[k][1] = c[k][2] * v - c[k][4] * out; \
+    v = out; }
+
+// fixed point: direct form I, s[k][0..1] = x[n-1], x[n-2], s[k][2..3] = y[n-1], y[n-2]
+#define SOS_Q31_STEP(k) { \
+    int64_t acc = (int64_t)c[k][0] * v + (int64_t)c[k][1] * s[k][0] + (int64_t)c[k][2] * s[k][1] \
+                - (int64_t)c[k][3] * s[k][2] - (int64_t)c[k][4] * s[k][3]; \
+    s[k][1] = s[k][0]; s[k][0] = v; \
+    v = (int32_t)((acc + (1LL << (Q31_COEFF_SHIFT-1))) >> Q31_COEFF_SHIFT); \
+    s[k][3] = s[k][2]; s[k][2] = v; }
+
+#define SOS_Q15_STEP(k) { \
+    int32_t acc = c[k][0] * v + c[k][1] * s[k][0] + c[k][2] * s[k][1] \
+                - c[k][3] * s[k][2] - c[k][4] * s[k][3]; \
+    s[k][1] = s[k][0]; s[k][0] = v; \
+    v = (acc + (1 << (Q15_COEFF_SHIFT-1))) >> Q15_COEFF_SHIFT; \
+    s[k][3] = s[k][2]; s[k][2] = v; }
+
+#define SOS_STEPS_1(STEP)   STEP(0)
+#define SOS_STEPS_2(STEP)   STEP(0) STEP(1)
+
+#define DEFINE_SOS_F32(N) \
+static void sos_f32_##N(const float c[][5], float st[][2], const float *x, float *y, uint32_t len) \
+{ \
+    float s[N][2]; \
+    memcpy(s, st, sizeof(s)); \
+    for(uint32_t i=0; i<len; i++) { \
+        float v = x[i]; \
+        SOS_STEPS_##N(SOS_F32_STEP) \
+        y[i] = v; \
+    } \
+    memcpy(st, s, sizeof(s)); \
+}
+
+#define DEFINE_SOS_Q31(N) \
+static void sos_q31_##N(const int32_t c[][5], int32_t st[][4], const float *x, float *y, uint32_t len) \
+{ \
+    int32_t s[N][4]; \
+    memcpy(s, st, sizeof(s)); \
+    for(uint32_t i=0; i<len; i++) { \
+        int32_t v = (int32_t)(x[i] * (1 << Q31_SIG_SHIFT)); \
+        SOS_STEPS_##N(SOS_Q31_STEP) \
+        y[i] = v * (1.0f / (1 << Q31_SIG_SHIFT)); \
+    } \
+    memcpy(st, s, sizeof(s)); \
+}
+
+#define DEFINE_SOS_Q15(N) \
+static void sos_q15_##N(const int16_t c[][5], int32_t st[][4], const float *x, float *y, uint32_t len) \
+{ \
+    int32_t s[N][4]; \
+    memcpy(s, st, sizeof(s)); \
+    for(uint32_t i=0; i<len; i++) { \
+        int32_t v = (int32_t)x[i]; \
+        SOS_STEPS_##N(SOS_Q15_STEP) \
+        y[i] = v; \
+    } \
+    memcpy(st, s, sizeof(s)); \
+}
+
+DEFINE_SOS_F32(1)
+DEFINE_SOS_F32(2)
+DEFINE_SOS_Q31(1)
+DEFINE_SOS_Q31(2)
+DEFINE_SOS_Q15(1)
+DEFINE_SOS_Q15(2)
+
+typedef void (*sos_f32_func)(const float c[][5], float st[][2], const float *x, float *y, uint32_t len);
+typedef void (*sos_q31_func)(const int32_t c[][5], int32_t st[][4], const float *x, float *y, uint32_t len);
+typedef void (*sos_q15_func)(const int16_t c[][5], int32_t st[][4], const float *x, float *y, uint32_t len);
+
+static const sos_f32_func sos_f32[ANE_SOS_MAX_ORDER] = {sos_f32_1, sos_f32_2};
+static const sos_q31_func sos_q31[ANE_SOS_MAX_ORDER] = {sos_q31_1, sos_q31_2};
+static const sos_q15_func sos_q15[ANE_SOS_MAX_ORDER] = {sos_q15_1, sos_q15_2};
+
+// filter() with the history in the states, same output.
+static void ba_block(ane_filter_state_t *st, const float *x, float *y, uint32_t len)
+{
+    const int taps = bp_coeff_order*2+1;
+    float *hx = st->s.ba.x;
+    float *hy = st->s.ba.y;
+    for(uint32_t i=0; i<len; i++)
+    {
+        for(int c=taps-1; c>0; c--)
+        {
+            hx[c] = hx[c-1];
+            hy[c] = hy[c-1];
+        }
+        hx[0] = x[i];
+        hy[0] = 0;
+        if(st->s.ba.n < taps)
+            st->s.ba.n++;
+        else
+        {
+            for(int c=0; c < taps; c++)
+                hy[0] += bp_coeff[c][0] * hx[c] - bp_coeff[c][1] * hy[c];
+        }
+        y[i] = hy[0];
+    }
+}
+
+void ane_filter_reset(ane_filter_state_t *st)
+{
+    memset(st, 0, sizeof(ane_filter_state_t));
+}
+
+void ane_filter_block(const ane_filter_t *flt, ane_filter_state_t *st, const float *x, float *y, uint32_t len)
+{
+    switch(flt->type)
+    {
+    case ANE_FILTER_SOS_F32:
+        sos_f32[flt->sections-1](flt->coeff.f32, st->s.f32, x, y, len);
+        break;
+    case ANE_FILTER_SOS_Q31:
+        sos_q31[flt->sections-1](flt->coeff.q31, st->s.fix, x, y, len);
+        break;
+    case ANE_FILTER_SOS_Q15:
+        sos_q15[flt->sections-1](flt->coeff.q15, st->s.fix, x, y, len);
+        break;
+    default:
+        ba_block(st, x, y, len);
+        break;
+    }
+}
+
+void ane_filter_run(const ane_filter_t *flt, const float *x, float *y, uint32_t len)
+{
+    ane_filter_state_t st;
+    ane_filter_reset(&st);
+    ane_filter_block(flt, &st, x, y, len);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_FILTER_H__
+#define __ANEMOMETER_FILTER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Band pass filter of the echo, cascade of second-order sections (biquad).
+// Coefficients are generated by tools/filter_design.py (python filter_design.py sos)
+// Each section is scaled to unity gain at 40kHz, so the signal level stays the same through the cascade.
+
+#define ANE_SOS_MAX_ORDER    (2)    // the group delay of the 3rd order is longer than FILTER_GUARD_LEN and the peak window
+#define ANE_BA_MAX_TAPS      (7)    // the old direct form filter, up to 3rd order band pass
+
+typedef enum {
+    ANE_FILTER_BA = 0,      // the old direct form filter(), bp_coeff
+    ANE_FILTER_SOS_F32,     // float, direct form II transposed
+    ANE_FILTER_SOS_Q31,     // 32bit fixed point, direct form I, 64bit accumulator
+    ANE_FILTER_SOS_Q15,     // 16bit fixed point, direct form I, 32bit accumulator
+    ANE_FILTER_TYPE_NUM
+} ane_filter_type_t;
+
+typedef struct _ane_filter_t
+{
+    uint8_t type;
+    uint8_t sections;       // order of the band pass = number of sections.
+    union {
+        float   f32[ANE_SOS_MAX_ORDER][5];      // b0, b1, b2, a1, a2
+        int32_t q31[ANE_SOS_MAX_ORDER][5];      // Q2.30
+        int16_t q15[ANE_SOS_MAX_ORDER][5];      // Q2.14
+    } coeff;
+} ane_filter_t;
+
+// states of a filter, to run a signal block by block.
+typedef struct _ane_filter_state_t
+{
+    union {
+        float   f32[ANE_SOS_MAX_ORDER][2];      // direct form II transposed
+        int32_t fix[ANE_SOS_MAX_ORDER][4];      // x[n-1], x[n-2], y[n-1], y[n-2]
+        struct {
+            float x[ANE_BA_MAX_TAPS];           // x[n], x[n-1]...
+            float y[ANE_BA_MAX_TAPS];
+            uint32_t n;                         // samples since reset, the first taps output 0 as filter()
+        } ba;
+    } s;
+} ane_filter_state_t;
+
+// the filter in use by the signal processing.
+extern ane_filter_t ane_bp_filter;
+
+// order: 1~ANE_SOS_MAX_ORDER, ignored by ANE_FILTER_BA.
+// return 0 if succeed, -1 if the type or order is not supported, the filter is then set to ANE_FILTER_BA.
+int ane_filter_init(ane_filter_t *flt, int type, int order);
+const char* ane_filter_name(int type);
+
+// y = filter(x), states start from 0. x and y must not overlap.
+void ane_filter_run(const ane_filter_t *flt, const float *x, float *y, uint32_t len);
+
+// same as ane_filter_run() but continue from the states, so a long signal can be filtered in small blocks.
+void ane_filter_reset(ane_filter_state_t *st);
+void ane_filter_block(const ane_filter_t *flt, ane_filter_state_t *st, const float *x, float *y, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_FILTER_H__ */
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <string.h>
+#include <math.h>
+#include "anemometer_rate.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+static uint32_t step_period(ane_rate_t *r, int step)
+{
+    uint32_t p = r->period_min << step;
+    return p < r->period_max ? p : r->period_max;
+}
+
+void ane_rate_init(ane_rate_t *r, uint32_t period_min, uint32_t period_max, uint32_t period,
+        float bat_low, float bat_critical, uint32_t now)
+{
+    memset(r, 0, sizeof(ane_rate_t));
+    r->period_min = period_min > 0 ? period_min : 1;
+    r->period_max = period_max > r->period_min ? period_max : r->period_min;
+    r->bat_low = bat_low;
+    r->bat_critical = bat_critical < bat_low ? bat_critical : bat_low;
+    while(r->steps < ANE_RATE_MAX_STEPS && step_period(r, r->steps) < r->period_max)
+        r->steps++;
+    // start from the step of the given period
+    while(r->step < r->steps && step_period(r, r->step + 1) <= period)
+        r->step++;
+    r->period = step_period(r, r->step);
+    r->last_change = now;
+}
+
+// exponentially weighted mean and variance, alpha from the time since the last sample,
+// the samples are not evenly spaced when the rate changes.
+static void variability_add(float *mean_ns, float *mean_ew, float *var, float ns, float ew, float alpha)
+{
+    float d_ns = ns - *mean_ns;
+    float d_ew = ew - *mean_ew;
+    alpha = alpha < 1 ? alpha : 1;
+    *mean_ns += alpha * d_ns;
+    *mean_ew += alpha * d_ew;
+    *var = (1 - alpha) * (*var + alpha * (d_ns * d_ns + d_ew * d_ew));
+}
+
+void ane_rate_add(ane_rate_t *r, float ns, float ew, uint32_t now)
+{
+    if(!r->is_init)
+    {
+        r->ns = r->ns_fast = ns;
+        r->ew = r->ew_fast = ew;
+        r->var = r->var_fast = 0;
+        r->last_sample = now;
+        r->is_init = true;
+        return;
+    }
+    float dt = now - r->last_sample;
+    r->last_sample = now;
+    variability_add(&r->ns, &r->ew, &r->var, ns, ew, dt / ANE_RATE_TAU);
+    variability_add(&r->ns_fast, &r->ew_fast, &r->var_fast, ns, ew, dt / ANE_RATE_TAU_FAST);
+}
+
+float ane_rate_sigma(ane_rate_t *r)
+{
+    return sqrtf(r->var);
+}
+
+float ane_rate_sigma_fast(ane_rate_t *r)
+{
+    return sqrtf(r->var_fast);
+}
+
+// the period for the variability
+static float wanted_period(ane_rate_t *r, float sigma)
+{
+    // the error of an average of N samples is sigma/sqrt(N), it stays the same with N in proportion to sigma^2.
+    float k = ANE_RATE_SIGMA_REF / MAX(sigma, 0.001f);
+    return r->period_min * k * k;
+}
+
+// the fastest step the battery allows.
+static int battery_step(ane_rate_t *r, float bat_voltage)
+{
+    int step = 0;
+    if(bat_voltage <= 0 || bat_voltage >= r->bat_low)
+        return 0;
+    if(bat_voltage <= r->bat_critical)
+        return r->steps;
+    float k = (r->bat_low - bat_voltage) / (r->bat_low - r->bat_critical);
+    uint32_t limit = r->period_min + k * (r->period_max - r->period_min);
+    while(step < r->steps && step_period(r, step) < limit)
+        step++;
+    return step;
+}
+
+int ane_rate_update(ane_rate_t *r, float bat_voltage, uint32_t now)
+{
+    int step = r->step;
+    int reason = ANE_RATE_WIND;
+    if(r->is_init)
+    {
+        float wanted = wanted_period(r, ane_rate_sigma(r));
+        // faster when the wanted period is clearly shorter, to the step of it at once.
+        float wanted_fast = MIN(wanted, wanted_period(r, ane_rate_sigma_fast(r)));
+        int fast = 0;
+        while(fast < r->steps && step_period(r, fast + 1) <= wanted_fast * ANE_RATE_HYST)
+            fast++;
+        if(fast < step)
+            step = fast;
+        // slower by a step, when the wanted period is clearly longer and the rate has been held.
+        else if(step < r->steps && now - r->last_change >= ANE_RATE_HOLD &&
+                step_period(r, step + 1) * ANE_RATE_HYST <= wanted)
+            step++;
+    }
+    int limit = battery_step(r, bat_voltage);
+    if(step < limit)
+    {
+        step = limit;
+        reason = ANE_RATE_BATTERY;
+    }
+    if(step == r->step)
+        return ANE_RATE_KEEP;
+    r->step = step;
+    r->period = step_period(r, step);
+    r->last_change = now;
+    r->reason = reason;
+    r->changes++;
+    return reason;
+}
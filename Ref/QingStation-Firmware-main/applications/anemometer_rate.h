@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_RATE_H__
+#define __ANEMOMETER_RATE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Adaptive measurement rate.
+// The period between the measurements is a step of period_min << n, not longer than period_max.
+// The variability of the wind is the standard deviation of the wind vector over about a minute,
+// the period is chosen inversely to its square, the averages then have about the same error at any rate.
+// ANE_RATE_SIGMA_REF m/s or more measures at period_min.
+// A faster rate is taken at once when the wind picks up, seen by the variability over a few seconds,
+// a slower one only after the rate has been held for a while, one step at a time.
+// Under bat_low the fastest period is limited, linearly to period_max at bat_critical.
+
+#define ANE_RATE_TAU        (60000)     // ms, time constant of the variability
+#define ANE_RATE_TAU_FAST   (10000)     // ms, of the variability to speed up
+#define ANE_RATE_SIGMA_REF  (1.0f)      // m/s, std of the wind vector to measure at period_min
+#define ANE_RATE_HOLD       (60000)     // ms, a rate is kept at least before slowing down
+#define ANE_RATE_HYST       (1.25f)     // the wanted period must be this much off a step to change to it
+#define ANE_RATE_MAX_STEPS  (8)
+
+enum {
+    ANE_RATE_KEEP = 0,
+    ANE_RATE_WIND,          // changed by the variability of the wind
+    ANE_RATE_BATTERY,       // limited by the battery
+};
+
+typedef struct _ane_rate_t
+{
+    uint32_t period_min;    // ms
+    uint32_t period_max;
+    float bat_low;          // V
+    float bat_critical;
+    float ns, ew;           // mean of the wind vector, m/s
+    float var;              // variance of the wind vector, m2/s2
+    float ns_fast, ew_fast; // the same in a short time
+    float var_fast;
+    bool is_init;
+    uint32_t last_sample;   // ms
+    uint32_t last_change;
+    uint32_t period;        // ms, current period
+    uint8_t step;           // current step, period = period_min << step
+    uint8_t steps;          // the last step, at period_max
+    uint8_t reason;         // why the period changed last time
+    uint32_t changes;
+} ane_rate_t;
+
+// period is the one to start with. now in ms.
+void ane_rate_init(ane_rate_t *r, uint32_t period_min, uint32_t period_max, uint32_t period,
+        float bat_low, float bat_critical, uint32_t now);
+// an accepted wind sample, m/s as ane_wind_t.
+void ane_rate_add(ane_rate_t *r, float ns, float ew, uint32_t now);
+// standard deviation of the wind vector, m/s
+float ane_rate_sigma(ane_rate_t *r);
+float ane_rate_sigma_fast(ane_rate_t *r);
+// the period to measure at, bat_voltage = 0 if unknown. return ANE_RATE_KEEP if not changed.
+int ane_rate_update(ane_rate_t *r, float bat_voltage, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_RATE_H__ */
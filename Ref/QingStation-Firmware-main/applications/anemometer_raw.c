@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "stddef.h"
+#include "string.h"
+
+#include "anemometer_raw.h"
+#include "anemometer_calib.h"
+
+uint32_t ane_raw_pulse_id(void)
+{
+    return ane_crc32(0, cpulse, pulse_len * sizeof(uint16_t));
+}
+
+static uint32_t encode_plain(uint16_t *x, int len, uint8_t *out)
+{
+    for(int i=0; i<len; i++)
+    {
+        *out++ = x[i] & 0xFF;
+        *out++ = x[i] >> 8;
+    }
+    return len * 2;
+}
+
+static uint32_t decode_plain(const uint8_t *in, uint16_t *x, int len)
+{
+    for(int i=0; i<len; i++, in+=2)
+        x[i] = in[0] | (in[1] << 8);
+    return len * 2;
+}
+
+// 12bit ADC, an odd sample leaves half a byte.
+static uint32_t encode_pack12(uint16_t *x, int len, uint8_t *out)
+{
+    uint8_t *p = out;
+    for(int i=0; i<len; i+=2)
+    {
+        uint16_t a = x[i] & 0xFFF;
+        uint16_t b = (i + 1 < len) ? x[i+1] & 0xFFF : 0;
+        *p++ = a & 0xFF;
+        *p++ = (a >> 8) | ((b & 0x0F) << 4);
+        *p++ = b >> 4;
+    }
+    return p - out;
+}
+
+static uint32_t decode_pack12(const uint8_t *in, uint16_t *x, int len)
+{
+    const uint8_t *p = in;
+    for(int i=0; i<len; i+=2, p+=3)
+    {
+        x[i] = p[0] | ((p[1] & 0x0F) << 8);
+        if(i + 1 < len)
+            x[i+1] = (p[1] >> 4) | (p[2] << 4);
+    }
+    return p - in;
+}
+
+// return -1 when it is longer than max.
+static int encode_delta(uint16_t *x, int len, uint8_t *out, uint32_t max)
+{
+    uint32_t n = 0;
+    int last = 0;
+    for(int i=0; i<len; i++)
+    {
+        if(n + 3 > max)
+            return -1;
+        int d = x[i] - last;
+        if(i > 0 && d > ANE_RAW_DELTA_ESC && d <= 127)
+            out[n++] = (uint8_t)(int8_t)d;
+        else
+        {
+            out[n++] = (uint8_t)ANE_RAW_DELTA_ESC;
+            out[n++] = x[i] & 0xFF;
+            out[n++] = x[i] >> 8;
+        }
+        last = x[i];
+    }
+    return n;
+}
+
+static uint32_t decode_delta(const uint8_t *in, uint32_t size, uint16_t *x, int len)
+{
+    uint32_t n = 0;
+    int last = 0;
+    for(int i=0; i<len; i++)
+    {
+        if(n >= size)
+            return 0;
+        int8_t d = (int8_t)in[n++];
+        if(d == ANE_RAW_DELTA_ESC)
+        {
+            if(n + 2 > size)
+                return 0;
+            x[i] = in[n] | (in[n+1] << 8);
+            n += 2;
+        }
+        else
+            x[i] = last + d;
+        last = x[i];
+    }
+    return n;
+}
+
+uint32_t ane_raw_encode(ane_raw_header_t *head, uint16_t adc[][ADC_SAMPLE_LEN], int coding, uint8_t *buf)
+{
+    uint8_t *payload = buf + sizeof(ane_raw_header_t);
+    uint32_t size = 0;
+
+    head->magic = ANE_RAW_MAGIC;
+    head->version = ANE_RAW_VERSION;
+    head->channels = 4;
+    head->samples = ADC_SAMPLE_LEN;
+    if(coding == ANE_RAW_DELTA)
+    {
+        // the packing is 3/4 of the plain, the delta must be shorter to be worth it.
+        uint32_t max = 4 * (ADC_SAMPLE_LEN + 1) / 2 * 3;
+        for(int ch=0; ch<4; ch++)
+        {
+            int n = encode_delta(adc[ch], ADC_SAMPLE_LEN, payload + size, max - size);
+            if(n < 0)
+            {
+                coding = ANE_RAW_PACK12;
+                size = 0;
+                break;
+            }
+            size += n;
+        }
+    }
+    if(coding == ANE_RAW_PACK12)
+        for(int ch=0; ch<4; ch++)
+            size += encode_pack12(adc[ch], ADC_SAMPLE_LEN, payload + size);
+    else if(coding != ANE_RAW_DELTA)
+    {
+        coding = ANE_RAW_PLAIN;
+        for(int ch=0; ch<4; ch++)
+            size += encode_plain(adc[ch], ADC_SAMPLE_LEN, payload + size);
+    }
+    head->coding = coding;
+    head->payload = size;
+    head->crc = ane_crc32(0, head, offsetof(ane_raw_header_t, crc));
+    head->crc = ane_crc32(head->crc, payload, size);
+    memcpy(buf, head, sizeof(ane_raw_header_t));
+    return sizeof(ane_raw_header_t) + size;
+}
+
+int ane_raw_decode(const uint8_t *frame, uint32_t len, ane_raw_header_t *head, uint16_t adc[][ADC_SAMPLE_LEN])
+{
+    const uint8_t *payload = frame + sizeof(ane_raw_header_t);
+    uint32_t size = 0, n = 0;
+    if(len < sizeof(ane_raw_header_t))
+        return -1;
+    memcpy(head, frame, sizeof(ane_raw_header_t));
+    if(head->magic != ANE_RAW_MAGIC || head->version != ANE_RAW_VERSION || head->channels != 4 ||
+            head->samples != ADC_SAMPLE_LEN || head->coding >= ANE_RAW_CODING_NUM ||
+            len < sizeof(ane_raw_header_t) + head->payload)
+        return -1;
+    uint32_t crc = ane_crc32(0, head, offsetof(ane_raw_header_t, crc));
+    if(ane_crc32(crc, payload, head->payload) != head->crc)
+        return -2;
+
+    for(int ch=0; ch<4; ch++)
+    {
+        if(head->coding == ANE_RAW_PLAIN)
+            n = decode_plain(payload + size, adc[ch], ADC_SAMPLE_LEN);
+        else if(head->coding == ANE_RAW_PACK12)
+            n = decode_pack12(payload + size, adc[ch], ADC_SAMPLE_LEN);
+        else
+            n = decode_delta(payload + size, head->payload - size, adc[ch], ADC_SAMPLE_LEN);
+        if(n == 0)
+            return -1;
+        size += n;
+    }
+    return size == head->payload ? 0 : -1;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_RAW_H__
+#define __ANEMOMETER_RAW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary raw captures.
+// The 4 channels of a measurement are a frame: a header then the captures, channel by channel in the enum order.
+// A frame is written with a single write, frames are appended to a file one after another.
+// host/ane_rawdump converts them back to csv as record_raw() used to write.
+#define ANE_RAW_MAGIC       (0x57415241)    // "ARAW"
+#define ANE_RAW_VERSION     (1)
+
+typedef enum {
+    ANE_RAW_PLAIN = 0,  // uint16 little endian, 8000 bytes
+    ANE_RAW_PACK12,     // 2 samples in 3 bytes, 6000 bytes
+    ANE_RAW_DELTA,      // int8 difference to the last sample, 0x80 + uint16 when it does not fit. ~5000 bytes
+    ANE_RAW_CODING_NUM
+} ane_raw_coding_t;
+
+#define ANE_RAW_DELTA_ESC   (-128)
+
+typedef struct _ane_raw_header_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint8_t  coding;        // ane_raw_coding_t
+    uint8_t  channels;      // 4
+    uint16_t samples;       // of a channel
+    int16_t  err;           // error code of the measurement, -1 = not processed
+    uint32_t timestamp;     // unix time
+    uint32_t tick;          // ms
+    uint32_t pulse_id;      // crc32 of the excitation pulse
+    float    sig_level[4];  // zero level of each channel
+    uint32_t payload;       // bytes after the header
+    uint32_t crc;           // crc32 of the header above and the payload
+} ane_raw_header_t;
+
+// size of a frame at most
+#define ANE_RAW_FRAME_MAX   (sizeof(ane_raw_header_t) + 4 * ADC_SAMPLE_LEN * sizeof(uint16_t))
+
+// crc32 of cpulse[]
+uint32_t ane_raw_pulse_id(void);
+
+// make a frame of the captures in buf, ANE_RAW_FRAME_MAX long. the header is filled but the coding, size and crc.
+// a delta coding longer than the 12bit packing is packed instead. return the frame size.
+uint32_t ane_raw_encode(ane_raw_header_t *head, uint16_t adc[][ADC_SAMPLE_LEN], int coding, uint8_t *buf);
+// the captures of a frame, the header is copied to head. return 0 if succeed, -1 if not a frame, -2 if crc error.
+int ane_raw_decode(const uint8_t *frame, uint32_t len, ane_raw_header_t *head, uint16_t adc[][ADC_SAMPLE_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_RAW_H__ */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_sched.h"
+
+static const ULTRASONIC_CHANNEL order[2][4] = {
+        {EAST, NORTH, SOUTH, WEST},
+        {WEST, SOUTH, NORTH, EAST},
+};
+
+void ane_sched_reset(ane_sched_t *sc)
+{
+    memset(sc, 0, sizeof(ane_sched_t));
+}
+
+int ane_sched_measure(ane_sched_t *sc, const ane_capture_src_t *src, uint16_t adc[][ADC_SAMPLE_LEN],
+        ane_baseline_t baseline[4], float sig_level[4], int shots)
+{
+    const ULTRASONIC_CHANNEL *o = order[sc->cycles & 1];
+    int num_anchor = ane_measure_src(src, o, adc, baseline, sig_level, shots, sc->ts);
+
+    // relative to the first capture, the counter may wrap.
+    uint32_t t0 = sc->ts[o[0]];
+    float t[4], t_ref = 0;
+    for(int ch=0; ch<4; ch++)
+    {
+        t[ch] = (float)(int32_t)(sc->ts[ch] - t0);
+        t_ref += t[ch] / 4;
+    }
+    sc->t_ref = t0 + (int32_t)t_ref;
+    sc->skew[0] = (t[NORTH] + t[SOUTH]) / 2 - t_ref;
+    sc->skew[1] = (t[EAST] + t[WEST]) / 2 - t_ref;
+    sc->skew_max = fmaxf(sc->skew_max, fmaxf(fabsf(sc->skew[0]), fabsf(sc->skew[1])));
+    sc->cycles++;
+    return num_anchor;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_SCHED_H__
+#define __ANEMOMETER_SCHED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Interleaved measurement of the reciprocal pairs.
+// Measured N S E W one after another, the channels of a cycle are a few ms apart and a gust changes the wind in between,
+// the 2 pairs do not see the same wind.
+// The wind of a pair comes from 1/t of its 2 legs, it is the average of the 2 captures, the wind at their middle.
+// The legs of a pair are measured one after the other and the 2 pairs are nested, E N S W, so the middles of both
+// pairs fall on the common instant of the cycle, the average of the 4 timestamps, in a single pass of 4 captures.
+// The order is reversed every cycle, W S N E, the pair outside and its first leg take turns.
+// What is left of the jitter of the captures is kept as the skew of each pair.
+
+typedef struct _ane_sched_t
+{
+    uint32_t ts[4];         // timestamps of the channels of the last cycle
+    uint32_t t_ref;         // the common instant of the last cycle
+    uint32_t cycles;
+    float skew[2];          // middle of the N/S and the E/W pair - t_ref, in timestamp unit
+    float skew_max;
+} ane_sched_t;
+
+void ane_sched_reset(ane_sched_t *sc);
+
+// same as ane_measure_stack() from a source, in the interleaved order. return the number of pulse-less captures.
+// the source needs the timestamp.
+int ane_sched_measure(ane_sched_t *sc, const ane_capture_src_t *src, uint16_t adc[][ADC_SAMPLE_LEN],
+        ane_baseline_t baseline[4], float sig_level[4], int shots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_SCHED_H__ */
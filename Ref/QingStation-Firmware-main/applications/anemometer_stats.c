@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_stats.h"
+
+static void bin_add(ane_stats_bin_t *a, const ane_stats_bin_t *b)
+{
+    a->speed += b->speed;
+    a->ns += b->ns;
+    a->ew += b->ew;
+    a->dir_ns += b->dir_ns;
+    a->dir_ew += b->dir_ew;
+    a->num += b->num;
+    a->dir_num += b->dir_num;
+}
+
+static void bin_sub(ane_stats_bin_t *a, const ane_stats_bin_t *b)
+{
+    a->speed -= b->speed;
+    a->ns -= b->ns;
+    a->ew -= b->ew;
+    a->dir_ns -= b->dir_ns;
+    a->dir_ew -= b->dir_ew;
+    a->num -= b->num;
+    a->dir_num -= b->dir_num;
+}
+
+// direction from the north-south and east-west component, same as the anemometer output.
+static float course_from_vector(float ns, float ew)
+{
+    return atan2f(-ew, -ns)/3.1415926f*180 + 180;
+}
+
+void ane_stats_window_init(ane_stats_window_t *w, uint32_t window_ms, uint32_t period_ms)
+{
+    uint32_t samples = period_ms ? window_ms / period_ms : 1;
+    if(samples < 1)
+        samples = 1;
+    memset(w, 0, sizeof(ane_stats_window_t));
+    w->bin_len = (samples + ANE_STATS_MAX_BINS - 1) / ANE_STATS_MAX_BINS;
+    w->bin_num = (samples + w->bin_len - 1) / w->bin_len;
+}
+
+// the current bin is completed, move it to the ring.
+static void window_push(ane_stats_window_t *w)
+{
+    // the oldest leaves the window.
+    if(w->filled >= w->bin_num)
+        bin_sub(&w->sum, &w->bin[w->head]);
+    else
+        w->filled++;
+    w->bin[w->head] = w->cur;
+    bin_add(&w->sum, &w->cur);
+    w->head = (w->head + 1) % w->bin_num;
+
+    // the smaller peaks before it will never be the maximum.
+    while(w->dq_len > 0 && w->dq_peak[(w->dq_head + w->dq_len - 1) % ANE_STATS_MAX_BINS] <= w->cur.peak)
+        w->dq_len--;
+    w->dq_peak[(w->dq_head + w->dq_len) % ANE_STATS_MAX_BINS] = w->cur.peak;
+    w->dq_seq[(w->dq_head + w->dq_len) % ANE_STATS_MAX_BINS] = w->seq;
+    w->dq_len++;
+    // out of the window.
+    while(w->dq_len > 0 && w->seq - w->dq_seq[w->dq_head] >= w->bin_num)
+    {
+        w->dq_head = (w->dq_head + 1) % ANE_STATS_MAX_BINS;
+        w->dq_len--;
+    }
+    w->seq++;
+    memset(&w->cur, 0, sizeof(w->cur));
+}
+
+void ane_stats_window_add(ane_stats_window_t *w, float ns, float ew, float peak)
+{
+    float speed = sqrtf(ns*ns + ew*ew);
+    int32_t p = lrintf(peak * ANE_STATS_SCALE);
+    w->cur.speed += lrintf(speed * ANE_STATS_SCALE);
+    w->cur.ns += lrintf(ns * ANE_STATS_SCALE);
+    w->cur.ew += lrintf(ew * ANE_STATS_SCALE);
+    if(speed >= ANE_STATS_CALM)
+    {
+        w->cur.dir_ns += lrintf(ns / speed * ANE_STATS_SCALE);
+        w->cur.dir_ew += lrintf(ew / speed * ANE_STATS_SCALE);
+        w->cur.dir_num++;
+    }
+    w->cur.peak = w->cur.num == 0 ? p : (p > w->cur.peak ? p : w->cur.peak);
+    w->cur.num++;
+    if(w->cur.num >= w->bin_len)
+        window_push(w);
+}
+
+void ane_stats_window_get(ane_stats_window_t *w, ane_stats_result_t *r)
+{
+    ane_stats_bin_t s = w->sum;
+    bin_add(&s, &w->cur);
+    memset(r, 0, sizeof(ane_stats_result_t));
+    r->course = -1;
+    r->course_std = -1;
+    r->num = s.num;
+    if(s.num == 0)
+        return;
+
+    int32_t peak = w->dq_len > 0 ? w->dq_peak[w->dq_head] : w->cur.peak;
+    if(w->cur.num > 0 && w->cur.peak > peak)
+        peak = w->cur.peak;
+    r->peak = (float)peak / ANE_STATS_SCALE;
+    r->speed = (float)s.speed / s.num / ANE_STATS_SCALE;
+
+    // vector average
+    float ns = (float)s.ns / s.num / ANE_STATS_SCALE;
+    float ew = (float)s.ew / s.num / ANE_STATS_SCALE;
+    if(sqrtf(ns*ns + ew*ew) >= ANE_STATS_CALM)
+        r->course = course_from_vector(ns, ew);
+
+    // Yamartino, from the mean of the unit vectors.
+    if(s.dir_num > 0)
+    {
+        float sa = (float)s.dir_ew / s.dir_num / ANE_STATS_SCALE;
+        float ca = (float)s.dir_ns / s.dir_num / ANE_STATS_SCALE;
+        float e = 1 - (sa*sa + ca*ca);
+        e = e > 0 ? sqrtf(e) : 0;
+        if(e > 1)
+            e = 1;
+        r->course_std = asinf(e) * (1 + (2/sqrtf(3) - 1) * e*e*e) / 3.1415926f * 180;
+    }
+}
+
+void ane_stats_init(ane_stats_t *st, uint32_t period_ms)
+{
+    memset(st, 0, sizeof(ane_stats_t));
+    st->gust_len = period_ms ? ANE_STATS_GUST_MS / period_ms : 1;
+    if(st->gust_len < 1)
+        st->gust_len = 1;
+    if(st->gust_len > ANE_STATS_GUST_LEN)
+        st->gust_len = ANE_STATS_GUST_LEN;
+    ane_stats_window_init(&st->w30s, 30*1000, period_ms);
+    ane_stats_window_init(&st->w2min, 2*60*1000, period_ms);
+    ane_stats_window_init(&st->w10min, 10*60*1000, period_ms);
+}
+
+void ane_stats_add(ane_stats_t *st, float ns, float ew)
+{
+    float speed = sqrtf(ns*ns + ew*ew);
+    int32_t v = lrintf(speed * ANE_STATS_SCALE);
+
+    // 3s moving average for the gust
+    if(st->gust_filled >= st->gust_len)
+        st->gust_sum -= st->gust_buf[st->gust_idx];
+    else
+        st->gust_filled++;
+    st->gust_buf[st->gust_idx] = v;
+    st->gust_sum += v;
+    st->gust_idx = (st->gust_idx + 1) % st->gust_len;
+    st->gust = (float)st->gust_sum / st->gust_filled / ANE_STATS_SCALE;
+
+    ane_stats_window_add(&st->w30s, ns, ew, speed);
+    ane_stats_window_add(&st->w2min, ns, ew, st->gust);
+    ane_stats_window_add(&st->w10min, ns, ew, st->gust);
+}
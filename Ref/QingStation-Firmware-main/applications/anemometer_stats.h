@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_STATS_H__
+#define __ANEMOMETER_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sliding window statistics of the wind.
+// Each window is a ring of bins. A bin is the sums of a few samples, so a long window or a high sample rate
+// does not need more memory, the window moves by one bin at a time. The sums of the window are updated
+// when a bin enters and leaves, the maximum is taken from a monotonic deque of the bins.
+// All sums are in integer (mm/s), they do not drift after subtracting for days.
+
+#define ANE_STATS_MAX_BINS  (40)        // bins of a window
+#define ANE_STATS_GUST_LEN  (64)        // samples of the gust average, the 3s gust is 21Hz max
+#define ANE_STATS_GUST_MS   (3000)      // WMO gust, 3s average
+#define ANE_STATS_CALM      (0.25f)     // m/s, the direction is not valid under it
+#define ANE_STATS_SCALE     (1000)      // m/s to mm/s, unit vector to 1/1000
+
+typedef struct _ane_stats_bin_t
+{
+    int32_t speed;      // sums of the samples
+    int32_t ns;
+    int32_t ew;
+    int32_t dir_ns;     // sums of the unit vectors of the direction, calm samples are not included.
+    int32_t dir_ew;
+    uint16_t num;
+    uint16_t dir_num;
+    int32_t peak;       // maximum of the peak input
+} ane_stats_bin_t;
+
+typedef struct _ane_stats_window_t
+{
+    ane_stats_bin_t bin[ANE_STATS_MAX_BINS];    // ring of the completed bins
+    uint16_t bin_num;   // completed bins in the window, plus the current one until it completes
+    uint16_t bin_len;   // samples in a bin
+    uint16_t head;      // next bin to write
+    uint16_t filled;    // completed bins
+    ane_stats_bin_t cur;// current bin, not completed yet
+    ane_stats_bin_t sum;// sums of the completed bins in the window, peak is not used
+    int32_t  dq_peak[ANE_STATS_MAX_BINS];   // monotonic deque of the bin peaks, decreasing.
+    uint32_t dq_seq[ANE_STATS_MAX_BINS];    // bin sequence of each entry
+    uint16_t dq_head;
+    uint16_t dq_len;
+    uint32_t seq;       // sequence of the current bin
+} ane_stats_window_t;
+
+typedef struct _ane_stats_result_t
+{
+    float speed;        // mean of the wind speed, m/s
+    float peak;         // maximum of the peak input, m/s
+    float course;       // vector averaged direction, deg, -1 if calm
+    float course_std;   // circular standard deviation of the direction (Yamartino), deg, -1 if calm
+    uint32_t num;       // samples in the window
+} ane_stats_result_t;
+
+typedef struct _ane_stats_t
+{
+    int32_t gust_buf[ANE_STATS_GUST_LEN];   // the last few speed for the 3s gust.
+    int32_t gust_sum;
+    uint16_t gust_len;
+    uint16_t gust_idx;
+    uint16_t gust_filled;
+    float gust;                             // last 3s average of speed.
+    ane_stats_window_t w30s;    // peak = speed
+    ane_stats_window_t w2min;   // peak = 3s gust
+    ane_stats_window_t w10min;  // peak = 3s gust
+} ane_stats_t;
+
+// window of window_ms long, with samples every period_ms
+void ane_stats_window_init(ane_stats_window_t *w, uint32_t window_ms, uint32_t period_ms);
+// add a sample, peak is the value for the maximum.
+void ane_stats_window_add(ane_stats_window_t *w, float ns, float ew, float peak);
+void ane_stats_window_get(ane_stats_window_t *w, ane_stats_result_t *r);
+
+// new wind samples every period_ms.
+void ane_stats_init(ane_stats_t *st, uint32_t period_ms);
+// add a wind sample, m/s in north-south and east-west as ane_wind_t.
+void ane_stats_add(ane_stats_t *st, float ns, float ew);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_STATS_H__ */
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "string.h"
+#include "math.h"
+
+#include "anemometer_dsp.h"
+#include "anemometer_tracker.h"
+
+void ane_track_reset(ane_track_t *trk)
+{
+    memset(trk, 0, sizeof(ane_track_t));
+}
+
+static void full_window(int win[4][2])
+{
+    for(int ch=0; ch<4; ch++)
+    {
+        win[ch][0] = DEADZONE_OFFSET;
+        win[ch][1] = VALID_LEN;
+    }
+}
+
+bool ane_track_window(ane_track_t *trk, float pulse_offset[4], float est_c, int win[4][2])
+{
+    if(!trk || !trk->is_tracking || trk->c <= 0 || est_c <= 0)
+    {
+        full_window(win);
+        if(trk)
+            trk->full_search++;
+        return false;
+    }
+
+    for(int ch=0; ch<4; ch++)
+    {
+        // time of flight is inversely proportional to the speed of sound.
+        float dt = trk->dt[ch] * trk->c / est_c;
+        // dt = zero crossings + pulse offset, the zero crossings start from the peak PEAK_ZC + peak_off,
+        // their average is peak_off peaks after the main peak.
+        int peak = (int)(dt - pulse_offset[ch] - trk->peak_off[ch] * TRACK_HALF_PERIOD);
+        int start = peak - TRACK_WINDOW_LEFT;
+        int stop = peak + TRACK_WINDOW_RIGHT;
+        start = MAX(start, DEADZONE_OFFSET);
+        stop = MIN(stop, ADC_SAMPLE_LEN);
+        if(stop - start < TRACK_WINDOW_LEFT) // prediction out of the capture
+        {
+            full_window(win);
+            trk->is_tracking = false;
+            trk->full_search++;
+            return false;
+        }
+        win[ch][0] = start;
+        win[ch][1] = stop - start;
+    }
+    trk->win_search++;
+    return true;
+}
+
+void ane_track_update(ane_track_t *trk, float dt[4], ane_ch_result_t res[4], float est_c, bool is_valid)
+{
+    if(is_valid)
+    {
+        memcpy(trk->dt, dt, sizeof(trk->dt));
+        // a channel replaced by the tof filter keeps the last offset.
+        for(int ch=0; ch<4; ch++)
+            if(res[ch].err == NORMAL && res[ch].dt != 0 && dt[ch] == res[ch].dt)
+                trk->peak_off[ch] = res[ch].peak_off;
+        trk->c = est_c;
+        trk->lost = 0;
+        trk->is_tracking = true;
+        return;
+    }
+    trk->lost++;
+    if(trk->lost >= TRACK_MAX_LOST)
+        trk->is_tracking = false;
+}
+
+void ane_tof_reset(ane_tof_filter_t *tf)
+{
+    memset(tf, 0, sizeof(ane_tof_filter_t));
+}
+
+// the innovations out of the gates are a gust or a change of sound speed, not a bad channel.
+static bool is_gust(ane_tof_filter_t *tf, ane_ch_result_t res[4], const float r[4])
+{
+    for(int ch=0; ch<4; ch++)
+        if(res[ch].err != NORMAL || res[ch].dt <= 0 || !tf->ch[ch].is_valid || fabsf(r[ch]) > TOF_GATE_MAX)
+            return false;
+    // r = common + wind of the pair on the forward channel, common - wind on the reverse one.
+    float common_ns = (r[NORTH] + r[SOUTH]) / 2;
+    float common_ew = (r[EAST] + r[WEST]) / 2;
+    return fabsf(common_ns - common_ew) <= TOF_GUST_RESIDUAL;
+}
+
+int ane_tof_update(ane_tof_filter_t *tf, ane_ch_result_t res[4], float est_c, uint32_t now, float dt[4])
+{
+    float pred[4], r[4];
+    bool is_good[4];
+    int num_gated = 0, num_out = 0;
+    // time of flight is inversely proportional to the speed of sound.
+    float scale = (tf->c > 0 && est_c > 0) ? tf->c / est_c : 1;
+    float elapsed = tf->c > 0 ? (float)(now - tf->last) : 0;
+
+    for(int ch=0; ch<4; ch++)
+    {
+        ane_tof_ch_t *f = &tf->ch[ch];
+        float z = res[ch].dt;
+        pred[ch] = (f->dt + f->rate * elapsed) * scale;
+        r[ch] = z - pred[ch];
+        is_good[ch] = (res[ch].err == NORMAL && z > 0);
+        if(is_good[ch] && f->is_valid)
+        {
+            float gate = TOF_GATE_SIGMA * sqrtf(f->var);
+            gate = MIN(MAX(gate, TOF_GATE_MIN), TOF_GATE_MAX);
+            if(fabsf(r[ch]) > gate)
+            {
+                is_good[ch] = false;
+                num_out++;
+            }
+        }
+    }
+    if(num_out && is_gust(tf, res, r))
+    {
+        for(int ch=0; ch<4; ch++)
+            is_good[ch] = true;
+        tf->gusts++;
+    }
+    for(int ch=0; ch<4; ch++)
+    {
+        ane_tof_ch_t *f = &tf->ch[ch];
+        if(!is_good[ch])
+        {
+            // a channel without history cannot be replaced.
+            if(!f->is_valid || f->coast >= TOF_MAX_COAST)
+                num_gated = 4;
+            else
+                num_gated++;
+        }
+    }
+    if(num_gated > TOF_MAX_GATED)
+    {
+        tf->rejected++;
+        for(int ch=0; ch<4; ch++)
+        {
+            ane_tof_ch_t *f = &tf->ch[ch];
+            // restart the channel when it is lost for too long, the next good measurement is taken as it is.
+            if(!is_good[ch] && ++f->coast > TOF_MAX_COAST)
+                f->is_valid = false;
+        }
+        return -1;
+    }
+
+    for(int ch=0; ch<4; ch++)
+    {
+        ane_tof_ch_t *f = &tf->ch[ch];
+        float z = res[ch].dt;
+        if(!is_good[ch])
+        {
+            f->dt = pred[ch];
+            f->coast++;
+            tf->gated++;
+        }
+        else if(!f->is_valid)
+        {
+            f->dt = z;
+            f->rate = 0;
+            f->var = (TOF_GATE_MAX / TOF_GATE_SIGMA) * (TOF_GATE_MAX / TOF_GATE_SIGMA);
+            f->coast = 0;
+            f->is_valid = true;
+        }
+        else
+        {
+            f->dt = pred[ch] + TOF_ALPHA * r[ch];
+            f->rate = f->rate * scale + (elapsed >= 1 ? TOF_BETA * r[ch] / elapsed : 0);
+            f->var = 0.9f * f->var + 0.1f * r[ch] * r[ch];
+            f->coast = 0;
+        }
+        // a good channel is output as measured, the filter only predicts the bad ones.
+        dt[ch] = is_good[ch] ? z : f->dt;
+    }
+    tf->c = est_c;
+    tf->last = now;
+    return num_gated;
+}
+
+void ane_stack_reset(ane_stack_t *sk, int max_shots)
+{
+    memset(sk, 0, sizeof(ane_stack_t));
+    sk->max_shots = MIN(MAX(max_shots, 1), ANE_STACK_MAX_SHOTS);
+    sk->shots = 1;
+}
+
+int ane_stack_update(ane_stack_t *sk, ane_ch_result_t res[4], int err)
+{
+    float q = 1;
+    bool is_bad = (err != NORMAL);
+    for(int ch=0; ch<4; ch++)
+    {
+        if(res[ch].err != NORMAL || res[ch].dt == 0)
+            is_bad = true;
+        q = MIN(q, res[ch].quality);
+    }
+
+    if(is_bad || q < STACK_Q_LOW)
+    {
+        sk->shots = MIN(sk->shots * 2, sk->max_shots);
+        sk->good = 0;
+    }
+    else if(q >= STACK_Q_HIGH && ++sk->good >= STACK_GOOD_CYCLES)
+    {
+        sk->shots = MAX(sk->shots / 2, 1);
+        sk->good = 0;
+    }
+    return sk->shots;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __ANEMOMETER_TRACKER_H__
+#define __ANEMOMETER_TRACKER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "anemometer_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Echo window tracking.
+// The echo only moves a few us between cycles, so the next echo is predicted from the last accepted
+// time of flight, corrected by the change of speed of sound (temperature).
+// Only a window around the prediction is filtered and searched, the full window is used when the tracking is lost.
+
+// window around the predicted main peak, in ADC samples (us).
+// The main peak is located from the zero crossings and the offset found by the shape matching of the last cycle,
+// so the mse search range is not needed in the window, only the 8 peaks on each side of the main peak
+// (a peak every half period of 40kHz, 12.5 samples) and 2 periods as guard, the main peak moves to its neighbour
+// in noise.
+#define TRACK_HALF_PERIOD   (12.5f)
+#define TRACK_WINDOW_LEFT   ((int)(PEAK_LEFT * TRACK_HALF_PERIOD) + 50)
+#define TRACK_WINDOW_RIGHT  ((int)(PEAK_RIGHT * TRACK_HALF_PERIOD) + 50)
+#define TRACK_MAX_LOST      (2)     // failed cycles before fall back to the full window.
+
+typedef struct _ane_track_t
+{
+    float dt[4];        // last accepted time of flight, us
+    int peak_off[4];    // offset of the main peak found by the shape matching, in peaks
+    float c;            // estimated sound speed when dt[] was accepted.
+    uint32_t lost;      // consecutive failed cycles
+    bool is_tracking;
+    uint32_t full_search;   // statistic, number of cycles searched in full window.
+    uint32_t win_search;    // statistic, number of cycles searched in tracking window.
+} ane_track_t;
+
+void ane_track_reset(ane_track_t *trk);
+
+// window of each channel for the next cycle. win[ch][0] = start, win[ch][1] = length, in ADC samples.
+// est_c = speed of sound from temperature. return true if it is a tracking window, false if full window.
+bool ane_track_window(ane_track_t *trk, float pulse_offset[4], float est_c, int win[4][2]);
+
+// update the tracker with the result of the cycle, dt[] and res[] only used when is_valid
+void ane_track_update(ane_track_t *trk, float dt[4], ane_ch_result_t res[4], float est_c, bool is_valid);
+
+// Time of flight filter.
+// Each channel has an alpha-beta filter (ToF and its rate per ms), the measurement is gated by the innovation.
+// The cycles are not evenly spaced (retries, adaptive rate, burst), the prediction is by the time elapsed.
+// A channel failed or out of the gate is replaced by its prediction, so a single bad channel does not
+// reject the whole cycle. The channels in the gate are output as measured, the wind is not smoothed. The gate stays below a quarter period of 40kHz, a cycle slip of the zero crossings
+// is always rejected.
+#define TOF_ALPHA           (0.5f)
+#define TOF_BETA            (0.1f)
+#define TOF_GATE_SIGMA      (4.0f)  // gate = TOF_GATE_SIGMA * std of the innovation
+#define TOF_GATE_MIN        (1.0f)  // us
+#define TOF_GATE_MAX        (6.0f)  // us
+#define TOF_MAX_COAST       (3)     // cycles a channel can run on prediction, then it restarts from the measurement.
+#define TOF_MAX_GATED       (1)     // channels replaced in a cycle, more than that the cycle is rejected.
+// A gust moves the reciprocal channels (N/S, E/W) in opposite directions and a change of sound speed moves
+// all the channels the same, out of the gate in steady wind. When all channels are measured and their
+// innovations are explained by a wind change of each pair and a common sound speed change, they are accepted.
+// The pairs must agree on the common change within TOF_GUST_RESIDUAL, a single bad channel does not.
+#define TOF_GUST_RESIDUAL   (1.0f)  // us
+
+typedef struct _ane_tof_ch_t
+{
+    float dt;           // filtered time of flight, us
+    float rate;         // change per ms, us
+    float var;          // variance of the innovation, us^2
+    uint8_t coast;      // consecutive cycles on prediction
+    bool is_valid;
+} ane_tof_ch_t;
+
+typedef struct _ane_tof_filter_t
+{
+    ane_tof_ch_t ch[4];
+    float c;            // sound speed of the last update, the prediction is scaled by the change of it.
+    uint32_t last;      // ms, time of the last update
+    uint32_t gated;     // statistic, channel measurements replaced by the prediction
+    uint32_t rejected;  // statistic, cycles with too many bad channels
+    uint32_t gusts;     // statistic, cycles accepted as a gust out of the gates
+} ane_tof_filter_t;
+
+void ane_tof_reset(ane_tof_filter_t *tf);
+
+// update with the results of a cycle, est_c = speed of sound from temperature, now in ms.
+// dt[] outputs the time of flight of each channel, measured or predicted.
+// return the number of channels replaced by the prediction, -1 if the cycle cannot be estimated.
+int ane_tof_update(ane_tof_filter_t *tf, ane_ch_result_t res[4], float est_c, uint32_t now, float dt[4]);
+
+// Coherent stacking control.
+// Stacking the captures of N shots reduces the noise by sqrt(N), while the signal processing is only done once.
+// The shots are doubled when the echo is not matched, and halved after a run of good cycles.
+#define STACK_Q_LOW         (0.3f)  // quality of a channel under it, the shots are increased.
+#define STACK_Q_HIGH        (0.7f)  // quality of all channels above it, the cycle is good.
+#define STACK_GOOD_CYCLES   (30)    // good cycles before the shots are reduced.
+
+typedef struct _ane_stack_t
+{
+    uint8_t shots;      // shots of the next cycle
+    uint8_t max_shots;  // 1 = stacking disabled
+    uint16_t good;      // consecutive good cycles
+} ane_stack_t;
+
+void ane_stack_reset(ane_stack_t *sk, int max_shots);
+// update with the results and the error of the cycle, return the shots of the next cycle.
+int ane_stack_update(ane_stack_t *sk, ane_ch_result_t res[4], int err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANEMOMETER_TRACKER_H__ */
@@ -26,6 +26,8 @@
 #include <stdbool.h>
 
 #include "drv_anemometer.h"
+#include "anemometer_filter.h"
+#include "anemometer_estimator.h"
 
 #include "cjson/cjson.h"
 
@@ -217,6 +219,21 @@ void anemo_create_json(sensor_config_t* config, cJSON* json)
     if(!cJSON_AddNumberToObject(temp, "offset_s", ane->pulse_offset[SOUTH])) return;
     if(!cJSON_AddNumberToObject(temp, "offset_w", ane->pulse_offset[WEST])) return;
     if(!cJSON_AddBoolToObject(temp, "is_dump_error", ane->is_dump_error)) return;
+    if(!cJSON_AddNumberToObject(temp, "filter_type", ane->filter_type)) return;
+    if(!cJSON_AddNumberToObject(temp, "filter_order", ane->filter_order)) return;
+    if(!cJSON_AddNumberToObject(temp, "estimator", ane->estimator)) return;
+    if(!cJSON_AddNumberToObject(temp, "shadow_estimator", ane->shadow_estimator)) return;
+    if(!cJSON_AddNumberToObject(temp, "max_shots", ane->max_shots)) return;
+    if(!cJSON_AddBoolToObject(temp, "is_tof_gate", ane->is_tof_gate)) return;
+    if(!cJSON_AddBoolToObject(temp, "is_interleaved", ane->is_interleaved)) return;
+    if(!cJSON_AddNumberToObject(temp, "burst_rate", ane->burst_rate)) return;
+    if(!cJSON_AddNumberToObject(temp, "burst_on", ane->burst_on)) return;
+    if(!cJSON_AddNumberToObject(temp, "burst_interval", ane->burst_interval)) return;
+    if(!cJSON_AddBoolToObject(temp, "is_adapt_shape", ane->is_adapt_shape)) return;
+    if(!cJSON_AddNumberToObject(temp, "period_min", ane->period_min)) return;
+    if(!cJSON_AddNumberToObject(temp, "period_max", ane->period_max)) return;
+    if(!cJSON_AddNumberToObject(temp, "bat_low", ane->bat_low)) return;
+    if(!cJSON_AddNumberToObject(temp, "bat_critical", ane->bat_critical)) return;
 }
 
 void anemo_load_json(sensor_config_t* config, cJSON* json)
@@ -225,6 +242,9 @@ void anemo_load_json(sensor_config_t* config, cJSON* json)
     if(!config->user_data){
         config->user_data = malloc(sizeof(anemometer_config_t));
         memset(config->user_data, 0, sizeof(anemometer_config_t));
+        ((anemometer_config_t*)config->user_data)->shadow_estimator = ANE_EST_NONE;
+        ((anemometer_config_t*)config->user_data)->is_tof_gate = true;
+        ((anemometer_config_t*)config->user_data)->is_interleaved = true;
     }
     ane = config->user_data;
 
@@ -253,6 +273,51 @@ void anemo_load_json(sensor_config_t* config, cJSON* json)
     temp = cJSON_GetObjectItem(json, "is_dump_error");
     if(cJSON_IsBool(temp))
         ane->is_dump_error = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "filter_type");
+    if(cJSON_IsNumber(temp))
+        ane->filter_type = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "filter_order");
+    if(cJSON_IsNumber(temp))
+        ane->filter_order = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "estimator");
+    if(cJSON_IsNumber(temp))
+        ane->estimator = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "shadow_estimator");
+    if(cJSON_IsNumber(temp))
+        ane->shadow_estimator = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "max_shots");
+    if(cJSON_IsNumber(temp))
+        ane->max_shots = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "is_tof_gate");
+    if(cJSON_IsBool(temp))
+        ane->is_tof_gate = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "is_interleaved");
+    if(cJSON_IsBool(temp))
+        ane->is_interleaved = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "burst_rate");
+    if(cJSON_IsNumber(temp))
+        ane->burst_rate = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "burst_on");
+    if(cJSON_IsNumber(temp))
+        ane->burst_on = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "burst_interval");
+    if(cJSON_IsNumber(temp))
+        ane->burst_interval = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "is_adapt_shape");
+    if(cJSON_IsBool(temp))
+        ane->is_adapt_shape = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "period_min");
+    if(cJSON_IsNumber(temp))
+        ane->period_min = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "period_max");
+    if(cJSON_IsNumber(temp))
+        ane->period_max = temp->valueint;
+    temp = cJSON_GetObjectItem(json, "bat_low");
+    if(cJSON_IsNumber(temp))
+        ane->bat_low = temp->valuedouble;
+    temp = cJSON_GetObjectItem(json, "bat_critical");
+    if(cJSON_IsNumber(temp))
+        ane->bat_critical = temp->valuedouble;
 }
 
 
@@ -355,6 +420,21 @@ void load_default_config(system_config_t* sys)
     ane_cfg->pulse_offset[2] = 0;
     ane_cfg->pulse_offset[3] = 0;
     ane_cfg->is_dump_error = false; // dump adc data when error
+    ane_cfg->filter_type = ANE_FILTER_BA;
+    ane_cfg->filter_order = 2;      // of the sos filters
+    ane_cfg->estimator = ANE_EST_SHAPEMATCH;
+    ane_cfg->shadow_estimator = ANE_EST_NONE;
+    ane_cfg->max_shots = 1;
+    ane_cfg->is_tof_gate = true;    // a single bad channel does not reject the cycle
+    ane_cfg->is_interleaved = true; // same captures as the sequential order, the pairs at a common instant
+    ane_cfg->burst_rate = 0;        // high rate samples for turbulence, 60s every 10min when enabled
+    ane_cfg->burst_on = 60;
+    ane_cfg->burst_interval = 600;
+    ane_cfg->is_adapt_shape = true; // rolled back if more cycles are rejected
+    ane_cfg->period_min = 0;        // adaptive rate, e.g. 250~4000ms when enabled
+    ane_cfg->period_max = 4000;
+    ane_cfg->bat_low = 3.6;
+    ane_cfg->bat_critical = 3.4;
     s->user_data = ane_cfg;
     s->create_json = anemo_create_json;
     s->load_json = anemo_load_json;
@@ -379,6 +459,8 @@ void load_default_config(system_config_t* sys)
     // recorder
     sys->record.is_enable = true;
     sys->record.is_split_file = true;
+    sys->record.is_stream = false;
+    sys->record.is_binary = false;
     strcpy(sys->record.header, "");
     sys->record.period = 1000;
     sys->record.max_file_size = 4096*1024; // 4MB
@@ -406,6 +488,7 @@ void load_default_config(system_config_t* sys)
     strcpy(sys->mqtt.topic_prefix, ""); // allows you to add a super topic before data.
     strcpy(sys->mqtt.uri, "");
     sys->mqtt.port = 1883;
+    sys->mqtt.is_timestamp = false;
 
     // gnss
     sys->gnss.is_enable = true;
@@ -491,6 +574,14 @@ int load_config_from_json(system_config_t* sys, char* json_strings)
         if(cJSON_IsBool(temp))
             sys->record.is_split_file = temp->valueint;
 
+        temp = cJSON_GetObjectItem(record, "stream");
+        if(cJSON_IsBool(temp))
+            sys->record.is_stream = temp->valueint;
+
+        temp = cJSON_GetObjectItem(record, "binary");
+        if(cJSON_IsBool(temp))
+            sys->record.is_binary = temp->valueint;
+
         temp = cJSON_GetObjectItem(record, "period");
         if(cJSON_IsNumber(temp))
             sys->record.period = temp->valueint;
@@ -564,6 +655,10 @@ int load_config_from_json(system_config_t* sys, char* json_strings)
         temp = cJSON_GetObjectItem(mqtt, "topic_prefix");
         if(cJSON_IsString(temp) && temp->string != NULL)
             strncpy(sys->mqtt.topic_prefix, temp->valuestring, sizeof(sys->mqtt.topic_prefix));
+
+        temp = cJSON_GetObjectItem(mqtt, "timestamp");
+        if(cJSON_IsBool(temp))
+            sys->mqtt.is_timestamp = temp->valueint;
     }
 
     // gnss
@@ -714,6 +809,8 @@ char* create_json_from_config(system_config_t* sys)
     if(!cJSON_AddItemToObject(config, "record", record)) goto end;
     if(!cJSON_AddBoolToObject(record, "enable", sys->record.is_enable)) goto end;
     if(!cJSON_AddBoolToObject(record, "split_file", sys->record.is_split_file)) goto end;
+    if(!cJSON_AddBoolToObject(record, "stream", sys->record.is_stream)) goto end;
+    if(!cJSON_AddBoolToObject(record, "binary", sys->record.is_binary)) goto end;
     if(!cJSON_AddStringToObject(record, "header", sys->record.header)) goto end;
     if(!cJSON_AddStringToObject(record, "data_path", sys->record.data_path)) goto end;
     if(!cJSON_AddNumberToObject(record, "period", sys->record.period)) goto end;
@@ -743,6 +840,7 @@ char* create_json_from_config(system_config_t* sys)
     if(!cJSON_AddNumberToObject(mqtt, "port", sys->mqtt.port)) goto end;
     if(!cJSON_AddStringToObject(mqtt, "pub_data", sys->mqtt.pub_data)) goto end;
     if(!cJSON_AddStringToObject(mqtt, "topic_prefix", sys->mqtt.topic_prefix)) goto end;
+    if(!cJSON_AddBoolToObject(mqtt, "timestamp", sys->mqtt.is_timestamp)) goto end;
 
     gnss = cJSON_CreateObject();
     if(!gnss) goto end;
@@ -41,6 +41,8 @@ typedef struct record_config
     // recording
     bool is_enable;
     bool is_split_file;
+    bool is_stream;             // every update of the recorded sensors to a file of its own, lossless.
+    bool is_binary;             // binary record (.qrec) instead of csv, host/qingdump converts it back.
     char data_path[MAX_PATH_LEN]; // the root of recording file. no longer than 31 chars.
     char header[MAX_HEADER_LEN];    // the header of recording, it also control what data will be recorded.
     uint32_t period;            // millisecond
@@ -73,6 +75,21 @@ typedef struct _anemometer_config_t
     float pitch;    // pitch size between transducer.
     float pulse_offset[4]; // time offset for each channel.
     bool is_dump_error; // save error
+    uint8_t filter_type;    // band pass filter, see ane_filter_type_t: 0=ba, 1=sos_f32, 2=sos_q31, 3=sos_q15
+    uint8_t filter_order;   // order of band pass, 1~2
+    uint8_t estimator;      // time of flight estimator, see ane_est_type_t: 0=shapematch, 1=xcorr
+    int8_t  shadow_estimator; // estimator to compare on the same captures, -1 = none
+    uint8_t max_shots;      // coherent stacking, captures averaged in a cycle at most, 1 = off
+    bool is_tof_gate;       // a bad channel is replaced by its prediction, off = a bad channel rejects the cycle
+    bool is_interleaved;    // nested order of the reciprocal pairs, E N S W, both pairs at a common instant
+    uint8_t burst_rate;     // Hz, 4~10, 0 = no burst mode
+    uint16_t burst_on;      // s, burst length in every interval
+    uint16_t burst_interval;// s
+    bool is_adapt_shape;    // adapt the reference echo shape to the ageing transducers, shape matching only
+    uint16_t period_min;    // ms, adaptive rate, fastest period, 0 = fixed rate
+    uint16_t period_max;    // ms, slowest period in calm wind or low battery
+    float bat_low;          // V, under it the rate is limited
+    float bat_critical;     // V, at period_max under it
 } anemometer_config_t;
 
 typedef struct _rain_config_t
@@ -100,6 +117,7 @@ typedef struct _mqtt_config_t
     int port;           // port
     int period;         // update period in ms
     bool is_enable;
+    bool is_timestamp;  // a value is published as "value,time", the UTC it was acquired
 } mqtt_config_t;
 
 typedef struct _gnss_config_t
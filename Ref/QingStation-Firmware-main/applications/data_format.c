@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <string.h>
+#include "data_format.h"
+
+static const uint32_t pow10_u32[FORMAT_PREC_MAX + 1] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// decimal digits of v, at least min_digits with leading zeros.
+static int digits_u32(char *buf, uint32_t v, int min_digits)
+{
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v || n < min_digits);
+    for(int i=0; i<n; i++)
+        buf[i] = tmp[n - 1 - i];
+    return n;
+}
+
+// the 64bit division is slow on the MCU, in chunks of 9 digits.
+static int digits_u64(char *buf, uint64_t v, int min_digits)
+{
+    if(v <= UINT32_MAX && min_digits <= 10)
+        return digits_u32(buf, v, min_digits);
+    uint32_t low = v % 1000000000;
+    int len = digits_u64(buf, v / 1000000000, min_digits > 9 ? min_digits - 9 : 1);
+    return len + digits_u32(buf + len, low, 9);
+}
+
+// m * 2^e, up to 2^128, by the division of a multi-word integer.
+static int digits_big(char *buf, uint32_t m, int e)
+{
+    uint32_t w[5] = {0};
+    uint32_t chunk[5];
+    int top = 4, n = 0, len;
+    uint64_t shifted = (uint64_t)m << (e % 32);
+    w[e / 32] = (uint32_t)shifted;
+    w[e / 32 + 1] = (uint32_t)(shifted >> 32);
+    while(top > 0 && w[top] == 0)
+        top--;
+    // chunks of 9 digits, the lowest first.
+    do {
+        uint64_t r = 0;
+        for(int i=top; i>=0; i--)
+        {
+            uint64_t cur = (r << 32) | w[i];
+            w[i] = cur / 1000000000;
+            r = cur % 1000000000;
+        }
+        chunk[n++] = r;
+        while(top > 0 && w[top] == 0)
+            top--;
+    } while(top > 0 || w[0]);
+    len = digits_u32(buf, chunk[n - 1], 1);
+    for(int i=n-2; i>=0; i--)
+        len += digits_u32(buf + len, chunk[i], 9);
+    return len;
+}
+
+// m * 2^-s in the decimals, rounded half to even by the bits shifted out. below 2^54.
+static uint64_t fixed_round(uint32_t m, int s, int precision)
+{
+    uint64_t scaled = (uint64_t)m * pow10_u32[precision];
+    uint64_t q = 0;
+    if(s < 64)
+    {
+        uint64_t rem = scaled & ((1ull << s) - 1);
+        uint64_t half = 1ull << (s - 1);
+        q = scaled >> s;
+        if(rem > half || (rem == half && (q & 1)))
+            q++;
+    }
+    return q;
+}
+
+int format_float(char *buf, float v, int precision)
+{
+    union {float f; uint32_t u;} x = {.f = v};
+    uint32_t biased = (x.u >> 23) & 0xFF;
+    uint32_t frac = x.u & 0x7FFFFF;
+    int len = 0;
+
+    if(precision < 0)
+        precision = 0;
+    if(precision > FORMAT_PREC_MAX)
+        precision = FORMAT_PREC_MAX;
+    if(x.u >> 31)
+        buf[len++] = '-';
+    if(biased == 0xFF)
+        return len + format_str(buf + len, frac ? "nan" : "inf");
+
+    // v = m * 2^e exactly
+    uint32_t m = biased ? frac | 0x800000 : frac;
+    int e = (biased ? biased : 1) - 150;
+    if(e >= 0)
+    {
+        // an integer, the decimals are 0.
+        if(e < 40)
+            len += digits_u64(buf + len, (uint64_t)m << e, 1);
+        else
+            len += digits_big(buf + len, m, e);
+        if(precision)
+        {
+            buf[len++] = '.';
+            memset(buf + len, '0', precision);
+            len += precision;
+        }
+    }
+    else
+    {
+        // scaled by the decimals then rounded.
+        uint64_t q = fixed_round(m, -e, precision);
+        uint32_t fraction;
+        if(q <= UINT32_MAX)
+        {
+            len += digits_u32(buf + len, (uint32_t)q / pow10_u32[precision], 1);
+            fraction = (uint32_t)q % pow10_u32[precision];
+        }
+        else
+        {
+            len += digits_u64(buf + len, q / pow10_u32[precision], 1);
+            fraction = q % pow10_u32[precision];
+        }
+        if(precision)
+        {
+            buf[len++] = '.';
+            len += digits_u32(buf + len, fraction, precision);
+        }
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+bool format_float_fixed(float v, int precision, int64_t *fixed)
+{
+    union {float f; uint32_t u;} x = {.f = v};
+    uint32_t biased = (x.u >> 23) & 0xFF;
+    uint32_t frac = x.u & 0x7FFFFF;
+    uint64_t q;
+
+    if(precision < 0)
+        precision = 0;
+    if(precision > FORMAT_PREC_MAX)
+        precision = FORMAT_PREC_MAX;
+    if(biased == 0xFF)
+        return false;
+    uint32_t m = biased ? frac | 0x800000 : frac;
+    int e = (biased ? biased : 1) - 150;
+    if(e >= 0)
+    {
+        // m < 2^24, the decimals < 2^30.
+        if(e > 62 - 24 - 30)
+            return false;
+        q = ((uint64_t)m << e) * pow10_u32[precision];
+    }
+    else
+        q = fixed_round(m, -e, precision);
+    // "-0.00" has no integer.
+    if(x.u >> 31)
+    {
+        if(q == 0)
+            return false;
+        *fixed = -(int64_t)q;
+    }
+    else
+        *fixed = q;
+    return true;
+}
+
+int format_fixed(char *buf, int64_t fixed, int precision)
+{
+    int len = 0;
+    uint64_t u = fixed;
+    if(precision < 0)
+        precision = 0;
+    if(precision > FORMAT_PREC_MAX)
+        precision = FORMAT_PREC_MAX;
+    if(fixed < 0)
+    {
+        buf[len++] = '-';
+        u = 0u - u;
+    }
+    len += digits_u64(buf + len, u / pow10_u32[precision], 1);
+    if(precision)
+    {
+        buf[len++] = '.';
+        len += digits_u32(buf + len, u % pow10_u32[precision], precision);
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+int format_int(char *buf, int32_t v)
+{
+    int len = 0;
+    uint32_t u = v;
+    if(v < 0)
+    {
+        buf[len++] = '-';
+        u = 0u - u;
+    }
+    len += digits_u32(buf + len, u, 1);
+    buf[len] = '\0';
+    return len;
+}
+
+int format_trunc(char *buf, float v)
+{
+    if(v > -2147483648.f && v < 2147483648.f)
+        return format_int(buf, (int32_t)v);
+    return format_float(buf, v, 0);
+}
+
+int format_uint(char *buf, uint32_t v)
+{
+    int len = digits_u32(buf, v, 1);
+    buf[len] = '\0';
+    return len;
+}
+
+int format_str(char *buf, const char *s)
+{
+    int len = strlen(s);
+    memcpy(buf, s, len + 1);
+    return len;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __DATA_FORMAT_H__
+#define __DATA_FORMAT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number to text for the data pool, without the newlib printf.
+// The float in fixed decimals is exactly what printf("%.*f") prints, the exact value of the float
+// rounded half to even. Reentrant, no lock and no allocation, a few words of stack.
+// Each function writes a null terminated string and returns its length without the null.
+
+#define FORMAT_PREC_MAX     (9)     // decimals of a float at most
+#define FORMAT_FLOAT_LEN    (50)    // buffer for any float in FORMAT_PREC_MAX decimals
+
+int format_float(char *buf, float v, int precision);
+// the float in fixed decimals as an integer, v * 10^precision rounded as format_float() prints it.
+// false if it is not finite, too large, or a negative zero.
+bool format_float_fixed(float v, int precision, int64_t *fixed);
+// print the integer of format_float_fixed(), the same text as format_float().
+int format_fixed(char *buf, int64_t fixed, int precision);
+int format_int(char *buf, int32_t v);
+// the integer part of a float, as printf("%d", (int)v), for the data of no decimals.
+// format_float() if it is out of int32 or not a number.
+int format_trunc(char *buf, float v);
+int format_uint(char *buf, uint32_t v);
+// copy a string, like stpcpy() but returns the length.
+int format_str(char *buf, const char *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DATA_FORMAT_H__ */
@@ -31,11 +31,15 @@ typedef struct _triaxis_int_t
 } triaxis_int_t;
 
 
+struct _data_stream_t;
+
 typedef struct _sensor_info_t
 {
-    float update_rate;
-    float update_timestamp;
+    uint64_t update_us;     // monotonic time of the acquisition of the last update, timebase_us()
+    float update_rate;      // Hz
     uint32_t count;
+    volatile uint32_t seq;  // sequence lock, odd while the instance is being written
+    struct _data_stream_t *volatile stream; // every update is a sample of it, NULL = no stream
 }sensor_info_t;
 
 
@@ -76,11 +80,38 @@ typedef struct _anemometer_t {
     float speed;
     float speed30savg;
     float speed30smax;
+    float speed2mavg;
+    float speed10mavg;
+    float gust10m;      // maximum 3s average in 10min
+    float course2mavg;  // vector averaged
+    float course10mavg;
+    float course10mstd; // standard deviation of the direction in 10min
     float soundspeed;
     int err_code;
+    uint32_t gated;     // channel measurements replaced by the prediction
+    uint32_t retried;   // cycles measured again after rejected
+    uint32_t shots;     // captures stacked in a cycle
+    float rate;         // Hz, measurement rate
 } anemometer_t;
 extern anemometer_t anemometer;
 
+// signal quality and error telemetry of the anemometer, a snapshot updated every minute.
+// channels in N, E, S, W.
+typedef struct _anemometer_diag_t {
+    sensor_info_t info;
+    float snr[4];           // dB
+    float amp[4];           // echo peak, ADC LSB
+    float mse[4];           // shape matching error
+    int peak_off[4];
+    uint32_t err_count[4];  // cycles rejected by ERR_MSE_NAN ~ ERR_WINDSPEED
+    float err_rate[4];      // % of cycles
+    float retry_ratio;      // % of cycles are retries
+    float dsp_p50;          // processing time percentiles, us
+    float dsp_p90;
+    float dsp_p99;
+} anemometer_diag_t;
+extern anemometer_diag_t anemometer_diag;
+
 typedef struct _air_info_t {
     sensor_info_t info;
     float pressure;
@@ -137,24 +168,269 @@ typedef struct _sys_t
 extern sys_t sys;
 
 
+/* a producer writes an instance between data_begin_write() and data_updated(),
+ * the readers copy it by data_snapshot() and retry if it was written meanwhile.
+ * a single core, the compiler barrier is enough. */
+static inline void data_begin_write(sensor_info_t *info)
+{
+    info->seq++;
+    __asm volatile("" ::: "memory");
+}
+
+/* end a write that is not a new update, e.g. the status of the producer, no rate, counter or stream sample. */
+static inline void data_end_write(sensor_info_t *info)
+{
+    __asm volatile("" ::: "memory");
+    info->seq++;
+}
+
+/* end the write of an instance, update its rate and counter.
+ * us is the monotonic time the values were acquired, data_updated() takes it now. */
+void data_updated_at(sensor_info_t *info, uint64_t us);
 void data_updated(sensor_info_t *info);
 
+/* copy an instance consistently, never blocks the producer.
+ * a write is a few stores, the reader yields a few times before it sleeps a tick for a preempted producer. */
+#define DATA_SNAPSHOT_SPIN  (8)
+void data_snapshot(const sensor_info_t *info, void *dst, size_t size);
+
+/* sample streams.
+ * the data pool only keeps the latest values, a consumer polling it at its own rate drops or repeats updates.
+ * an instance can have a stream, data_updated() pushes a copy of the instance to a ring, its info has the time.
+ * single writer, each reader has its own position, the samples overwritten before they were read are counted.
+ * a stream is created by the first consumer asks for it and shared by the others. */
+typedef struct _data_stream_t
+{
+    uint32_t size;          // of the instance
+    uint32_t slot;          // bytes of a sample, the instance aligned to 8
+    uint32_t len;           // samples, power of 2
+    volatile uint32_t head; // samples written so far
+    uint8_t *buf;
+} data_stream_t;
+
+typedef struct _data_stream_reader_t
+{
+    uint32_t tail;          // samples read so far
+    uint32_t lost;          // samples overwritten before they were read
+} data_stream_reader_t;
+
+#define DATA_STREAM_LEN     (64)    // samples, default length of a stream
+
+/* the stream of an instance, created with len samples if it has none. NULL if out of memory.
+ * a reader can fall behind by len-1 samples at most, the slot of the oldest one is the next written. */
+data_stream_t *data_stream_open(sensor_info_t *info, uint32_t size, uint32_t len);
+/* the reader starts from the newest sample. */
+void data_stream_reader_init(data_stream_t *s, data_stream_reader_t *rd);
+/* copy up to max samples to out (max * s->slot bytes, aligned to 8), oldest first. return the number of samples. */
+int data_stream_read(data_stream_t *s, data_stream_reader_t *rd, void *out, int max);
+
+// the copy of the instance of the sample i in the output of data_stream_read(), and its time.
+static inline const void *data_stream_sample(const data_stream_t *s, const void *out, int i)
+{
+    return (const uint8_t *)out + i * s->slot;
+}
+static inline uint64_t data_stream_us(const data_stream_t *s, const void *out, int i)
+{
+    return ((const sensor_info_t *)data_stream_sample(s, out, i))->update_us;
+}
+
 
 #define DATA_NAME_MAX_LEN   (16)
 
-/*  names and getters for availalbe recording and data */
-extern float (*get_data[])();
-extern int (*print_data[])(char* );
-extern const char data_name[][DATA_NAME_MAX_LEN];
+// type of a value in the data pool
+typedef enum {
+    DATA_NONE = 0,
+    DATA_FLOAT,
+    DATA_INT,       // int32
+    DATA_UINT,      // uint32
+    DATA_BOOL,
+} data_type_t;
+
+/*  all the data can be recorded, logged and published, in one place.
+ *  X(name, struct type, instance, member, type, unit, precision), precision is the decimals of a float.
+ *  the data from ane_snr_n are diagnostics, they are only recorded when named in the header. */
+#define DATA_POOL_LIST(X) \
+    X(gyro_x,       gyro_t,             gyro,           unit.x,         DATA_FLOAT, "dps",  4) \
+    X(gyro_y,       gyro_t,             gyro,           unit.y,         DATA_FLOAT, "dps",  4) \
+    X(gyro_z,       gyro_t,             gyro,           unit.z,         DATA_FLOAT, "dps",  4) \
+    X(acc_x,        acc_t,              acc,            unit.x,         DATA_FLOAT, "g",    4) \
+    X(acc_y,        acc_t,              acc,            unit.y,         DATA_FLOAT, "g",    4) \
+    X(acc_z,        acc_t,              acc,            unit.z,         DATA_FLOAT, "g",    4) \
+    X(mag_x,        mag_t,              mag,            unit.x,         DATA_FLOAT, "",     0) \
+    X(mag_y,        mag_t,              mag,            unit.y,         DATA_FLOAT, "",     0) \
+    X(mag_z,        mag_t,              mag,            unit.z,         DATA_FLOAT, "",     0) \
+    X(eular_x,      orientation_t,      orientation,    euler.x,        DATA_FLOAT, "deg",  2) \
+    X(eular_y,      orientation_t,      orientation,    euler.y,        DATA_FLOAT, "deg",  2) \
+    X(eular_z,      orientation_t,      orientation,    euler.z,        DATA_FLOAT, "deg",  2) \
+    X(quat_q0,      orientation_t,      orientation,    q[0],           DATA_FLOAT, "",     7) \
+    X(quat_q1,      orientation_t,      orientation,    q[1],           DATA_FLOAT, "",     7) \
+    X(quat_q2,      orientation_t,      orientation,    q[2],           DATA_FLOAT, "",     7) \
+    X(quat_q3,      orientation_t,      orientation,    q[3],           DATA_FLOAT, "",     7) \
+    X(pressure,     air_info_t,         air_info,       pressure,       DATA_FLOAT, "Pa",   2) \
+    X(humidity,     air_info_t,         air_info,       humidity,       DATA_FLOAT, "%",    2) \
+    X(air_temp,     air_info_t,         air_info,       temperature,    DATA_FLOAT, "C",    3) \
+    X(red,          light_info_t,       light_info,     R,              DATA_INT,   "",     0) \
+    X(green,        light_info_t,       light_info,     G,              DATA_INT,   "",     0) \
+    X(blue,         light_info_t,       light_info,     B,              DATA_INT,   "",     0) \
+    X(infrared,     light_info_t,       light_info,     IR,             DATA_INT,   "",     0) \
+    X(als,          light_info_t,       light_info,     ALS,            DATA_INT,   "",     0) \
+    X(rain_level,   rain_t,             rain,           level,          DATA_INT,   "",     0) \
+    X(rain_raw,     rain_t,             rain,           raw,            DATA_INT,   "",     0) \
+    X(rain_var,     rain_t,             rain,           var,            DATA_FLOAT, "",     2) \
+    X(lightning,    lightning_t,        lightning,      distance,       DATA_FLOAT, "km",   0) \
+    X(gnss_lat,     gnss_t,             gnss,           latitude,       DATA_FLOAT, "deg",  6) \
+    X(gnss_long,    gnss_t,             gnss,           longitude,      DATA_FLOAT, "deg",  6) \
+    X(gnss_speed,   gnss_t,             gnss,           speed,          DATA_FLOAT, "m/s",  2) \
+    X(gnss_alt,     gnss_t,             gnss,           altitude,       DATA_FLOAT, "m",    2) \
+    X(gnss_course,  gnss_t,             gnss,           course,         DATA_FLOAT, "deg",  1) \
+    X(gnss_sat,     gnss_t,             gnss,           num_sat,        DATA_INT,   "",     0) \
+    X(gnss_fixed,   gnss_t,             gnss,           is_fixed,       DATA_BOOL,  "",     0) \
+    X(wind_dir,     anemometer_t,       anemometer,     course,         DATA_FLOAT, "deg",  2) \
+    X(wind_speed,   anemometer_t,       anemometer,     speed,          DATA_FLOAT, "m/s",  2) \
+    X(wind_30savg,  anemometer_t,       anemometer,     speed30savg,    DATA_FLOAT, "m/s",  2) \
+    X(wind_gust,    anemometer_t,       anemometer,     speed30smax,    DATA_FLOAT, "m/s",  2) \
+    X(wind_2mavg,   anemometer_t,       anemometer,     speed2mavg,     DATA_FLOAT, "m/s",  2) \
+    X(wind_10mavg,  anemometer_t,       anemometer,     speed10mavg,    DATA_FLOAT, "m/s",  2) \
+    X(wind_gust10m, anemometer_t,       anemometer,     gust10m,        DATA_FLOAT, "m/s",  2) \
+    X(wind_dir2m,   anemometer_t,       anemometer,     course2mavg,    DATA_FLOAT, "deg",  2) \
+    X(wind_dir10m,  anemometer_t,       anemometer,     course10mavg,   DATA_FLOAT, "deg",  2) \
+    X(wind_dirstd,  anemometer_t,       anemometer,     course10mstd,   DATA_FLOAT, "deg",  2) \
+    X(sndspeed,     anemometer_t,       anemometer,     soundspeed,     DATA_FLOAT, "m/s",  2) \
+    X(ane_err,      anemometer_t,       anemometer,     err_code,       DATA_INT,   "",     0) \
+    X(ane_gated,    anemometer_t,       anemometer,     gated,          DATA_UINT,  "",     0) \
+    X(ane_retry,    anemometer_t,       anemometer,     retried,        DATA_UINT,  "",     0) \
+    X(ane_shots,    anemometer_t,       anemometer,     shots,          DATA_UINT,  "",     0) \
+    X(ane_rate,     anemometer_t,       anemometer,     rate,           DATA_FLOAT, "Hz",   2) \
+    X(bat_volt,     sys_t,              sys,            bat_voltage,    DATA_FLOAT, "V",    3) \
+    X(sys_volt,     sys_t,              sys,            sys_voltage,    DATA_FLOAT, "V",    3) \
+    X(mcu_temp,     sys_t,              sys,            mcu_temp,       DATA_FLOAT, "C",    1) \
+    X(ane_snr_n,    anemometer_diag_t,  anemometer_diag, snr[0],        DATA_FLOAT, "dB",   1) \
+    X(ane_snr_e,    anemometer_diag_t,  anemometer_diag, snr[1],        DATA_FLOAT, "dB",   1) \
+    X(ane_snr_s,    anemometer_diag_t,  anemometer_diag, snr[2],        DATA_FLOAT, "dB",   1) \
+    X(ane_snr_w,    anemometer_diag_t,  anemometer_diag, snr[3],        DATA_FLOAT, "dB",   1) \
+    X(ane_amp_n,    anemometer_diag_t,  anemometer_diag, amp[0],        DATA_FLOAT, "LSB",  0) \
+    X(ane_amp_e,    anemometer_diag_t,  anemometer_diag, amp[1],        DATA_FLOAT, "LSB",  0) \
+    X(ane_amp_s,    anemometer_diag_t,  anemometer_diag, amp[2],        DATA_FLOAT, "LSB",  0) \
+    X(ane_amp_w,    anemometer_diag_t,  anemometer_diag, amp[3],        DATA_FLOAT, "LSB",  0) \
+    X(ane_mse_n,    anemometer_diag_t,  anemometer_diag, mse[0],        DATA_FLOAT, "",     4) \
+    X(ane_mse_e,    anemometer_diag_t,  anemometer_diag, mse[1],        DATA_FLOAT, "",     4) \
+    X(ane_mse_s,    anemometer_diag_t,  anemometer_diag, mse[2],        DATA_FLOAT, "",     4) \
+    X(ane_mse_w,    anemometer_diag_t,  anemometer_diag, mse[3],        DATA_FLOAT, "",     4) \
+    X(ane_poff_n,   anemometer_diag_t,  anemometer_diag, peak_off[0],   DATA_INT,   "",     0) \
+    X(ane_poff_e,   anemometer_diag_t,  anemometer_diag, peak_off[1],   DATA_INT,   "",     0) \
+    X(ane_poff_s,   anemometer_diag_t,  anemometer_diag, peak_off[2],   DATA_INT,   "",     0) \
+    X(ane_poff_w,   anemometer_diag_t,  anemometer_diag, peak_off[3],   DATA_INT,   "",     0) \
+    X(ane_n_nan,    anemometer_diag_t,  anemometer_diag, err_count[0],  DATA_UINT,  "",     0) \
+    X(ane_n_shape,  anemometer_diag_t,  anemometer_diag, err_count[1],  DATA_UINT,  "",     0) \
+    X(ane_n_align,  anemometer_diag_t,  anemometer_diag, err_count[2],  DATA_UINT,  "",     0) \
+    X(ane_n_speed,  anemometer_diag_t,  anemometer_diag, err_count[3],  DATA_UINT,  "",     0) \
+    X(ane_r_nan,    anemometer_diag_t,  anemometer_diag, err_rate[0],   DATA_FLOAT, "%",    2) \
+    X(ane_r_shape,  anemometer_diag_t,  anemometer_diag, err_rate[1],   DATA_FLOAT, "%",    2) \
+    X(ane_r_align,  anemometer_diag_t,  anemometer_diag, err_rate[2],   DATA_FLOAT, "%",    2) \
+    X(ane_r_speed,  anemometer_diag_t,  anemometer_diag, err_rate[3],   DATA_FLOAT, "%",    2) \
+    X(ane_retry_r,  anemometer_diag_t,  anemometer_diag, retry_ratio,   DATA_FLOAT, "%",    2) \
+    X(ane_dsp_p50,  anemometer_diag_t,  anemometer_diag, dsp_p50,       DATA_FLOAT, "us",   0) \
+    X(ane_dsp_p90,  anemometer_diag_t,  anemometer_diag, dsp_p90,       DATA_FLOAT, "us",   0) \
+    X(ane_dsp_p99,  anemometer_diag_t,  anemometer_diag, dsp_p99,       DATA_FLOAT, "us",   0)
+
+/* instances of the data, X(struct type, instance) */
+#define DATA_INSTANCE_LIST(X) \
+    X(gyro_t,               gyro) \
+    X(acc_t,                acc) \
+    X(mag_t,                mag) \
+    X(orientation_t,        orientation) \
+    X(air_info_t,           air_info) \
+    X(light_info_t,         light_info) \
+    X(rain_t,               rain) \
+    X(lightning_t,          lightning) \
+    X(gnss_t,               gnss) \
+    X(anemometer_t,         anemometer) \
+    X(anemometer_diag_t,    anemometer_diag) \
+    X(sys_t,                sys)
+
+#define DATA_INSTANCE_COUNT(type, inst)     + 1
+enum { DATA_INSTANCE_NUM = 0 DATA_INSTANCE_LIST(DATA_INSTANCE_COUNT) };
+
+// index of each instance, DATA_INST_xxx
+#define DATA_INSTANCE_ID(type, inst)        DATA_INST_##inst,
+enum { DATA_INSTANCE_LIST(DATA_INSTANCE_ID) };
+
+// consistent copies of the instances, the fields of a sample are read from it.
+#define DATA_FRAME_MEMBER(type, inst)   type inst;
+typedef struct _data_frame_t
+{
+    DATA_INSTANCE_LIST(DATA_FRAME_MEMBER)
+} data_frame_t;
+
+// index of each data, DATA_ID_unknown is for the names not found.
+#define DATA_ID(name, ...)  DATA_ID_##name,
+enum {
+    DATA_ID_unknown = 0,
+    DATA_POOL_LIST(DATA_ID)
+    DATA_NUM
+};
+
+typedef struct _data_desc_t
+{
+    const char *name;
+    uint8_t type;           // data_type_t
+    uint8_t precision;      // decimals of a float
+    uint16_t offset;        // of the value in its instance
+    uint16_t size;          // of the instance
+    uint16_t frame;         // offset of the instance in data_frame_t
+    uint8_t instance;       // DATA_INST_xxx
+    const char *unit;
+    sensor_info_t *info;    // the instance, its count is the update counter. NULL for unknown.
+} data_desc_t;
+
+/* descriptors in the order of DATA_ID_xxx */
+extern const data_desc_t data_desc[DATA_NUM];
+
+#define EXPORT_DATA_SIZE    (DATA_NUM)
+// data from here are diagnostics, they are only recorded when named in the header.
+#define EXPORT_DIAG_START   (DATA_ID_ane_snr_n)
+// max data a log, recorder or publisher can select.
+#define DATA_ORDER_MAX      (96)
+
+// address of the value in a frame.
+static inline const void *data_ptr(const data_frame_t *f, const data_desc_t *d)
+{
+    return (const char *)f + d->frame + d->offset;
+}
+
+// value in a frame as float, -1 for unknown.
+static inline float data_get(const data_frame_t *f, const data_desc_t *d)
+{
+    switch(d->type)
+    {
+    case DATA_FLOAT: return *(const float *)data_ptr(f, d);
+    case DATA_INT: return *(const int32_t *)data_ptr(f, d);
+    case DATA_UINT: return *(const uint32_t *)data_ptr(f, d);
+    case DATA_BOOL: return *(const bool *)data_ptr(f, d);
+    default: return -1;
+    }
+}
+
+// times the instance of the data is updated.
+static inline uint32_t data_count(const data_desc_t *d)
+{
+    return d->info ? d->info->count : 0;
+}
+
+/* print the value in a frame to buf in its precision, return the length. */
+int data_print(const data_frame_t *f, const data_desc_t *d, char *buf);
+/* the same from a copy of its instance, such as a stream sample. */
+int data_print_from(const void *inst, const data_desc_t *d, char *buf);
 
-extern const int EXPORT_DATA_SIZE;
+/* snapshot the instances of the fields to the frame, each once. */
+void data_frame_take(data_frame_t *f, const data_desc_t **fields, uint32_t num);
 
-/* get data getter index by its name*/
-uint32_t get_data_index(char* name);
+/* find the descriptor by name, the one of unknown if not found. */
+const data_desc_t *data_find(const char *name);
 
-/* get a list of names return the order of their getters
+/* get a list of names and bind the descriptors of them.
  * This will use strtok which will destroy the input strings. */
-uint32_t get_data_orders(char* names, char* delim, uint16_t *orders, uint16_t max_order_len);
+uint32_t data_bind(char *names, char *delim, const data_desc_t **fields, uint16_t max_fields);
 
 
 #endif /* __DATA_POOL_H__ */
@@ -12,6 +12,7 @@
 #include <rtdevice.h>
 #include <board.h>
 #include <data_pool.h>
+#include "timebase.h"
 #include "drv_bme280.h"
 #include "recorder.h"
 #include "stdio.h"
@@ -43,13 +44,15 @@ void thread_environment(void* parameters)
     while(1)
     {
         rt_thread_mdelay(period - rt_tick_get()%period);
+        uint64_t us = timebase_us();
         bme280_get_data(&H, &T, &P);
 
         // write to global data pool
+        data_begin_write(&air_info.info);
         air_info.humidity = H;
         air_info.pressure = P;
         air_info.temperature = T;
-        data_updated(&air_info.info);
+        data_updated_at(&air_info.info, us);
 
         rt_thread_delay(2);
         //LOG_D("Humidity: %3.1f%%, Temp: %2.2f Degree, Pressure: %.3f Pa", H, T, P);
@@ -20,6 +20,7 @@
 #include "configuration.h"
 #include "minmea.h"
 #include "data_pool.h"
+#include "timebase.h"
 
 #define DBG_TAG "gnss"
 #define DBG_LVL DBG_LOG
@@ -188,6 +189,7 @@ void thread_gnss(void* p)
     int32_t size;
     int32_t index = 0;
     char ch;
+    uint64_t line_us = 0;   // when the sentence started to arrive
     int gnss_bitrate = -1;
     struct serial_configure config = RT_SERIAL_CONFIG_DEFAULT;
     gnss_config_t *cfg = NULL;
@@ -254,6 +256,8 @@ void thread_gnss(void* p)
         for(int i=0; i<size; i++)
         {
             ch = buf[i];
+            if(index == 0)
+                line_us = timebase_us();
             line[index++] = ch;
 
             // if sentance completed, process.
@@ -271,15 +275,21 @@ void thread_gnss(void* p)
                         set_date(rmc_frame.date.year+2000, rmc_frame.date.month, rmc_frame.date.day);
                         set_time(rmc_frame.time.hours, rmc_frame.time.minutes, rmc_frame.time.seconds);
                     }
+                    // the fix is at the time of the sentence, late by its transmission.
+                    if(rmc_frame.valid)
+                        timebase_sync(timebase_make_utc(rmc_frame.date.year+2000, rmc_frame.date.month,
+                                rmc_frame.date.day, rmc_frame.time.hours, rmc_frame.time.minutes,
+                                rmc_frame.time.seconds, rmc_frame.time.microseconds), line_us, TIMEBASE_SRC_GNSS);
+                    data_begin_write(&gnss.info);
                     gnss.latitude = minmea_tocoord(&rmc_frame.latitude);
                     gnss.longitude = minmea_tocoord(&rmc_frame.longitude);
                     gnss.course = minmea_tofloat(&rmc_frame.course);
                     gnss.speed = minmea_tofloat(&rmc_frame.speed);
                     gnss.num_sat = gga_frame.satellites_tracked;
+                    gnss.altitude = minmea_tofloat(&gga_frame.altitude); // of the last GGA, as the satellites
                     gnss.is_fixed = rmc_frame.valid;
+                    data_updated_at(&gnss.info, line_us);
                 }
-                else if (id == MINMEA_SENTENCE_GGA)
-                    gnss.altitude = minmea_tofloat(&gga_frame.altitude);
 
                 if(is_echo)
                     printf(line);
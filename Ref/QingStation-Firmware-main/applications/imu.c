@@ -16,6 +16,7 @@
 #include "recorder.h"
 #include "drv_bmx160.h"
 #include "data_pool.h"
+#include "timebase.h"
 #include "configuration.h"
 #include "MadgwickAHRS.h"
 #include <math.h>
@@ -113,6 +114,7 @@ void thread_imu(void* parameters)
         if(!cfg->is_enable)
             continue;
 
+        uint64_t us = timebase_us();
         imu->read_raw(imu);
 
         // mag calibration
@@ -132,6 +134,7 @@ void thread_imu(void* parameters)
         imu->unit.temperature = imu->raw.temperature * 0.002 + 23;
 
         // write to global data pool
+        data_begin_write(&gyro.info);
         gyro.raw.x = imu->raw.gyro_x;
         gyro.raw.y = imu->raw.gyro_y;
         gyro.raw.z = imu->raw.gyro_z;
@@ -139,8 +142,9 @@ void thread_imu(void* parameters)
         gyro.unit.y = imu->unit.gyro_y;
         gyro.unit.z = imu->unit.gyro_z;
         gyro.temperature = imu->unit.temperature;
-        data_updated(&gyro.info);
+        data_updated_at(&gyro.info, us);
 
+        data_begin_write(&acc.info);
         acc.raw.x = imu->raw.acc_x;
         acc.raw.y = imu->raw.acc_y;
         acc.raw.z = imu->raw.acc_z;
@@ -148,8 +152,9 @@ void thread_imu(void* parameters)
         acc.unit.y = imu->unit.acc_y;
         acc.unit.z = imu->unit.acc_z;
         acc.temperature = imu->unit.temperature;
-        data_updated(&acc.info);
+        data_updated_at(&acc.info, us);
 
+        data_begin_write(&mag.info);
         mag.raw.x = imu->raw.mag_x;
         mag.raw.y = imu->raw.mag_y;
         mag.raw.z = imu->raw.mag_z;
@@ -157,7 +162,7 @@ void thread_imu(void* parameters)
         mag.unit.y = imu->unit.mag_y;
         mag.unit.z = imu->unit.mag_z;
         mag.temperature = imu->unit.temperature;
-        data_updated(&mag.info);
+        data_updated_at(&mag.info, us);
 
         // AHRS
         #define PI 3.1415926f
@@ -167,12 +172,13 @@ void thread_imu(void* parameters)
                 //0,0,0);
                 mag.unit.x, mag.unit.y, mag.unit.z);
 
+        data_begin_write(&orientation.info);
         orientation.q[0] = q0;
         orientation.q[1] = q1;
         orientation.q[2] = q2;
         orientation.q[3] = q3;
         quaternion_to_eular(orientation.q, &orientation.euler);
-        data_updated(&orientation.info);
+        data_updated_at(&orientation.info, us);
 
         //printf("%d, %d, %d\n", (int)(orientation.euler.x*10), (int)(orientation.euler.y*10), (int)(orientation.euler.z*10));
         //LOG_I("%d, %d, %d", (int)gyro.unit.x , (int)gyro.unit.y , (int)gyro.unit.z );
@@ -14,6 +14,7 @@
 #include <board.h>
 #include "drv_apds9250.h"
 #include "data_pool.h"
+#include "timebase.h"
 #include "configuration.h"
 
 #define DBG_TAG "light"
@@ -53,14 +54,16 @@ void thread_light(void* parameters)
         if(!cfg->is_enable)
             continue;
 
+        uint64_t us = timebase_us();
         apds9250_read_rgbir(&r, &g, &b, &ir);
 
+        data_begin_write(&light_info.info);
         light_info.R = r;
         light_info.G = g;
         light_info.B = b;
         light_info.IR = ir;
         light_info.ALS = g;  // it is the same as green.
-        data_updated(&light_info.info);
+        data_updated_at(&light_info.info, us);
 
     }
 }
@@ -14,6 +14,7 @@
 #include <board.h>
 #include "drv_as3935.h"
 #include "data_pool.h"
+#include "timebase.h"
 #include "configuration.h"
 
 #define DBG_TAG "lightning"
@@ -111,6 +112,7 @@ void thread_lightning(void* parameters)
         rt_thread_delay(2);
         rt_thread_delay(period - rt_tick_get()%period);
 
+        uint64_t us = timebase_us();
         as3935_read_data(&distance, &energy);
 
         if(rt_pin_read(INT_PIN))
@@ -131,8 +133,9 @@ void thread_lightning(void* parameters)
         if(is_lightning_print)
             printf("distance: %u, energy:%u\n", distance, energy);
 
+        data_begin_write(&lightning.info);
         lightning.distance = distance;
-        data_updated(&lightning.info);
+        data_updated_at(&lightning.info, us);
     }
 }
 
@@ -24,16 +24,17 @@
 #include <rtdbg.h>
 
 #include "data_pool.h"
+#include "data_format.h"
+#include "telemetry.h"
 
 void thread_log(void* parameters)
 {
-    uint16_t orders[32];
+    const data_desc_t *fields[32];
     uint32_t data_len = 0;
     char str_buf[256] = {0};
     uint32_t str_index = 0;
     bool is_repeated_header;
     rt_device_t usb_cdc = NULL;
-    time_t timep;
 
     // wait until system cfg loaded
     while(!is_system_cfg_valid() && system_config.log.is_enable)
@@ -41,7 +42,9 @@ void thread_log(void* parameters)
 
     // copy for us to destroy :p
     strncpy(str_buf, system_config.log.header, 256);
-    data_len = get_data_orders(str_buf, ", ", orders, 32);
+    data_len = data_bind(str_buf, ", ", fields, 32);
+    if(system_config.log.is_enable)
+        telemetry_subscribe(fields, data_len);
 
     //
     is_repeated_header = system_config.log.is_repeat_header;
@@ -57,22 +60,27 @@ void thread_log(void* parameters)
         if(!system_config.log.is_enable)
             continue;
         str_index = 0;
+        const telemetry_t *t = telemetry_take();
+        if(!t)
+            continue;
 
         // timestamp
-        time(&timep);
-        struct tm * timeinfo = gmtime(&timep);
-        str_index += strftime(str_buf, 32, "%Y%m%d_%H%M%S", timeinfo);
+        str_index += telemetry_stamp(t, str_buf, "_");
 
         for(uint32_t i=0; i<data_len; i++ )
         {
-            str_index += sprintf(str_buf+str_index, ", ");
+            str_index += format_str(str_buf+str_index, ", ");
             if(is_repeated_header)
-                str_index += sprintf(str_buf+str_index,"%s:", data_name[orders[i]]);
-            str_index += print_data[orders[i]](str_buf+str_index);
+            {
+                str_index += format_str(str_buf+str_index, fields[i]->name);
+                str_index += format_str(str_buf+str_index, ":");
+            }
+            str_index += telemetry_print(t, fields[i], str_buf+str_index);
         }
+        telemetry_release(t);
 
         // print
-        str_index += sprintf(str_buf+str_index, "\n");
+        str_index += format_str(str_buf+str_index, "\n");
         printf("%s", str_buf);
 
         // copy to USB cdc
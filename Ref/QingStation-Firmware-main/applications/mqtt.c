@@ -19,7 +19,10 @@
 #include <board.h>
 
 #include "data_pool.h"
+#include "telemetry.h"
+#include "timebase.h"
 #include "configuration.h"
+#include "anemometer_burst.h"
 #include "stm32l4xx_ll_utils.h"
 
 #define DBG_TAG "mqtt"
@@ -447,20 +450,53 @@ MSH_CMD_EXPORT(mqtt_state, print the state of mqtt);
 
 
 
+// burst samples of the anemometer, a few samples in a message separated by ';'.
+// a message is kept until it is published, so nothing is lost while the link is up.
+// return 1 if a message is published, 0 if no sample, -1 if failed.
+#define BURST_TOPIC         "ane_burst"
+#define BURST_MSG_SAMPLES   (6)     // 36 chars each at most, a message is 256 bytes at most.
+static int mqtt_publish_burst(mqtt_config_t *cfg, ane_burst_reader_t *rd)
+{
+    static char msg[BURST_MSG_SAMPLES * 40];
+    static bool is_pending = false;
+    char topic[64];
+    if(!is_pending)
+    {
+        ane_burst_sample_t s[BURST_MSG_SAMPLES];
+        int num = ane_burst_ring_read(&ane_burst_ring, rd, s, BURST_MSG_SAMPLES);
+        int index = 0;
+        if(num == 0)
+            return 0;
+        for(int i=0; i<num; i++)
+        {
+            if(i > 0)
+                msg[index++] = ';';
+            index += ane_burst_format(&s[i], &msg[index], sizeof(msg) - index);
+        }
+        is_pending = true;
+    }
+    snprintf(topic, sizeof(topic), "%s%s", cfg->topic_prefix, BURST_TOPIC);
+    if(mqtt_publish_data(topic, msg, 0) != 0)
+        return -1;
+    is_pending = false;
+    return 1;
+}
+
 void thread_mqtt(void* p)
 {
     #define BUFSIZE  64
     char topic[BUFSIZE] = {0};
-    char line[BUFSIZE] = "test";
+    char line[BUFSIZE + TIMEBASE_FORMAT_LEN] = "test";
     int data_len = 0;
-    uint16_t orders[64] = {0};
-    float last_data[64] = {0}; // whether the data is updated.
+    const data_desc_t *fields[DATA_ORDER_MAX] = {0};
+    float last_data[DATA_ORDER_MAX] = {0}; // whether the data is updated.
     rt_tick_t last_full_update = rt_tick_get();
     bool is_full_update = false;
     mqtt_config_t *cfg;
     int rslt = 0;
     uint64_t msg_count_last = msg_count;
     rt_tick_t msg_count_tick;
+    ane_burst_reader_t burst_reader;
 
     // wait until system cfg loaded
     // wait and load the configuration
@@ -509,15 +545,16 @@ void thread_mqtt(void* p)
     {
         data_len = EXPORT_DATA_SIZE-1; // data 0 is "unknown"
         for(int i=0; i<data_len; i++)
-            orders[i] = i+1;
+            fields[i] = &data_desc[i+1];
     }
     // if the field is empty, then we print all data.
     else{
         char *str_buf = malloc(512);
         strncpy(str_buf, system_config.mqtt.pub_data, 512);
-        data_len = get_data_orders(str_buf, ", ", orders, 64);
+        data_len = data_bind(str_buf, ", ", fields, DATA_ORDER_MAX);
         free(str_buf);
     }
+    telemetry_subscribe(fields, data_len);
 
     // wait for SAL and AT device.
     rt_thread_mdelay(5000);
@@ -527,6 +564,7 @@ void thread_mqtt(void* p)
     rt_thread_mdelay(2000);
 
     msg_count_tick = rt_tick_get();
+    ane_burst_reader_init(&ane_burst_ring, &burst_reader);
 
     int period = cfg->period;
     while(1)
@@ -551,23 +589,29 @@ void thread_mqtt(void* p)
             is_full_update = false;
 
         // now send data if they are updated.
-        for(int i=0; i< data_len; i++)
+        const telemetry_t *t = telemetry_take();
+        for(int i=0; t && i< data_len; i++)
         {
             // a simple check for whether the data is updated
             if(!is_full_update){
-                //printf("%d, %d, %f\n",i, orders[i], get_data[orders[i]]());
-                if(last_data[orders[i]] != get_data[orders[i]]())
-                    last_data[orders[i]] = get_data[orders[i]]();
+                float value = telemetry_get(t, fields[i]);
+                if(last_data[i] != value)
+                    last_data[i] = value;
                 else
                    continue;
             }
 
             if(is_connected)
             {
-                snprintf(topic, sizeof(topic), "%s%s", cfg->topic_prefix, data_name[orders[i]]);
-                print_data[orders[i]](line);
+                snprintf(topic, sizeof(topic), "%s%s", cfg->topic_prefix, fields[i]->name);
+                int len = telemetry_print(t, fields[i], line);
+                if(cfg->is_timestamp)
+                {
+                    line[len++] = ',';
+                    timebase_format(&line[len], telemetry_time(t, fields[i]));
+                }
                 rslt = mqtt_publish_data(topic, line, 0);
-                //printf("%d, %d, %s\n", i, orders[i], line);
+                //printf("%d, %s, %s\n", i, fields[i]->name, line);
                 if(rslt != 0)
                 {
                     // reconnected needed.
@@ -582,6 +626,21 @@ void thread_mqtt(void* p)
             }
             rt_thread_delay(1); // this is needed for more stable AT device
         }
+        telemetry_release(t);
+
+        // burst samples, drained a message per loop.
+        if(is_connected)
+        {
+            rslt = mqtt_publish_burst(cfg, &burst_reader);
+            if(rslt < 0)
+            {
+                is_connected = 0;
+                LOG_E("publish fail, wait for reconnect");
+                rt_thread_mdelay(2000);
+            }
+            else if(rslt > 0)
+                msg_count++;
+        }
     }
 }
 
@@ -23,6 +23,7 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include "configuration.h"
+#include "timebase.h"
 
 #define DBG_TAG "ntp"
 //#define DBG_LVL DBG_INFO
@@ -125,6 +126,7 @@ int ntp_sync(int argc, char* argv[])
     }
 
     // Send it the NTP packet it wants. If n == -1, it failed.
+    uint64_t send_us = timebase_us();
     n = write(sockfd, (char* ) &packet, sizeof(ntp_packet) );
     if ( n < 0 ){
       LOG_E( "ERROR writing to socket" );
@@ -146,6 +148,7 @@ int ntp_sync(int argc, char* argv[])
 
     // Wait and receive the packet back from the server. If n == -1, it failed.
     n = read(sockfd, (char* ) &packet, sizeof(ntp_packet) );
+    uint64_t recv_us = timebase_us();
 
     if ( n < 0 ){
       LOG_E( "ERROR reading from socket" );
@@ -166,6 +169,10 @@ int ntp_sync(int argc, char* argv[])
     // (1900)------------------(1970)**************************************(Time Packet Left the Server)
     time_t txTm = ( time_t ) ( packet.txTm_s - NTP_TIMESTAMP_DELTA );
 
+    // the server sent it about half the round trip ago.
+    timebase_sync((int64_t)txTm * 1000000 + (((uint64_t)packet.txTm_f * 1000000) >> 32) + (recv_us - send_us) / 2,
+            recv_us, TIMEBASE_SRC_NTP);
+
     // update RTC
     struct tm *tnow = localtime(&txTm);
     set_date(tnow->tm_year + 1900, tnow->tm_mon + 1, tnow->tm_mday);
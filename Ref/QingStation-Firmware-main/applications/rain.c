@@ -14,6 +14,7 @@
 #include <board.h>
 #include "configuration.h"
 #include "data_pool.h"
+#include "timebase.h"
 #include <stdlib.h>
 #include "string.h"
 #include "math.h"
@@ -592,17 +593,19 @@ void thread_rain(void* parameters)
         //HAL_ADC_Start_DMA(&hadc1, adc_raw, 4); // sample all adc
         rt_thread_mdelay(1);
         rain_raw = adc_raw[1];
+        uint64_t us = timebase_us();
         rt_pin_write(IR_LED_PIN, GPIO_PIN_RESET);
         analog_power_request(false);
         // calculate variance
 
         diff = rain_raw - last_raw;
         last_raw = rain_raw;
-        rain.raw = rain_raw;
         add_to_buffer(&rain_data, diff); // variance of the change rate.
         if(rain_data.is_full && rt_tick_get() - last_t >= cfg->data_period)
         {
             last_t = rt_tick_get();
+            data_begin_write(&rain.info);
+            rain.raw = rain_raw;
             rain.var = compute_variance(&rain_data);
 
             int level = 0;
@@ -616,7 +619,7 @@ void thread_rain(void* parameters)
                 level = 4;
             rain.level = level;
 
-            data_updated(&rain.info);
+            data_updated_at(&rain.info, us);
         }
         if(is_rain_print)
             printf("measurement:%d, diff: %d, rain_var: %f\n", rain_raw, diff, rain.var);
@@ -629,10 +632,11 @@ void thread_rain(void* parameters)
         //sys_vol_raw = measure_sys_voltage();
         sys_vol_raw = adc_raw[0];
         volt = sys_vol_raw / 4095.f * vdda * 2;
+        data_begin_write(&sys.info);
         sys.bat_voltage = volt * 0.1f + sys.bat_voltage * 0.9f; // simple RC filter.
         sys.sys_voltage = vdda;
         sys.mcu_temp = temp_degress;
-        data_updated(&sys.info);
+        data_updated_at(&sys.info, us);
     }
 }
 
@@ -24,7 +24,17 @@
 
 #include "data_pool.h"
 #include "recorder.h"
+#include "data_format.h"
+#include "telemetry.h"
+#include "timebase.h"
 #include "time.h"
+#include "anemometer_burst.h"
+#include "record_bin.h"
+
+#define RECORD_BUF_SIZE     (2048)  // ring of the recorders, the data of a record period
+#define RECORD_BIN_BUF_SIZE (RECORD_BIN_BLOCK_SIZE * 2)
+#define BURST_BUF_SIZE      (4096)
+#define STREAM_BUF_SIZE     (8192)
 
 recorder_t * new_file(char* line)
 {
@@ -34,8 +44,16 @@ recorder_t * new_file(char* line)
     // timestamp
     time(&timep);
     strftime(line, 64, "%Y%m%d_%H%M%S", gmtime(&timep));
-    snprintf(filepath, 128, "%s/%s_%s", system_config.record.data_path, line,"log.csv");
-    recorder = recorder_create(filepath, "rec", 2000);
+    if(system_config.record.is_binary)
+    {
+        snprintf(filepath, 128, "%s/%s_%s", system_config.record.data_path, line,"log.qrec");
+        recorder = recorder_create(filepath, "rec", 2000, RECORD_BIN_BUF_SIZE);
+    }
+    else
+    {
+        snprintf(filepath, 128, "%s/%s_%s", system_config.record.data_path, line,"log.csv");
+        recorder = recorder_create(filepath, "rec", 2000, RECORD_BUF_SIZE);
+    }
     if(recorder == NULL)
     {
         // temporary check.
@@ -46,13 +64,258 @@ recorder_t * new_file(char* line)
     return recorder;
 }
 
+#define MSG_SIZE 512
+
+// the binary record, a block of rows is written when full or as old as the reopen interval of the recorder,
+// a partial block is on the card as soon as the csv lines would be. the columns are the recorded data.
+static record_bin_t bin;
+static record_bin_field_t bin_fields[DATA_ORDER_MAX];
+static rt_tick_t bin_block_tick;    // the first row of the block
+
+static void binary_columns(const data_desc_t **fields, uint32_t num)
+{
+    for(uint32_t i=0; i<num; i++)
+    {
+        switch(fields[i]->type)
+        {
+        case DATA_INT: bin_fields[i].type = RECORD_BIN_INT; break;
+        case DATA_UINT: bin_fields[i].type = RECORD_BIN_UINT; break;
+        case DATA_BOOL: bin_fields[i].type = RECORD_BIN_BOOL; break;
+        default: bin_fields[i].type = RECORD_BIN_FLOAT; break;
+        }
+        bin_fields[i].precision = fields[i]->precision;
+        strncpy(bin_fields[i].name, fields[i]->name, RECORD_BIN_NAME_LEN - 1);
+    }
+}
+
+static void binary_flush(recorder_t *recorder)
+{
+    const uint8_t *data;
+    uint32_t size = record_bin_block(&bin, &data);
+    if(size)
+        recorder_write_bin(recorder, data, size);
+}
+
+static void record_header(recorder_t *recorder, const data_desc_t **fields, uint32_t num)
+{
+    if(system_config.record.is_binary)
+    {
+        const uint8_t *data;
+        uint32_t size;
+        record_bin_init(&bin, bin_fields, num, system_config.record.period);
+        size = record_bin_header(&bin, &data);
+        recorder_write_bin(recorder, data, size);
+        return;
+    }
+    recorder_write(recorder, "timestamp");
+    for(int i=0; i<num; i++)
+    {
+        recorder_write(recorder, ",");
+        recorder_write(recorder, fields[i]->name);
+    }
+    recorder_write(recorder, "\n");
+}
+
+// the words of the recorded data of a frame as a row of the binary record.
+static void binary_row(recorder_t *recorder, const telemetry_t *t, const data_desc_t **fields, uint32_t num)
+{
+    static uint32_t value[DATA_ORDER_MAX];
+    for(uint32_t i=0; i<num; i++)
+        value[i] = t->value[fields[i] - data_desc];
+    if(!record_bin_add(&bin, t->utc_us, value))
+    {
+        binary_flush(recorder);
+        record_bin_add(&bin, t->utc_us, value);
+    }
+    if(bin.rows == 1)
+        bin_block_tick = rt_tick_get();
+    if(recorder->reopen_after && rt_tick_get() - bin_block_tick >= recorder->reopen_after)
+        binary_flush(recorder);
+}
+
+// drain the burst samples of the anemometer to a file of their own, the file is created with the first samples.
+// the ring holds ANE_BURST_BUF_LEN-1 samples, so the record period should be shorter than that at the burst rate.
+static recorder_t* record_burst(recorder_t *recorder, ane_burst_reader_t *rd, char *line)
+{
+    ane_burst_sample_t s[16];
+    char *buf = NULL;
+    int num, index = 0;
+    while((num = ane_burst_ring_read(&ane_burst_ring, rd, s, 16)) > 0)
+    {
+        if(!recorder)
+        {
+            time_t timep;
+            char filepath[128];
+            time(&timep);
+            strftime(line, 64, "%Y%m%d_%H%M%S", gmtime(&timep));
+            snprintf(filepath, 128, "%s/%s_%s", system_config.record.data_path, line, "burst.csv");
+            recorder = recorder_create(filepath, "bur", 2000, BURST_BUF_SIZE);
+            if(!recorder)
+            {
+                LOG_E("Cannot create burst recording file");
+                return NULL;
+            }
+            recorder_write(recorder, ANE_BURST_HEADER"\n");
+        }
+        // formatted in place in the recorder.
+        for(int i=0; i<num; i++)
+        {
+            if(!buf)
+            {
+                buf = recorder_reserve(recorder, MSG_SIZE);
+                index = 0;
+                if(!buf)
+                    continue;
+            }
+            index += ane_burst_format(&s[i], &buf[index], MSG_SIZE - index - 1);
+            buf[index++] = '\n';
+            // a line is 36 chars at most.
+            if(index > MSG_SIZE - 40)
+            {
+                recorder_commit(recorder, index);
+                buf = NULL;
+            }
+        }
+    }
+    if(buf)
+        recorder_commit(recorder, index);
+    if(rd->lost)
+    {
+        LOG_W("%d burst samples lost", rd->lost);
+        rd->lost = 0;
+    }
+
+    if(recorder && system_config.record.is_split_file &&
+            recorder->file_size >= system_config.record.max_file_size)
+    {
+        recorder_delete_wait(recorder);
+        recorder = NULL;
+    }
+    return recorder;
+}
+
+#define STREAM_BATCH_SIZE   (1024)  // bytes of samples drained at once
+
+typedef struct _record_stream_t
+{
+    data_stream_t *stream;
+    data_stream_reader_t reader;
+    const sensor_info_t *info;
+    const char *name;       // the first recorded data of the sensor
+} record_stream_t;
+
+// streams of the sensors of the recorded data, each once.
+static int record_stream_open(const data_desc_t **fields, uint32_t num, record_stream_t *rs)
+{
+    int n = 0;
+    for(uint32_t i=0; i<num; i++)
+    {
+        const data_desc_t *d = fields[i];
+        int k = 0;
+        if(!d->info)
+            continue;
+        while(k < n && rs[k].info != d->info)
+            k++;
+        if(k < n)
+            continue;
+        rs[n].stream = data_stream_open(d->info, d->size, DATA_STREAM_LEN);
+        if(!rs[n].stream)
+        {
+            LOG_E("Cannot create the stream of %s", d->name);
+            continue;
+        }
+        rs[n].info = d->info;
+        rs[n].name = d->name;
+        data_stream_reader_init(rs[n].stream, &rs[n].reader);
+        n++;
+    }
+    return n;
+}
+
+// drain every update of the recorded sensors to a file of their own, a line is "time,name,value",
+// the time is the UTC of the acquisition in seconds with us.
+// the file is created with the first samples. a stream holds DATA_STREAM_LEN-1 updates between the records.
+static recorder_t* record_stream(recorder_t *recorder, record_stream_t *rs, int rs_num,
+        const data_desc_t **fields, uint32_t num, char *line)
+{
+    static uint64_t samples[STREAM_BATCH_SIZE / sizeof(uint64_t)];
+    for(int k=0; k<rs_num; k++)
+    {
+        data_stream_t *s = rs[k].stream;
+        int got;
+        while((got = data_stream_read(s, &rs[k].reader, samples, sizeof(samples) / s->slot)) > 0)
+        {
+            if(!recorder)
+            {
+                time_t timep;
+                char filepath[128];
+                time(&timep);
+                strftime(line, 64, "%Y%m%d_%H%M%S", gmtime(&timep));
+                snprintf(filepath, 128, "%s/%s_%s", system_config.record.data_path, line, "stream.csv");
+                recorder = recorder_create(filepath, "str", 2000, STREAM_BUF_SIZE);
+                if(!recorder)
+                {
+                    LOG_E("Cannot create stream recording file");
+                    return NULL;
+                }
+                recorder_write(recorder, "time,name,value\n");
+            }
+            // formatted in place in the recorder.
+            char *buf = NULL;
+            int index = 0;
+            for(int j=0; j<got; j++)
+            {
+                char stamp[TIMEBASE_FORMAT_LEN];
+                timebase_format(stamp, timebase_utc_us(data_stream_us(s, samples, j)));
+                for(uint32_t i=0; i<num; i++)
+                {
+                    if(fields[i]->info != rs[k].info)
+                        continue;
+                    if(!buf)
+                    {
+                        buf = recorder_reserve(recorder, MSG_SIZE);
+                        index = 0;
+                        if(!buf)
+                            break;
+                    }
+                    index += format_str(&buf[index], stamp);
+                    index += format_str(&buf[index], ",");
+                    index += format_str(&buf[index], fields[i]->name);
+                    index += format_str(&buf[index], ",");
+                    index += data_print_from(data_stream_sample(s, samples, j), fields[i], &buf[index]);
+                    index += format_str(&buf[index], "\n");
+                    // a line is 90 chars at most.
+                    if(index > MSG_SIZE - 90)
+                    {
+                        recorder_commit(recorder, index);
+                        buf = NULL;
+                    }
+                }
+            }
+            if(buf)
+                recorder_commit(recorder, index);
+        }
+        if(rs[k].reader.lost)
+        {
+            LOG_W("%d updates of the sensor of %s lost", rs[k].reader.lost, rs[k].name);
+            rs[k].reader.lost = 0;
+        }
+    }
+    if(recorder && system_config.record.is_split_file &&
+            recorder->file_size >= system_config.record.max_file_size)
+    {
+        recorder_delete_wait(recorder);
+        recorder = NULL;
+    }
+    return recorder;
+}
+
 void thread_record(void* parameters)
 {
-    #define MSG_SIZE 512
-    uint16_t orders[64];
+    const data_desc_t *fields[DATA_ORDER_MAX];
     uint32_t data_len = 0;
     char line[MSG_SIZE] = {0};
-    time_t timep;
+    bool is_cut = false;    // the last line was cut by a full recorder
     // wait until system cfg loaded
     while(!is_system_cfg_valid() && system_config.record.is_enable)
         rt_thread_mdelay(1000);
@@ -67,67 +330,111 @@ void thread_record(void* parameters)
 
     // create one
     recorder_t* recorder = new_file(line);
+    recorder_t* burst_recorder = NULL;
+    recorder_t* stream_recorder = NULL;
+    static record_stream_t streams[DATA_INSTANCE_NUM];
+    int stream_num = 0;
+    ane_burst_reader_t burst_reader;
+    ane_burst_reader_init(&ane_burst_ring, &burst_reader);
 
     // find out the data to be export (publish)
     // if the field is empty, then we print all data.
     if(strlen(system_config.record.header) == 0)
     {
-        data_len = EXPORT_DATA_SIZE-1; // data 0 is "unknown"
+        data_len = EXPORT_DIAG_START-1; // data 0 is "unknown", diagnostics are only recorded when named.
         for(int i=0; i<data_len; i++)
-            orders[i] = i+1;
+            fields[i] = &data_desc[i+1];
     }
     // not empty, use it.
     else{
         // copy for us to destroy :p
         // get what data do we want.
         strncpy(line, system_config.record.header, MSG_SIZE);
-        data_len = get_data_orders(line, ", ", orders, 64);
+        data_len = data_bind(line, ", ", fields, DATA_ORDER_MAX);
     }
+    telemetry_subscribe(fields, data_len);
+    if(system_config.record.is_stream)
+        stream_num = record_stream_open(fields, data_len, streams);
+    if(system_config.record.is_binary)
+        binary_columns(fields, data_len);
+
     // write header
-    recorder_write(recorder, "timestamp");
-    for(int i=0; i<data_len; i++)
-    {
-        sprintf(line, ",%s",data_name[orders[i]]);
-        recorder_write(recorder, line);
-    }
-    recorder_write(recorder, "\n");
+    record_header(recorder, fields, data_len);
 
     while(1)
     {
         rt_thread_mdelay(system_config.record.period - rt_tick_get() % system_config.record.period);
         int index = 0;
+        const telemetry_t *t = telemetry_take();
+        if(!t)
+        {
+            LOG_W("No telemetry frame");
+            continue;
+        }
 
-        // timestamp
-        time(&timep);
-        index += strftime(&line[index], 64, "%Y%m%d%H%M%S",  gmtime(&timep));
-
-        // print each data to the str
-        for(uint32_t i=0; i<data_len; i++)
+        // a row of the binary record, or the line formatted in place in the recorder.
+        // the line is dropped if the recorder is full.
+        char *buf = NULL;
+        if(system_config.record.is_binary)
+            binary_row(recorder, t, fields, data_len);
+        else
+            buf = recorder_reserve(recorder, MSG_SIZE);
+        if(buf)
         {
-            index+= sprintf(&line[index],",");
-            index+= print_data[orders[i]](&line[index]);
+            // end the line cut by a full recorder.
+            if(is_cut)
+                index += format_str(&buf[index], "\n");
+            is_cut = false;
+
+            // timestamp
+            index += telemetry_stamp(t, &buf[index], "");
+
+            // the text of each data, formatted once for all the outputs.
+            for(uint32_t i=0; i<data_len; i++)
+            {
+                // a value is FORMAT_FLOAT_LEN at most, the line goes on in a new reservation.
+                if(index > MSG_SIZE - FORMAT_FLOAT_LEN - 2)
+                {
+                    recorder_commit(recorder, index);
+                    index = 0;
+                    buf = recorder_reserve(recorder, MSG_SIZE);
+                    if(!buf)
+                    {
+                        is_cut = true;
+                        break;
+                    }
+                }
+                index+= format_str(&buf[index],",");
+                index+= telemetry_print(t, fields[i], &buf[index]);
+            }
+
+            // next line.
+            if(buf)
+            {
+                index+= format_str(&buf[index],"\n");
+                recorder_commit(recorder, index);
+            }
         }
+        telemetry_release(t);
 
-        // next line.
-        index+= sprintf(&line[index],"\n");
+        // high rate samples when the anemometer is in burst.
+        burst_recorder = record_burst(burst_recorder, &burst_reader, line);
 
-        // now write to recorder
-        recorder_write(recorder, line);
+        // every update of the recorded sensors since the last record.
+        if(stream_num)
+            stream_recorder = record_stream(stream_recorder, streams, stream_num, fields, data_len, line);
 
         // new file when needed.
         if(system_config.record.is_split_file &&
                 recorder->file_size >= system_config.record.max_file_size)
         {
+            if(system_config.record.is_binary)
+                binary_flush(recorder);
             recorder_delete_wait(recorder);
             recorder = new_file(line);
+            is_cut = false;
             // write header
-            recorder_write(recorder, "timestamp");
-            for(int i=0; i<data_len; i++)
-            {
-                sprintf(line, ",%s",data_name[orders[i]]);
-                recorder_write(recorder, line);
-            }
-            recorder_write(recorder, "\n");
+            record_header(recorder, fields, data_len);
         }
 
         // add some delay in case the speed too fast, that case multiple runs in 1ms
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include "stddef.h"
+#include "string.h"
+
+#include "data_format.h"
+#include "record_bin.h"
+
+#define PAYLOAD_BITS    ((RECORD_BIN_BLOCK_SIZE - sizeof(record_bin_block_t) - 4) * 8)
+
+static uint32_t record_bin_crc32(uint32_t crc, const void *data, uint32_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *p++;
+        for(int i=0; i<8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+// msb first.
+static void put_bits(uint8_t *p, uint32_t *pos, uint64_t v, uint32_t n)
+{
+    while(n)
+    {
+        uint32_t room = 8 - (*pos & 7);
+        uint32_t take = n < room ? n : room;
+        uint8_t *byte = &p[*pos >> 3];
+        if((*pos & 7) == 0)
+            *byte = 0;
+        *byte |= ((v >> (n - take)) & ((1u << take) - 1)) << (room - take);
+        *pos += take;
+        n -= take;
+    }
+}
+
+// beyond the limit, it reads 0 and the position is after the limit.
+static uint64_t get_bits(const uint8_t *p, uint32_t *pos, uint32_t n, uint32_t limit)
+{
+    uint64_t v = 0;
+    if(*pos + n > limit)
+    {
+        *pos = limit + 1;
+        return 0;
+    }
+    while(n)
+    {
+        uint32_t room = 8 - (*pos & 7);
+        uint32_t take = n < room ? n : room;
+        v = (v << take) | ((p[*pos >> 3] >> (room - take)) & ((1u << take) - 1));
+        *pos += take;
+        n -= take;
+    }
+    return v;
+}
+
+static uint32_t bit_length(uint64_t v)
+{
+    uint32_t n = 0;
+    while(v)
+    {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+static uint64_t zigzag(int64_t d)
+{
+    return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+}
+
+// bits of a difference, and if it is in the width of the last one.
+static uint32_t delta_bits(int64_t d, uint8_t width, bool *is_reuse)
+{
+    uint32_t n = bit_length(zigzag(d));
+    *is_reuse = false;
+    if(!d)
+        return 1;
+    if(n <= width && 2 + width <= 9 + n)
+    {
+        *is_reuse = true;
+        return 2 + width;
+    }
+    return 9 + n;
+}
+
+static void put_delta(uint8_t *p, uint32_t *pos, int64_t d, uint8_t *width)
+{
+    bool is_reuse;
+    uint64_t zz = zigzag(d);
+    delta_bits(d, *width, &is_reuse);
+    if(!d)
+        put_bits(p, pos, 0, 1);
+    else if(is_reuse)
+    {
+        put_bits(p, pos, 2, 2);
+        put_bits(p, pos, zz, *width);
+    }
+    else
+    {
+        *width = bit_length(zz);
+        put_bits(p, pos, 6, 3);
+        put_bits(p, pos, *width - 1, 6);
+        put_bits(p, pos, zz, *width);
+    }
+}
+
+// after the leading '1', false if it is a float as it is.
+static bool get_delta(const uint8_t *p, uint32_t *pos, uint32_t limit, uint8_t *width, int64_t *d)
+{
+    uint64_t zz;
+    if(get_bits(p, pos, 1, limit))
+    {
+        if(get_bits(p, pos, 1, limit))
+            return false;
+        *width = get_bits(p, pos, 6, limit) + 1;
+    }
+    zz = get_bits(p, pos, *width, limit);
+    *d = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+    return true;
+}
+
+// the integer of a column, false if a float does not have one.
+static bool column_value(const record_bin_field_t *f, uint32_t w, int64_t *v)
+{
+    switch(f->type)
+    {
+    case RECORD_BIN_FLOAT:
+    {
+        union {uint32_t u; float f;} x = {.u = w};
+        // no decimals, the integer part as data_print() prints it.
+        if(f->precision == 0)
+        {
+            if(!(x.f > -2147483648.f && x.f < 2147483648.f))
+                return false;
+            *v = (int32_t)x.f;
+            return true;
+        }
+        return format_float_fixed(x.f, f->precision, v);
+    }
+    case RECORD_BIN_INT: *v = (int32_t)w; return true;
+    case RECORD_BIN_UINT: *v = w; return true;
+    default: *v = w != 0; return true;
+    }
+}
+
+static void block_reset(record_bin_t *b)
+{
+    b->rows = 0;
+    b->bits = 0;
+    b->last_interval = (int64_t)b->period * 1000;
+    b->width_us = 0;
+    memset(b->last, 0, sizeof(b->last));
+    memset(b->width, 0, sizeof(b->width));
+}
+
+void record_bin_init(record_bin_t *b, const record_bin_field_t *fields, uint32_t num, uint32_t period)
+{
+    b->fields = fields;
+    b->num = num < RECORD_BIN_FIELD_MAX ? num : RECORD_BIN_FIELD_MAX;
+    b->period = period;
+    block_reset(b);
+}
+
+uint32_t record_bin_header(record_bin_t *b, const uint8_t **data)
+{
+    record_bin_header_t h;
+    uint32_t size = sizeof(h) + b->num * sizeof(record_bin_field_t);
+    h.magic = RECORD_BIN_MAGIC;
+    h.version = RECORD_BIN_VERSION;
+    h.fields = b->num;
+    h.period = b->period;
+    h.size = size + 4;
+    memcpy(b->buf, &h, sizeof(h));
+    memcpy(&b->buf[sizeof(h)], b->fields, b->num * sizeof(record_bin_field_t));
+    uint32_t crc = record_bin_crc32(0, b->buf, size);
+    memcpy(&b->buf[size], &crc, 4);
+    *data = b->buf;
+    return size + 4;
+}
+
+bool record_bin_add(record_bin_t *b, int64_t utc_us, const uint32_t *value)
+{
+    uint8_t *p = &b->buf[sizeof(record_bin_block_t)];
+    int64_t interval = utc_us - b->last_us;
+    uint32_t bits = 0;
+    bool is_reuse;
+    int64_t v;
+    if(b->rows >= RECORD_BIN_BLOCK_ROWS)
+        return false;
+
+    // the size first, a row is not split to blocks.
+    if(b->rows)
+        bits += delta_bits(interval - b->last_interval, b->width_us, &is_reuse);
+    for(uint32_t i=0; i<b->num; i++)
+        bits += column_value(&b->fields[i], value[i], &v) ? delta_bits(v - b->last[i], b->width[i], &is_reuse) : 35;
+    if(b->bits + bits > PAYLOAD_BITS)
+        return false;
+
+    if(b->rows)
+    {
+        put_delta(p, &b->bits, interval - b->last_interval, &b->width_us);
+        b->last_interval = interval;
+    }
+    else
+    {
+        record_bin_block_t *head = (record_bin_block_t *)b->buf;
+        head->utc_us = utc_us;
+    }
+    b->last_us = utc_us;
+    for(uint32_t i=0; i<b->num; i++)
+    {
+        if(column_value(&b->fields[i], value[i], &v))
+        {
+            put_delta(p, &b->bits, v - b->last[i], &b->width[i]);
+            b->last[i] = v;
+        }
+        else
+        {
+            put_bits(p, &b->bits, 7, 3);
+            put_bits(p, &b->bits, value[i], 32);
+        }
+    }
+    b->rows++;
+    return true;
+}
+
+uint32_t record_bin_block(record_bin_t *b, const uint8_t **data)
+{
+    record_bin_block_t *head = (record_bin_block_t *)b->buf;
+    uint32_t size = sizeof(record_bin_block_t) + (b->bits + 7) / 8;
+    if(!b->rows)
+        return 0;
+    head->sync = RECORD_BIN_SYNC;
+    head->payload = (b->bits + 7) / 8;
+    head->rows = b->rows;
+    uint32_t crc = record_bin_crc32(0, b->buf, size);
+    memcpy(&b->buf[size], &crc, 4);
+    *data = b->buf;
+    block_reset(b);
+    return size + 4;
+}
+
+int record_bin_open(record_bin_reader_t *r, const uint8_t *buf, uint32_t len)
+{
+    record_bin_header_t h;
+    uint32_t crc;
+    if(len < sizeof(h))
+        return -1;
+    memcpy(&h, buf, sizeof(h));
+    if(h.magic != RECORD_BIN_MAGIC || h.version != RECORD_BIN_VERSION || h.fields > RECORD_BIN_FIELD_MAX ||
+       h.size != sizeof(h) + h.fields * sizeof(record_bin_field_t) + 4 || len < h.size)
+        return -1;
+    memcpy(&crc, &buf[h.size - 4], 4);
+    if(crc != record_bin_crc32(0, buf, h.size - 4))
+        return -2;
+    memset(r, 0, sizeof(record_bin_reader_t));
+    r->num = h.fields;
+    r->period = h.period;
+    memcpy(r->fields, &buf[sizeof(h)], h.fields * sizeof(record_bin_field_t));
+    for(uint32_t i=0; i<r->num; i++)
+        r->fields[i].name[RECORD_BIN_NAME_LEN - 1] = 0;
+    return h.size;
+}
+
+int record_bin_read_block(record_bin_reader_t *r, const uint8_t *buf, uint32_t len)
+{
+    record_bin_block_t head;
+    uint32_t crc;
+    if(len < sizeof(head) + 4)
+        return -1;
+    memcpy(&head, buf, sizeof(head));
+    if(head.sync != RECORD_BIN_SYNC || sizeof(head) + head.payload > RECORD_BIN_BLOCK_SIZE - 4 ||
+       len < sizeof(head) + head.payload + 4)
+        return -1;
+    memcpy(&crc, &buf[sizeof(head) + head.payload], 4);
+    if(crc != record_bin_crc32(0, buf, sizeof(head) + head.payload))
+        return -2;
+    r->payload = &buf[sizeof(head)];
+    r->payload_bits = head.payload * 8;
+    r->rows = head.rows;
+    r->row = 0;
+    r->bits = 0;
+    r->utc_us = head.utc_us;
+    r->last_interval = (int64_t)r->period * 1000;
+    r->width_us = 0;
+    memset(r->value, 0, sizeof(r->value));
+    memset(r->width, 0, sizeof(r->width));
+    return sizeof(head) + head.payload + 4;
+}
+
+bool record_bin_read_row(record_bin_reader_t *r)
+{
+    const uint8_t *p = r->payload;
+    uint32_t limit = r->payload_bits;
+    if(r->row >= r->rows || r->bits > limit)
+        return false;
+    int64_t d;
+    if(r->row)
+    {
+        if(get_bits(p, &r->bits, 1, limit) && get_delta(p, &r->bits, limit, &r->width_us, &d))
+            r->last_interval += d;
+        r->utc_us += r->last_interval;
+    }
+    for(uint32_t i=0; i<r->num; i++)
+    {
+        r->is_raw[i] = false;
+        if(!get_bits(p, &r->bits, 1, limit))
+            continue;
+        if(get_delta(p, &r->bits, limit, &r->width[i], &d))
+            r->value[i] += d;
+        else
+        {
+            r->raw[i] = get_bits(p, &r->bits, 32, limit);
+            r->is_raw[i] = true;
+        }
+    }
+    r->row++;
+    return r->bits <= r->payload_bits;
+}
+
+int record_bin_print(const record_bin_reader_t *r, uint32_t i, char *buf)
+{
+    const record_bin_field_t *f = &r->fields[i];
+    switch(f->type)
+    {
+    case RECORD_BIN_FLOAT:
+        if(r->is_raw[i])
+        {
+            union {uint32_t u; float f;} x = {.u = r->raw[i]};
+            if(f->precision == 0)
+                return format_trunc(buf, x.f);
+            return format_float(buf, x.f, f->precision);
+        }
+        return format_fixed(buf, r->value[i], f->precision);
+    case RECORD_BIN_INT: return format_int(buf, (int32_t)r->value[i]);
+    case RECORD_BIN_UINT: return format_uint(buf, (uint32_t)r->value[i]);
+    case RECORD_BIN_BOOL: return format_str(buf, r->value[i] ? "true" : "false");
+    default: return format_str(buf, "unknown");
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __RECORD_BIN_H__
+#define __RECORD_BIN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary records, the same rows as the csv of thread_record() in a fraction of the size.
+// A file is a header with the columns, then blocks of rows. Each block starts with a sync word and
+// ends with a crc32, and starts the coding over, so a block can be read without the others.
+// A damaged or cut block is skipped by searching the next sync word.
+// The values are coded per column in a bit stream, row after row, like the Gorilla of Facebook:
+//   '0'                         the same as the last row
+//   '10' + width bits           the zigzag difference to the last row, in the width of the last difference
+//   '110' + 6bit n-1 + n bits   the difference in a new width
+//   '111' + 32bit               the float as it is, when it has no integer in its decimals
+// A float is the integer of its decimals as format_float() prints it, so the text is the same as the csv.
+// A float of no decimals is its integer part, as format_trunc().
+// The time of a row is the difference of its interval to the last one, in us, with the same code.
+// host/qingdump converts the files back to csv.
+#define RECORD_BIN_MAGIC        (0x43455251)    // "QREC"
+#define RECORD_BIN_SYNC         (0x4B4C4251)    // "QBLK"
+#define RECORD_BIN_VERSION      (1)
+
+#define RECORD_BIN_FIELD_MAX    (96)    // columns, DATA_ORDER_MAX
+#define RECORD_BIN_NAME_LEN     (14)
+#define RECORD_BIN_BLOCK_SIZE   (2048)  // a block at most, with its head and crc
+#define RECORD_BIN_BLOCK_ROWS   (30)    // rows in a block at most, a sync word every so many rows
+
+typedef enum {
+    RECORD_BIN_FLOAT = 0,
+    RECORD_BIN_INT,         // int32
+    RECORD_BIN_UINT,        // uint32
+    RECORD_BIN_BOOL,
+} record_bin_type_t;
+
+typedef struct _record_bin_header_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t fields;        // columns after the header
+    uint32_t period;        // ms between rows
+    uint32_t size;          // bytes of the header, the columns and the crc32 of them
+} record_bin_header_t;
+
+typedef struct _record_bin_field_t
+{
+    uint8_t type;           // record_bin_type_t
+    uint8_t precision;      // decimals of a float
+    char name[RECORD_BIN_NAME_LEN];
+} record_bin_field_t;
+
+typedef struct _record_bin_block_t
+{
+    uint32_t sync;
+    uint16_t payload;       // bytes of the rows after the head
+    uint16_t rows;
+    int64_t utc_us;         // UTC in us of the first row
+} record_bin_block_t;       // then the payload and the crc32 of both
+
+// size of the file header at most
+#define RECORD_BIN_HEADER_MAX   (sizeof(record_bin_header_t) + RECORD_BIN_FIELD_MAX * sizeof(record_bin_field_t) + 4)
+
+typedef struct _record_bin_t
+{
+    const record_bin_field_t *fields;
+    uint32_t num;
+    uint32_t period;
+    int64_t last[RECORD_BIN_FIELD_MAX]; // value of the last row
+    uint8_t width[RECORD_BIN_FIELD_MAX]; // bits of the last difference
+    int64_t last_us;
+    int64_t last_interval;
+    uint8_t width_us;
+    uint32_t rows;
+    uint32_t bits;                      // of the payload
+    uint8_t buf[RECORD_BIN_BLOCK_SIZE];
+} record_bin_t;
+
+typedef struct _record_bin_reader_t
+{
+    record_bin_field_t fields[RECORD_BIN_FIELD_MAX];
+    uint32_t num;
+    uint32_t period;
+    int64_t value[RECORD_BIN_FIELD_MAX];    // of the row read, the integer of the decimals of a float
+    uint32_t raw[RECORD_BIN_FIELD_MAX];     // the float as it is when is_raw
+    bool is_raw[RECORD_BIN_FIELD_MAX];
+    uint8_t width[RECORD_BIN_FIELD_MAX];
+    int64_t utc_us;                         // of the row read
+    int64_t last_interval;
+    uint8_t width_us;
+    const uint8_t *payload;
+    uint32_t payload_bits;
+    uint32_t rows;                          // of the block
+    uint32_t row;                           // rows read
+    uint32_t bits;                          // read of the payload
+} record_bin_reader_t;
+
+// the writer, num <= RECORD_BIN_FIELD_MAX. fields are kept by reference.
+void record_bin_init(record_bin_t *b, const record_bin_field_t *fields, uint32_t num, uint32_t period);
+// the header of a file, before any row. return its size.
+uint32_t record_bin_header(record_bin_t *b, const uint8_t **data);
+// add a row, a word for each column as the float/int32/uint32/bool of it.
+// return false if the block is full, take the block and add the row again.
+bool record_bin_add(record_bin_t *b, int64_t utc_us, const uint32_t *value);
+// the block of the rows added, a new block is started. return its size, 0 if no row.
+uint32_t record_bin_block(record_bin_t *b, const uint8_t **data);
+
+// the columns from the header of a file. return its size, -1 if not a header, -2 if crc error.
+int record_bin_open(record_bin_reader_t *r, const uint8_t *buf, uint32_t len);
+// start to read the block at buf. return its size, -1 if not a block, -2 if crc error.
+int record_bin_read_block(record_bin_reader_t *r, const uint8_t *buf, uint32_t len);
+// the next row of the block to r. return false at the end of the block.
+bool record_bin_read_row(record_bin_reader_t *r);
+// print a column of the row read, the same text as data_print(). return the length.
+int record_bin_print(const record_bin_reader_t *r, uint32_t i, char *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RECORD_BIN_H__ */
@@ -10,6 +10,7 @@
  */
 
 #include <rtthread.h>
+#include <rthw.h>
 #include <board.h>
 #include <rtdevice.h>
 #include "string.h"
@@ -27,49 +28,82 @@
 void led_indicate_busy();
 void led_indicate_release();
 
-static void thread_recorder(void* parameter)
+// write the ring to the file. whole sectors, or all of it when sync.
+// the position in the file is the position in the ring, so the sectors are aligned in both.
+static void recorder_flush(recorder_t *recorder, bool sync)
 {
-    int32_t result;
-    rt_err_t rsl = 0;
-    recorder_t *recorder = (recorder_t*) parameter;
-    recorder_msg_t *rec_msg;
-    do
+    while(recorder->head != recorder->tail)
     {
-        rsl = rt_mb_recv(recorder->mailbox, (void*)&rec_msg, RT_TICK_PER_SECOND);
-        if(rsl == -RT_ETIMEOUT)
-            continue;
-
+        uint32_t tail = recorder->tail;
+        uint32_t off = tail % recorder->buf_size;
+        uint32_t len = recorder->head - tail;
+        int32_t result;
+        if(len > recorder->buf_size - off)
+            len = recorder->buf_size - off;
+        if(!sync)
+        {
+            uint32_t end = (tail + len) / RECORDER_SECTOR * RECORDER_SECTOR;
+            if(end - tail > len) // less than a sector to the boundary
+                return;
+            len = end - tail;
+            if(len == 0)
+                return;
+        }
         if(recorder->fd < 0)
         {
             recorder->fd = open(recorder->file_path, O_RDWR | O_APPEND);
-            // close if file error
             if(recorder->fd < 0)
-                break;
+            {
+                // the data has nowhere to go.
+                recorder->error_code = recorder->fd;
+                recorder->tail = recorder->head;
+                return;
+            }
         }
         led_indicate_busy();
-        result = write(recorder->fd, rec_msg->msg, rec_msg->size);
-        recorder->file_size += result;
+        result = write(recorder->fd, &recorder->buf[off], len);
+        recorder->write_calls++;
         led_indicate_release();
-        free(rec_msg);
+        if(result < 0)
+            recorder->error_code = result;
+        else
+            recorder->file_size += result;
+        recorder->tail = tail + len;
+    }
+}
+
+static void thread_recorder(void* parameter)
+{
+    recorder_t *recorder = (recorder_t*) parameter;
+    bool sync;
+    do
+    {
+        rt_sem_take(recorder->sem, RT_TICK_PER_SECOND);
 
         // reopen to flush the data
-        if(recorder->reopen_after == 0 ||
-           rt_tick_get() - recorder->_last_timestamp > recorder->reopen_after)
+        sync = !recorder->is_open || recorder->reopen_after == 0 ||
+                rt_tick_get() - recorder->_last_timestamp > recorder->reopen_after;
+        recorder_flush(recorder, sync);
+        if(sync)
         {
             recorder->_last_timestamp = rt_tick_get();
-            close(recorder->fd);
+            if(recorder->fd >= 0)
+                close(recorder->fd);
             recorder->fd = -1; // marked as closed. reopen required.
         }
-    }while(recorder->is_open || rsl != -RT_ETIMEOUT); // wait for empty
-    recorder->is_open = false;
+    }while(recorder->is_open || recorder->head != recorder->tail); // wait for empty
 
-    // clear mq
-    while(rt_mb_recv(recorder->mailbox, (void*)&rec_msg, 1) != -RT_ETIMEOUT)
-        free(rec_msg);
-
-    if(recorder->fd >= 0)
-        close(recorder->fd);
-    rt_mb_delete(recorder->mailbox);
+    if(recorder->dropped)
+        LOG_W("%s: %d writes dropped, the recorder was full.", recorder->file_path, recorder->dropped);
+    LOG_D("%s: %d bytes in %d writes.", recorder->file_path, recorder->file_size, recorder->write_calls);
+    // the waiting one destroys it.
+    if(recorder->done)
+    {
+        rt_sem_release(recorder->done);
+        return;
+    }
+    rt_sem_delete(recorder->sem);
+    free(recorder->buf);
     memset(recorder, 0, sizeof(recorder_t)); // destroy magic word
     free(recorder);
 }
@@ -81,10 +115,21 @@ void recorder_delete_wait(recorder_t * recorder)
         return;
     if(recorder->magic != RECORDER_MAGIC) // assert
         return;
+    recorder->done = rt_sem_create("rdone", 0, RT_IPC_FLAG_PRIO);
+    if(!recorder->done)
+    {
+        recorder_delete(recorder);
+        return;
+    }
     recorder->is_open = false;
-    // wait until the handle is destroyed.
-    while(recorder->magic != RECORDER_MAGIC)
-        rt_thread_delay(10);
+    rt_sem_release(recorder->sem);
+    // wait until the thread has written everything.
+    rt_sem_take(recorder->done, RT_WAITING_FOREVER);
+    rt_sem_delete(recorder->done);
+    rt_sem_delete(recorder->sem);
+    free(recorder->buf);
+    memset(recorder, 0, sizeof(recorder_t)); // destroy magic word
+    free(recorder);
 }
 
 void recorder_delete(recorder_t * recorder)
@@ -94,35 +139,71 @@ void recorder_delete(recorder_t * recorder)
     if(recorder->magic != RECORDER_MAGIC) // assert
         return;
     recorder->is_open = false;
+    rt_sem_release(recorder->sem);
     // the thread will self-close later
 }
 
-// return the num of byte written. error if return value < 0
-int recorder_write(recorder_t * recorder, const char *str)
+char* recorder_reserve(recorder_t * recorder, uint32_t size)
 {
     if(recorder == NULL)
-        return -1;
+        return NULL;
     if(recorder->magic != RECORDER_MAGIC) // assert
-        return -1;
-    if(!recorder->is_open)
-        return -1;
-    if(!recorder->mailbox)
-        return -1;
-
-    int len = strlen(str); // discard '\0'
-    recorder_msg_t * msg = malloc(sizeof(recorder_msg_t) + len);
-    if(!msg)
-        return -1;
-    msg->size = len;
-    strncpy(msg->msg, str, len);
-    return rt_mb_send_wait(recorder->mailbox, msg, RT_TICK_PER_SECOND);
+        return NULL;
+    if(!recorder->is_open || size > RECORDER_RESERVE_MAX)
+        return NULL;
+    if(recorder->buf_size - (recorder->head - recorder->tail) < size)
+    {
+        recorder->dropped++;
+        return NULL;
+    }
+    // it can run over the end of the ring into the overhang.
+    return (char*)&recorder->buf[recorder->head % recorder->buf_size];
+}
+
+void recorder_commit(recorder_t * recorder, uint32_t len)
+{
+    uint32_t head = recorder->head;
+    uint32_t off = head % recorder->buf_size;
+    // move what is in the overhang to the start of the ring, only when it wraps.
+    if(off + len > recorder->buf_size)
+        memcpy(recorder->buf, &recorder->buf[recorder->buf_size], off + len - recorder->buf_size);
+    // the data before the head.
+    rt_base_t level = rt_hw_interrupt_disable();
+    recorder->head = head + len;
+    rt_hw_interrupt_enable(level);
+    // wake the thread when a sector is ready, or for every message when the file is closed after each.
+    if(recorder->reopen_after == 0 || (head + len) / RECORDER_SECTOR != head / RECORDER_SECTOR)
+        rt_sem_release(recorder->sem);
+}
+
+// return the num of byte written. error if return value < 0
+int recorder_write_bin(recorder_t * recorder, const void *data, uint32_t len)
+{
+    uint32_t index = 0;
+    while(index < len)
+    {
+        uint32_t size = len - index > RECORDER_RESERVE_MAX ? RECORDER_RESERVE_MAX : len - index;
+        char *p = recorder_reserve(recorder, size);
+        if(!p)
+            return index ? index : -1;
+        memcpy(p, (const char*)data + index, size);
+        recorder_commit(recorder, size);
+        index += size;
+    }
+    return len;
+}
+
+// return the num of byte written. error if return value < 0
+int recorder_write(recorder_t * recorder, const char *str)
+{
+    return recorder_write_bin(recorder, str, strlen(str)); // discard '\0'
 }
 /* filepath: the path -> it will be overwrited
  * name: a short name < 8 for this recorder
- * msg_size: the maximum size of a message (strlen()+1)
  * reopen_after: >0: the file will reopen to flush the data after the time
- *               =0: the file will be closed immediately after a message.  */
-recorder_t * recorder_create(const char file_path[], const char name[], rt_tick_t reopen_after_ticks)
+ *               =0: the file will be closed immediately after a message.
+ * buf_size: the ring to hold the data before written, rounded up to sectors. */
+recorder_t * recorder_create(const char file_path[], const char name[], rt_tick_t reopen_after_ticks, uint32_t buf_size)
 {
     recorder_t * recorder;
     char tname[16];
@@ -148,11 +229,18 @@ recorder_t * recorder_create(const char file_path[], const char name[], rt_tick_
     recorder->reopen_after = reopen_after_ticks;
     recorder->is_open = true;
     strncpy(recorder->file_path, file_path, 128);
-    // message queue as a buffer to store data.
-    recorder->mailbox = rt_mb_create(tname, 4, RT_IPC_FLAG_PRIO);
-    if(!recorder->mailbox)
+    // the ring as a buffer to store data, with the overhang for the reservations at its end.
+    recorder->buf_size = (buf_size + RECORDER_SECTOR - 1) / RECORDER_SECTOR * RECORDER_SECTOR;
+    if(recorder->buf_size == 0)
+        recorder->buf_size = RECORDER_SECTOR;
+    recorder->buf = malloc(recorder->buf_size + RECORDER_RESERVE_MAX);
+    recorder->sem = rt_sem_create(tname, 0, RT_IPC_FLAG_PRIO);
+    if(!recorder->buf || !recorder->sem)
     {
-        close(fd); free(recorder);
+        close(fd); free(recorder->buf);
+        if(recorder->sem)
+            rt_sem_delete(recorder->sem);
+        free(recorder);
         return NULL;
     }
     // thread who do the recording.
@@ -161,7 +249,7 @@ recorder_t * recorder_create(const char file_path[], const char name[], rt_tick_
         rt_thread_startup(recorder->tid);
     else
     {
-        close(fd); rt_mb_delete(recorder->mailbox); free(recorder);
+        close(fd); rt_sem_delete(recorder->sem); free(recorder->buf); free(recorder);
         return NULL;
     }
 
@@ -26,33 +26,50 @@ extern "C" {
 
 #define RECORDER_MAGIC (0x787679AE)
 
-// message container.
-typedef struct _recorder_msg_t {
-    int size;
-    char msg[0];
-}recorder_msg_t ;
+#define RECORDER_SECTOR         (512)   // the file is written in whole sectors
+#define RECORDER_RESERVE_MAX    (512)   // the largest reservation, also the overhang after the ring
 
+// The writers reserve space in the ring and format in place, then commit it. They never block,
+// a reservation fails when the ring is full.
+// The thread of the recorder writes the ring to the file in whole sectors, the last partial sector
+// is written when the file is reopened or the recorder is deleted.
+// One writer thread for a recorder.
 typedef struct _recorder_t
 {
    uint32_t magic;
    rt_thread_t tid;
-   rt_mailbox_t mailbox;
-   bool is_open;
+   rt_sem_t sem;                // a sector is ready or the recorder is deleted
+   rt_sem_t done;               // the thread is done, when deleted with waiting.
+   volatile bool is_open;
    uint32_t file_size;
    int32_t error_code;
    int fd;                      // file handle
    char file_path[128];       // path of the file
    rt_tick_t reopen_after;      // save/reopen the file after a certain tick. 0 indicate do not reopen.
    rt_tick_t _last_timestamp;   // do not touch
+
+   uint8_t *buf;                // the ring, buf_size + RECORDER_RESERVE_MAX
+   uint32_t buf_size;           // multiple of RECORDER_SECTOR
+   volatile uint32_t head;      // committed, free running
+   volatile uint32_t tail;      // written to the file, free running
+   uint32_t write_calls;        // write() to the file
+   uint32_t dropped;            // reservations failed, the ring was full
 } recorder_t;
 
-recorder_t * recorder_create(const char file_path[], const char name[], rt_tick_t reopen_after_ticks);
+/* buf_size: the ring, rounded up to sectors. */
+recorder_t * recorder_create(const char file_path[], const char name[], rt_tick_t reopen_after_ticks, uint32_t buf_size);
 
 void recorder_delete(recorder_t * recorder);
 void recorder_delete_wait(recorder_t * recorder);
 
+/* space of size (<= RECORDER_RESERVE_MAX) to write in place, NULL if the ring is full.
+ * commit len (<= size) of it to the file. */
+char* recorder_reserve(recorder_t * recorder, uint32_t size);
+void recorder_commit(recorder_t * recorder, uint32_t len);
+
 // return the num of byte written. errer if return value < 0
 int recorder_write(recorder_t * recorder, const char *str);
+int recorder_write_bin(recorder_t * recorder, const void *data, uint32_t len);
 
 
 #ifdef __cplusplus
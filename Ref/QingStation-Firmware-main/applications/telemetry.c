@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <string.h>
+#include <time.h>
+
+#include <rtthread.h>
+#include "data_pool.h"
+#include "data_format.h"
+#include "timebase.h"
+#include "telemetry.h"
+
+static telemetry_t frames[TELEMETRY_FRAME_NUM];
+static telemetry_t *current = NULL;
+static const data_desc_t *subscribed[DATA_NUM];
+static uint32_t subscribed_num = 0;
+static struct rt_mutex lock;
+
+void telemetry_subscribe(const data_desc_t **fields, uint32_t num)
+{
+    rt_mutex_take(&lock, RT_WAITING_FOREVER);
+    for(uint32_t i=0; i<num; i++)
+    {
+        uint32_t k = 0;
+        while(k < subscribed_num && subscribed[k] != fields[i])
+            k++;
+        if(k == subscribed_num && subscribed_num < DATA_NUM)
+            subscribed[subscribed_num++] = fields[i];
+    }
+    // the last frame does not have the new fields.
+    current = NULL;
+    rt_mutex_release(&lock);
+}
+
+// snapshot and format the subscribed data, under the lock.
+static void telemetry_build(telemetry_t *t)
+{
+    static data_frame_t frame;
+    struct tm tm;
+    time_t sec;
+    uint32_t index = 0;
+
+    data_frame_take(&frame, subscribed, subscribed_num);
+    t->us = timebase_us();
+    t->utc_us = timebase_utc_us(t->us);
+    sec = t->utc_us / 1000000;
+    strftime(t->stamp, sizeof(t->stamp), "%Y%m%d%H%M%S", gmtime_r(&sec, &tm));
+    for(uint32_t i=0; i<subscribed_num; i++)
+    {
+        const data_desc_t *d = subscribed[i];
+        uint32_t id = d - data_desc;
+        const void *p = data_ptr(&frame, d);
+        if(d->info)
+        {
+            const sensor_info_t *info = (const sensor_info_t *)((const char *)&frame + d->frame);
+            t->sample_utc[d->instance] = info->update_us ? timebase_utc_us(info->update_us) : 0;
+        }
+        switch(d->type)
+        {
+        case DATA_FLOAT:
+        case DATA_INT:
+        case DATA_UINT: t->value[id] = *(const uint32_t *)p; break;
+        case DATA_BOOL: t->value[id] = *(const bool *)p; break;
+        default: t->value[id] = 0; break;
+        }
+        // most values are a few chars, the large ones are printed again when taken if there is no room.
+        if(index + FORMAT_FLOAT_LEN + 1 > TELEMETRY_TEXT_SIZE)
+        {
+            t->text_len[id] = 0;
+            continue;
+        }
+        t->text_off[id] = index;
+        t->text_len[id] = data_print(&frame, d, &t->text[index]);
+        index += t->text_len[id] + 1;
+    }
+}
+
+const telemetry_t *telemetry_take(void)
+{
+    telemetry_t *t = NULL;
+    rt_mutex_take(&lock, RT_WAITING_FOREVER);
+    if(current && timebase_us() - current->us <= TELEMETRY_MAX_AGE * 1000)
+        t = current;
+    else
+    {
+        for(int i=0; i<TELEMETRY_FRAME_NUM && !t; i++)
+        {
+            if(frames[i].ref == 0)
+                t = &frames[i];
+        }
+        if(t)
+        {
+            telemetry_build(t);
+            current = t;
+        }
+    }
+    if(t)
+        t->ref++;
+    rt_mutex_release(&lock);
+    return t;
+}
+
+void telemetry_release(const telemetry_t *t)
+{
+    if(!t)
+        return;
+    rt_mutex_take(&lock, RT_WAITING_FOREVER);
+    ((telemetry_t *)t)->ref--;
+    rt_mutex_release(&lock);
+}
+
+int telemetry_print(const telemetry_t *t, const data_desc_t *d, char *buf)
+{
+    uint32_t id = d - data_desc;
+    uint32_t len = t->text_len[id];
+    if(len)
+    {
+        // a few chars, a loop is faster than memcpy.
+        const char *s = &t->text[t->text_off[id]];
+        for(uint32_t i=0; i<=len; i++)
+            buf[i] = s[i];
+        return len;
+    }
+    // not formatted, from the value.
+    switch(d->type)
+    {
+    case DATA_FLOAT:
+    {
+        union {uint32_t u; float f;} x = {.u = t->value[id]};
+        if(d->precision == 0)
+            return format_trunc(buf, x.f);
+        return format_float(buf, x.f, d->precision);
+    }
+    case DATA_INT: return format_int(buf, (int32_t)t->value[id]);
+    case DATA_UINT: return format_uint(buf, t->value[id]);
+    case DATA_BOOL: return format_str(buf, t->value[id] ? "true" : "false");
+    default: return format_str(buf, "unknown");
+    }
+}
+
+int telemetry_stamp(const telemetry_t *t, char *buf, const char *sep)
+{
+    int len = 0;
+    memcpy(buf, t->stamp, 8);
+    len += 8;
+    len += format_str(buf + len, sep);
+    len += format_str(buf + len, t->stamp + 8);
+    return len;
+}
+
+int telemetry_init()
+{
+    rt_mutex_init(&lock, "telem", RT_IPC_FLAG_PRIO);
+    return 0;
+}
+INIT_ENV_EXPORT(telemetry_init);
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <rtthread.h>
+#include "data_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Telemetry frames, the data of a period formatted once for all the outputs.
+// The record, log and MQTT threads subscribe their fields. A frame is a snapshot of all the subscribed
+// fields, with each value as a 32bit word (the compact binary) and as the text of data_print(),
+// and the UTC each sensor acquired its values.
+// A frame is immutable once built, shared by reference count. The first output waking in a period
+// builds it, the others within TELEMETRY_MAX_AGE take the same frame.
+
+#define TELEMETRY_FRAME_NUM     (3)     // frames, one for each output at most
+#define TELEMETRY_TEXT_SIZE     (1024)  // text of the values in a frame
+#define TELEMETRY_MAX_AGE       (20)    // ms, a frame is shared within this time
+
+typedef struct _telemetry_t
+{
+    volatile uint16_t ref;
+    uint64_t us;                    // monotonic time it is taken
+    int64_t utc_us;                 // UTC of it
+    char stamp[16];                 // "YYYYMMDDhhmmss" of the UTC
+    int64_t sample_utc[DATA_INSTANCE_NUM]; // UTC in us of the acquisition of each instance, 0 if never
+    uint32_t value[DATA_NUM];       // value of each subscribed data by DATA_ID_xxx, bool as 0/1
+    uint16_t text_off[DATA_NUM];    // text of the value in text[]
+    uint8_t text_len[DATA_NUM];     // 0 = not formatted, the text buffer was full
+    char text[TELEMETRY_TEXT_SIZE];
+} telemetry_t;
+
+/* add the fields to the frames, each once. call before taking the frames. */
+void telemetry_subscribe(const data_desc_t **fields, uint32_t num);
+
+/* the frame of now, a new one if the last is older than TELEMETRY_MAX_AGE.
+ * return NULL if all frames are still in use. */
+const telemetry_t *telemetry_take(void);
+void telemetry_release(const telemetry_t *t);
+
+/* print the text of a subscribed data to buf, the same as data_print(). return the length. */
+int telemetry_print(const telemetry_t *t, const data_desc_t *d, char *buf);
+/* the timestamp with sep between the date and the time. return the length. */
+int telemetry_stamp(const telemetry_t *t, char *buf, const char *sep);
+
+// UTC in us when the value of a subscribed data was acquired, 0 if never.
+static inline int64_t telemetry_time(const telemetry_t *t, const data_desc_t *d)
+{
+    return d->info ? t->sample_utc[d->instance] : 0;
+}
+
+// value of a subscribed data as float, the same as data_get().
+static inline float telemetry_get(const telemetry_t *t, const data_desc_t *d)
+{
+    uint32_t v = t->value[d - data_desc];
+    switch(d->type)
+    {
+    case DATA_FLOAT: {union {uint32_t u; float f;} x = {.u = v}; return x.f;}
+    case DATA_INT: return (int32_t)v;
+    case DATA_UINT: return v;
+    case DATA_BOOL: return v;
+    default: return -1;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_H__ */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdint.h>
+#include <time.h>
+
+#include <rtthread.h>
+#include "data_format.h"
+#include "timebase.h"
+
+// the offset is written to the other slot then published by the index,
+// a reader never sees a half written 64bit offset. the syncs are minutes apart.
+// the sources are in different threads, a sync is in a critical section.
+static int64_t offsets[2];
+static volatile int offset_index = 0;
+static volatile int sync_source = TIMEBASE_SRC_NONE;
+static uint64_t sync_us = 0;
+
+void timebase_sync(int64_t utc_us, uint64_t mono_us, int source)
+{
+    rt_enter_critical();
+    if(source < sync_source && mono_us - sync_us < TIMEBASE_SYNC_EXPIRE)
+    {
+        rt_exit_critical();
+        return;
+    }
+    int next = !offset_index;
+    offsets[next] = utc_us - (int64_t)mono_us;
+    __asm volatile("" ::: "memory");
+    offset_index = next;
+    sync_source = source;
+    sync_us = mono_us;
+    rt_exit_critical();
+}
+
+int64_t timebase_utc_us(uint64_t mono_us)
+{
+    // the RTC until a better source, and again every TIMEBASE_SYNC_EXPIRE when no source syncs,
+    // the SysTick drifts from the RTC.
+    uint64_t now = timebase_us();
+    if(sync_source == TIMEBASE_SRC_NONE || (int64_t)(now - sync_us) >= (int64_t)TIMEBASE_SYNC_EXPIRE)
+        timebase_sync((int64_t)time(NULL) * 1000000, now, TIMEBASE_SRC_RTC);
+    return (int64_t)mono_us + offsets[offset_index];
+}
+
+int timebase_source(void)
+{
+    return sync_source;
+}
+
+// days since 1970-01-01 of a date in the Gregorian calendar.
+static int64_t days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + doe - 719468;
+}
+
+int64_t timebase_make_utc(int year, int month, int day, int hour, int minute, int second, int us)
+{
+    int64_t sec = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return sec * 1000000 + us;
+}
+
+int timebase_format(char *buf, int64_t utc_us)
+{
+    if(utc_us < 0)
+        utc_us = 0;
+    uint32_t us = utc_us % 1000000;
+    int len = format_uint(buf, (uint32_t)(utc_us / 1000000));
+    buf[len++] = '.';
+    for(int i=5; i>=0; i--)
+    {
+        buf[len + i] = '0' + us % 10;
+        us /= 10;
+    }
+    len += 6;
+    buf[len] = '\0';
+    return len;
+}
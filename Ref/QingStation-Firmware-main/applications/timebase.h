@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __TIMEBASE_H__
+#define __TIMEBASE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time of the samples.
+// timebase_us() is a 64bit monotonic clock in us since boot, it never jumps and does not wrap.
+// It is the RT-Thread tick with the count of SysTick within the tick, drv_timebase.c on the MCU
+// and host/timebase_stub.c on PC.
+// The UTC is the monotonic time plus an offset, set by the time sources. A better source is kept
+// until it is TIMEBASE_SYNC_EXPIRE old, a worse one is taken after that. Before any, and whenever the last
+// sync is TIMEBASE_SYNC_EXPIRE old, the RTC is used.
+// The UTC steps at a sync, the monotonic time does not, so the intervals are measured by the monotonic time.
+
+#define TIMEBASE_SYNC_EXPIRE    (3600ull * 1000000)     // us, a sync is kept against worse sources
+#define TIMEBASE_FORMAT_LEN     (24)                    // buffer for timebase_format()
+
+// the sources, better ones larger.
+enum {
+    TIMEBASE_SRC_NONE = 0,
+    TIMEBASE_SRC_RTC,       // second resolution
+    TIMEBASE_SRC_NTP,       // the network delay compensated by half the round trip
+    TIMEBASE_SRC_GNSS,      // the time of the fix, without PPS the delay of the sentence remains
+};
+
+/* monotonic time in us, provided by the platform. */
+uint64_t timebase_us(void);
+
+/* the UTC in us was utc_us at the monotonic time mono_us. */
+void timebase_sync(int64_t utc_us, uint64_t mono_us, int source);
+/* UTC in us of a monotonic time. */
+int64_t timebase_utc_us(uint64_t mono_us);
+/* source of the current UTC. */
+int timebase_source(void);
+
+/* UTC in us of a date and time, no time zone. */
+int64_t timebase_make_utc(int year, int month, int day, int hour, int minute, int second, int us);
+/* "seconds.microseconds" since 1970, return the length. */
+int timebase_format(char *buf, int64_t utc_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMEBASE_H__ */
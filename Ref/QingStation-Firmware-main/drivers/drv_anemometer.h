@@ -26,12 +26,7 @@ typedef enum {
     CH_NONE,
 } ULTRASONIC_CHANNEL;
 
-static char ane_ch_names[][2] = {
-    "N",
-    "E",
-    "S",
-    "W"
-};
+extern const char ane_ch_names[][2];
 
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
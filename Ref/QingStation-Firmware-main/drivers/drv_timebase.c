@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+
+#include <rtthread.h>
+#include <rthw.h>
+#include <board.h>
+#include "timebase.h"
+
+#define US_PER_TICK     (1000000 / RT_TICK_PER_SECOND)
+
+// the tick is 32bit, it wraps every 49 days at 1kHz. the wraps are counted when it is read,
+// the sensors read it far more often than that.
+static uint32_t tick_high = 0;
+static rt_tick_t tick_last = 0;
+
+uint64_t timebase_us(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_tick_t tick = rt_tick_get();
+    uint32_t load = SysTick->LOAD;
+    uint32_t val = SysTick->VAL;
+    // SysTick has reloaded but its interrupt is not served yet, the tick is one behind.
+    // read the counter again, it is after the reload for sure.
+    if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        tick++;
+        val = SysTick->VAL;
+    }
+    if(tick < tick_last && tick_last - tick > 0x80000000u)
+        tick_high++;
+    tick_last = tick;
+    uint64_t ticks = ((uint64_t)tick_high << 32) | tick;
+    rt_hw_interrupt_enable(level);
+
+    // SysTick counts down from load within a tick.
+    // in the low power modes SysTick stops, the tick is compensated at wake up and the us within it start over.
+    return ticks * US_PER_TICK + (uint64_t)(load - val) * US_PER_TICK / (load + 1);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_extract.h"
+#include "anemometer_tracker.h"
+
+// Compare the single pass extractor with the buffered chain
+// preprocess() -> ane_filter_run() -> normalize() -> capture_peaks() -> linear_interpolation_zerocrossing(),
+// both the features and the run time, on synthetic echoes.
+
+#define NUM_FRAMES  (64)
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static float rand_noise(float amp)
+{
+    return amp * ((float)rand() / RAND_MAX * 2 - 1);
+}
+
+// 40kHz echo with a raised envelope, arrives at t0 (us)
+static void make_echo(uint16_t *raw, float t0, float amp, float noise)
+{
+    for(int i=0; i<ADC_SAMPLE_LEN; i++)
+    {
+        float v = 2048 + rand_noise(noise);
+        float t = i - t0;
+        if(t > 0 && t < 300)
+            v += amp * sinf(M_PI * t / 300) * sinf(M_PI * t / 300) * sinf(2 * M_PI * t / 25);
+        raw[i] = (uint16_t)lrintf(v);
+    }
+}
+
+// the buffered chain, as ane_process_channel() did before the single pass extractor.
+static int buffered(uint16_t *raw, int filter_start, int start, int len, float *sig, float *sig2,
+        float shape[PEAK_LEN][2], float zc[ZEROCROSS_LEN])
+{
+    memset(shape, 0, sizeof(float) * PEAK_LEN * 2);
+    memset(zc, 0, sizeof(float) * ZEROCROSS_LEN);
+    preprocess(&raw[filter_start], &sig2[filter_start], 2048, start + len - filter_start);
+    ane_filter_run(&ane_bp_filter, &sig2[filter_start], &sig[filter_start], start + len - filter_start);
+    normalize(&sig[start], len);
+    int pz = capture_peaks(&sig[start], len, shape, PEAK_LEFT, PEAK_RIGHT, 0.02);
+    int off = shape[PEAK_ZC][0];
+    linear_interpolation_zerocrossing(&sig[start + off], len - off, zc, ZEROCROSS_LEN);
+    return pz;
+}
+
+static int fused(uint16_t *raw, int filter_start, int start, int len, ane_features_t *ft,
+        float shape[PEAK_LEN][2], float zc[ZEROCROSS_LEN])
+{
+    memset(shape, 0, sizeof(float) * PEAK_LEN * 2);
+    memset(zc, 0, sizeof(float) * ZEROCROSS_LEN);
+    ane_extract(raw, 2048, filter_start, start, len, ft);
+    int pz = ane_features_shape(ft, shape, 0.02);
+    int off = shape[PEAK_ZC][0];
+    ane_features_zerocross(ft, off, zc, ZEROCROSS_LEN);
+    return pz;
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    static uint16_t raw[NUM_FRAMES][ADC_SAMPLE_LEN];
+    static float sig[ADC_SAMPLE_LEN], sig2[ADC_SAMPLE_LEN];
+    float shape1[PEAK_LEN][2], shape2[PEAK_LEN][2];
+    float zc1[ZEROCROSS_LEN], zc2[ZEROCROSS_LEN];
+    ane_features_t ft;
+    int mismatch = 0;
+    int windows[2][3] = {
+            {0, DEADZONE_OFFSET, VALID_LEN},                        // full window
+            {650 - TRACK_WINDOW_LEFT - FILTER_GUARD_LEN, 650 - TRACK_WINDOW_LEFT,
+                    TRACK_WINDOW_LEFT + TRACK_WINDOW_RIGHT}};       // tracking window around the main peak
+    const char *window_names[2] = {"full", "tracking"};
+
+    ane_filter_init(&ane_bp_filter, ANE_FILTER_SOS_F32, 2);
+    srand(1);
+    for(int f=0; f<NUM_FRAMES; f++)
+        make_echo(raw[f], 500 + rand_noise(50), 200 + rand_noise(100), 4);
+
+    // 1. same features
+    for(int w=0; w<2; w++)
+    {
+        for(int f=0; f<NUM_FRAMES; f++)
+        {
+            int pz1 = buffered(raw[f], windows[w][0], windows[w][1], windows[w][2], sig, sig2, shape1, zc1);
+            int pz2 = fused(raw[f], windows[w][0], windows[w][1], windows[w][2], &ft, shape2, zc2);
+            if(pz1 != pz2 || memcmp(shape1, shape2, sizeof(shape1)) || memcmp(zc1, zc2, sizeof(zc1)))
+            {
+                printf("%s window, frame %d: features differ\n", window_names[w], f);
+                mismatch++;
+            }
+        }
+    }
+    printf("%d frames x 2 windows, %d mismatched\n", NUM_FRAMES, mismatch);
+
+    // 2. run time, best of a few runs
+    printf("\n%-10s %12s %12s\n", "window", "buffered", "single pass");
+    for(int w=0; w<2; w++)
+    {
+        double t_buf = 1e9, t_fused = 1e9;
+        for(int r=0; r<5; r++)
+        {
+            double t = now_us();
+            for(int i=0; i<iterations; i++)
+                for(int f=0; f<NUM_FRAMES; f++)
+                    buffered(raw[f], windows[w][0], windows[w][1], windows[w][2], sig, sig2, shape1, zc1);
+            t_buf = fmin(t_buf, (now_us() - t) / iterations / NUM_FRAMES);
+
+            t = now_us();
+            for(int i=0; i<iterations; i++)
+                for(int f=0; f<NUM_FRAMES; f++)
+                    fused(raw[f], windows[w][0], windows[w][1], windows[w][2], &ft, shape2, zc2);
+            t_fused = fmin(t_fused, (now_us() - t) / iterations / NUM_FRAMES);
+        }
+        printf("%-10s %9.2fus %9.2fus\n", window_names[w], t_buf, t_fused);
+    }
+    printf("\nworking memory: buffered %u bytes, single pass %u bytes\n",
+            (unsigned)(sizeof(sig) + sizeof(sig2)),
+            (unsigned)(sizeof(ane_features_t) + 2 * EXTRACT_BLOCK_LEN * sizeof(float)       // features, blocks
+                    + sizeof(float) * 2 * (EXTRACT_TURN_LEN * 2 + EXTRACT_ZC_LEN * 3)));   // history rings
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_fft.h"
+
+// Compare the FFT correlation with the direct form match_filter() and correlation(),
+// both the result and the run time. Signal is the capture after the dead zone, pattern is the cpulse.
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static float rand_noise(float amp)
+{
+    return amp * ((float)rand() / RAND_MAX * 2 - 1);
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    static float x[ANE_FFT_LEN], buf[ANE_FFT_LEN];
+    static float sig[ADC_SAMPLE_LEN], work[ANE_FFT_LEN];
+    static float out_direct[ADC_SAMPLE_LEN], out_fft[ADC_SAMPLE_LEN];
+    static float out_corr[2*ADC_SAMPLE_LEN];
+    static float pattern[ADC_SAMPLE_LEN];
+    static ane_xcorr_t xc;
+    double t, err, ref;
+    uint32_t sig_len = VALID_LEN;
+    uint32_t idx_direct = 0, idx_fft = 0;
+
+    if(ane_rfft_init())
+    {
+        printf("fft init failed\n");
+        return 1;
+    }
+
+    // 1. real fft against a plain DFT
+    srand(1);
+    for(int i=0; i<ANE_FFT_LEN; i++)
+        x[i] = rand_noise(1);
+    memcpy(buf, x, sizeof(buf));
+    ane_rfft(buf);
+    err = 0; ref = 0;
+    for(int k=0; k<=ANE_FFT_LEN/2; k++)
+    {
+        double re = 0, im = 0;
+        for(int n=0; n<ANE_FFT_LEN; n++)
+        {
+            re += x[n] * cos(2 * M_PI * k * n / ANE_FFT_LEN);
+            im -= x[n] * sin(2 * M_PI * k * n / ANE_FFT_LEN);
+        }
+        double fr, fi;
+        if(k == 0)                  { fr = buf[0]; fi = 0; }
+        else if(k == ANE_FFT_LEN/2) { fr = buf[1]; fi = 0; }
+        else                        { fr = buf[2*k]; fi = buf[2*k+1]; }
+        err = fmax(err, hypot(fr - re, fi - im));
+        ref = fmax(ref, hypot(re, im));
+    }
+    printf("rfft %d points, max error vs dft: %.3g (relative %.3g)\n", ANE_FFT_LEN, err, err / ref);
+
+    ane_irfft(buf);
+    err = 0;
+    for(int i=0; i<ANE_FFT_LEN; i++)
+        err = fmax(err, fabs(buf[i] - x[i]));
+    printf("irfft(rfft(x)) max error: %.3g\n", err);
+
+    // 2. correlation of a noisy echo with the reference pulse
+    int pattern_len = get_pattern_len(pulse_len - 1, PULSE_FREQ);
+    create_pattern2(&cpulse[1], pulse_len - 1, pattern, PULSE_FREQ, 1);
+    if(ane_xcorr_init(&xc, pattern, pattern_len))
+    {
+        printf("xcorr init failed\n");
+        return 1;
+    }
+    for(int i=0; i<sig_len; i++)
+        sig[i] = rand_noise(0.1f);
+    for(int i=0; i<pattern_len; i++)
+        sig[300 + i] += pattern[i] * pattern_len / 4;
+
+    idx_direct = match_filter(sig, sig_len, pattern, pattern_len, out_direct);
+    idx_fft = ane_xcorr(&xc, sig, sig_len, work, out_fft);
+    err = 0; ref = 0;
+    for(int i=0; i<sig_len - pattern_len; i++)
+    {
+        err = fmax(err, fabs(out_direct[i] - out_fft[i]));
+        ref = fmax(ref, fabs(out_direct[i]));
+    }
+    printf("signal %d, pattern %d, peak direct %u, fft %u, max error %.3g (relative %.3g)\n",
+            sig_len, pattern_len, idx_direct, idx_fft, err, err / ref);
+
+    // 3. run time
+    t = now_us();
+    for(int i=0; i<iterations; i++)
+        idx_direct += match_filter(sig, sig_len, pattern, pattern_len, out_direct);
+    double t_match = (now_us() - t) / iterations;
+
+    t = now_us();
+    for(int i=0; i<iterations; i++)
+        correlation(sig, sig_len, pattern, pattern_len, out_corr);
+    double t_corr = (now_us() - t) / iterations;
+
+    t = now_us();
+    for(int i=0; i<iterations; i++)
+        idx_fft += ane_xcorr(&xc, sig, sig_len, work, out_fft);
+    double t_fft = (now_us() - t) / iterations;
+
+    t = now_us();
+    for(int i=0; i<iterations; i++)
+    {
+        memcpy(buf, x, sizeof(buf));
+        ane_rfft(buf);
+    }
+    double t_rfft = (now_us() - t) / iterations;
+
+    printf("\n%-24s %10s\n", "method", "us/call");
+    printf("%-24s %10.2f\n", "match_filter (direct)", t_match);
+    printf("%-24s %10.2f\n", "correlation (direct)", t_corr);
+    printf("%-24s %10.2f\n", "ane_xcorr (fft)", t_fft);
+    printf("%-24s %10.2f\n", "ane_rfft", t_rfft);
+    printf("speed up over match_filter: %.1fx\n", t_match / t_fft);
+    return (idx_direct == idx_fft) ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "anemometer_rate.h"
+
+// Adaptive measurement rate on a synthetic day.
+// The wind of each phase is a mean plus turbulence of its own strength, the turbulence of each component
+// is a first order random process of TURB_TAU. The truth is simulated on a fine grid, a measurement is the truth
+// at its instant plus the noise of the anemometer. The 1 minute averages of the measurements are compared with
+// the ones of the truth, for the adaptive rate and for fixed rates, with the measurements as the energy spent.
+// Each measurement is weighted by its period, as the statistics on the station take it for every data period.
+
+#define GRID_MS         (50)
+#define TURB_TAU        (5000.f)    // ms
+#define MEAS_NOISE      (0.05f)     // m/s
+#define AVG_MS          (60000)
+
+typedef struct _phase_t
+{
+    const char *name;
+    uint32_t len_ms;
+    float speed;        // mean wind, m/s
+    float dir;          // deg
+    float turb;         // std of each component, m/s
+} phase_t;
+
+static const phase_t phases[] = {
+        {"calm night",   7200000, 0.8f,  200, 0.10f},
+        {"breeze",       3600000, 3.0f,  240, 0.50f},
+        {"gust front",   1800000, 9.0f,  300, 2.50f},
+        {"moderate",     3600000, 5.0f,  280, 1.00f},
+        {"calm evening", 5400000, 1.2f,  250, 0.15f},
+};
+#define PHASE_NUM   (sizeof(phases)/sizeof(phases[0]))
+
+typedef struct _policy_result_t
+{
+    uint32_t samples[PHASE_NUM];
+    double err_sq[PHASE_NUM];   // square error of the 1 minute averages
+    uint32_t windows[PHASE_NUM];
+    uint32_t changes;
+} policy_result_t;
+
+static uint32_t rng_state = 1;
+static float randu(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (rng_state >> 8) / 16777216.f;
+}
+
+static float randn(void)
+{
+    float u1 = randu() + 1e-7f, u2 = randu();
+    return sqrtf(-2 * logf(u1)) * cosf(2 * 3.1415926f * u2);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -p ms     fastest period, default 250\n"
+            "  -P ms     slowest period, default 4000\n"
+            "  -f ms     fixed period to compare with, default 500\n"
+            "  -b        the battery discharges from 4.1V to 3.3V over the day\n"
+            "  -L V      battery low, default 3.6\n"
+            "  -C V      battery critical, default 3.4\n"
+            "  -s seed   random seed, default 1\n"
+            "  -v        print the rate changes\n", name);
+}
+
+static int phase_of(uint32_t t, uint32_t *start)
+{
+    uint32_t end = 0;
+    for(int i=0; i<PHASE_NUM; i++)
+    {
+        end += phases[i].len_ms;
+        if(t < end)
+        {
+            if(start)
+                *start = end - phases[i].len_ms;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static float battery(uint32_t t, uint32_t total, bool is_discharge)
+{
+    return is_discharge ? 4.1f - 0.8f * t / total : 4.0f;
+}
+
+// measure the truth at the periods of a fixed rate (ctrl = NULL) or of the controller.
+static void run(float (*truth)[2], uint32_t total, uint32_t fixed, ane_rate_t *ctrl, bool is_discharge,
+        bool is_verbose, policy_result_t *out)
+{
+    double sum[2] = {0}, tsum[2] = {0}, weight = 0;
+    uint32_t window_start = 0;
+    uint32_t t = 0, next = 0;
+    memset(out, 0, sizeof(policy_result_t));
+    for(t=0; t<total; t+=GRID_MS)
+    {
+        int g = t / GRID_MS;
+        int ph = phase_of(t, NULL);
+        tsum[0] += truth[g][0];
+        tsum[1] += truth[g][1];
+        if(t >= next)
+        {
+            float ns = truth[g][0] + MEAS_NOISE * randn();
+            float ew = truth[g][1] + MEAS_NOISE * randn();
+            out->samples[ph]++;
+            uint32_t period = fixed;
+            if(ctrl)
+            {
+                ane_rate_add(ctrl, ns, ew, t);
+                int reason = ane_rate_update(ctrl, battery(t, total, is_discharge), t);
+                if(reason != ANE_RATE_KEEP && is_verbose)
+                    printf("%7.1fmin  %-12s period %5ums  std %.2fm/s  battery %.2fV%s\n", t / 60000.f,
+                            phases[ph].name, ctrl->period, ane_rate_sigma(ctrl), battery(t, total, is_discharge),
+                            reason == ANE_RATE_BATTERY ? "  (battery)" : "");
+                period = ctrl->period;
+            }
+            sum[0] += ns * period;
+            sum[1] += ew * period;
+            weight += period;
+            next = t + period;
+        }
+        // 1 minute averages, the windows across 2 phases are not counted.
+        if(t + GRID_MS - window_start >= AVG_MS)
+        {
+            int grids = AVG_MS / GRID_MS;
+            uint32_t ph_start;
+            int ph0 = phase_of(window_start, &ph_start);
+            if(weight > 0 && ph0 == ph)
+            {
+                float e_ns = sum[0] / weight - tsum[0] / grids;
+                float e_ew = sum[1] / weight - tsum[1] / grids;
+                out->err_sq[ph] += e_ns * e_ns + e_ew * e_ew;
+                out->windows[ph]++;
+            }
+            memset(sum, 0, sizeof(sum));
+            memset(tsum, 0, sizeof(tsum));
+            weight = 0;
+            window_start = t + GRID_MS;
+        }
+    }
+    if(ctrl)
+        out->changes = ctrl->changes;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t period_min = 250, period_max = 4000, fixed = 500;
+    float bat_low = 3.6f, bat_critical = 3.4f;
+    bool is_discharge = false, is_verbose = false;
+    int opt;
+
+    while((opt = getopt(argc, argv, "p:P:f:bL:C:s:vh")) != -1)
+    {
+        switch(opt)
+        {
+        case 'p': period_min = atoi(optarg); break;
+        case 'P': period_max = atoi(optarg); break;
+        case 'f': fixed = atoi(optarg); break;
+        case 'b': is_discharge = true; break;
+        case 'L': bat_low = atof(optarg); break;
+        case 'C': bat_critical = atof(optarg); break;
+        case 's': rng_state = atoi(optarg); break;
+        case 'v': is_verbose = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    // the truth on a grid
+    uint32_t total = 0;
+    for(int i=0; i<PHASE_NUM; i++)
+        total += phases[i].len_ms;
+    float (*truth)[2] = malloc(sizeof(float) * 2 * (total / GRID_MS + 1));
+    if(!truth)
+        return 1;
+    float turb[2] = {0};
+    float a = expf(-GRID_MS / TURB_TAU);
+    for(uint32_t t=0; t<total; t+=GRID_MS)
+    {
+        const phase_t *p = &phases[phase_of(t, NULL)];
+        float rad = p->dir / 180 * 3.1415926f;
+        for(int k=0; k<2; k++)
+            turb[k] = turb[k] * a + p->turb * sqrtf(1 - a * a) * randn();
+        truth[t / GRID_MS][0] = -p->speed * cosf(rad) + turb[0];
+        truth[t / GRID_MS][1] = -p->speed * sinf(rad) + turb[1];
+    }
+
+    static policy_result_t r_fast, r_fixed, r_adapt;
+    ane_rate_t ctrl;
+    run(truth, total, period_min, NULL, false, false, &r_fast);
+    run(truth, total, fixed, NULL, false, false, &r_fixed);
+    ane_rate_init(&ctrl, period_min, period_max, fixed, bat_low, bat_critical, 0);
+    run(truth, total, 0, &ctrl, is_discharge, is_verbose, &r_adapt);
+    free(truth);
+
+    printf("\n%-12s %6s | %-15s | %-15s | %-15s\n", "", "turb", "fixed fastest", "fixed", "adaptive");
+    printf("%-12s %6s | %7s %7s | %7s %7s | %7s %7s\n", "phase", "m/s", "meas", "rms", "meas", "rms", "meas", "rms");
+    uint32_t total_meas[3] = {0};
+    for(int i=0; i<PHASE_NUM; i++)
+    {
+        policy_result_t *r[3] = {&r_fast, &r_fixed, &r_adapt};
+        printf("%-12s %6.2f |", phases[i].name, phases[i].turb);
+        for(int k=0; k<3; k++)
+        {
+            printf(" %7u %7.3f |", r[k]->samples[i],
+                    r[k]->windows[i] ? sqrt(r[k]->err_sq[i] / r[k]->windows[i]) : 0);
+            total_meas[k] += r[k]->samples[i];
+        }
+        printf("\n");
+    }
+    printf("measurements: fastest %ums %u, fixed %ums %u, adaptive %u (%.0f%% of fixed), %u rate changes\n",
+            period_min, total_meas[0], fixed, total_meas[1], total_meas[2], 100.0 * total_meas[2] / total_meas[1],
+            r_adapt.changes);
+    return 0;
+}
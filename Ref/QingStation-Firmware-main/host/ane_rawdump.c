@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_raw.h"
+#include "capture_file.h"
+
+// Binary raw captures to csv, North,South,East,West as ane_replay reads.
+// With -e, the other way: captures (csv or frames) to binary frames, to compare the codings.
+
+static const char *coding_names[ANE_RAW_CODING_NUM] = {
+        "plain",
+        "pack12",
+        "delta",
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] captures\n"
+            "  -i        print the header of each frame to stderr\n"
+            "  -e coding encode to binary frames: 0=plain, 1=pack12, 2=delta\n"
+            "  -o file   output, default stdout\n", name);
+}
+
+static void print_header(int idx, ane_raw_header_t *h)
+{
+    time_t t = h->timestamp;
+    char str[32];
+    strftime(str, sizeof(str), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+    fprintf(stderr, "frame %d: %s, tick %u, err %d, pulse %08X, %s %u bytes, level %.1f, %.1f, %.1f, %.1f\n",
+            idx, str, h->tick, h->err, h->pulse_id, coding_names[h->coding], h->payload,
+            h->sig_level[NORTH], h->sig_level[EAST], h->sig_level[SOUTH], h->sig_level[WEST]);
+}
+
+int main(int argc, char* argv[])
+{
+    const char *out_path = NULL;
+    uint16_t (*frames)[4][ADC_SAMPLE_LEN] = NULL;
+    ane_raw_header_t *heads = NULL;
+    bool is_info = false;
+    int coding = -1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "ie:o:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'i': is_info = true; break;
+        case 'e': coding = atoi(optarg); break;
+        case 'o': out_path = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if(optind >= argc || coding >= ANE_RAW_CODING_NUM)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int num = load_captures(argv[optind], &frames, &heads);
+    if(num <= 0)
+    {
+        fprintf(stderr, "no capture in %s\n", argv[optind]);
+        return 1;
+    }
+    FILE *out = stdout;
+    if(out_path)
+    {
+        out = fopen(out_path, coding >= 0 ? "wb" : "w");
+        if(!out)
+        {
+            fprintf(stderr, "cannot open %s\n", out_path);
+            return 1;
+        }
+    }
+
+    uint64_t bytes = 0;
+    if(coding < 0)
+        fprintf(out, "North,South,East,West\n");
+    for(int i=0; i<num; i++)
+    {
+        if(is_info)
+            print_header(i, &heads[i]);
+        if(coding < 0)
+        {
+            write_capture_csv(out, frames[i]);
+            continue;
+        }
+        static uint8_t buf[ANE_RAW_FRAME_MAX];
+        ane_raw_header_t h = heads[i];
+        if(h.magic != ANE_RAW_MAGIC) // from csv
+        {
+            h.err = -1;
+            h.pulse_id = ane_raw_pulse_id();
+        }
+        uint32_t size = ane_raw_encode(&h, frames[i], coding, buf);
+        fwrite(buf, 1, size, out);
+        bytes += size;
+    }
+    if(coding >= 0)
+        fprintf(stderr, "%d frames, %.0f bytes per frame\n", num, (double)bytes / num);
+    if(out != stdout)
+        fclose(out);
+    free(frames);
+    free(heads);
+    return 0;
+}
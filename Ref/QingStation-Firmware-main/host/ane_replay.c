@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_tracker.h"
+#include "anemometer_calib.h"
+#include "anemometer_stats.h"
+#include "anemometer_estimator.h"
+#include "anemometer_sched.h"
+#include "anemometer_diag.h"
+#include "anemometer_adapt.h"
+#include "hal_stub.h"
+#include "capture_file.h"
+
+// Replay recorded ADC captures through the anemometer DSP chain on PC.
+// Input is the binary frames written by record_raw() or dump_error_measurement(), or the csv of the old firmware,
+// see capture_file.h.
+// Output is one line per capture: frame, error code, ToF of each channel, wind.
+// The error histogram and the run time of each DSP stage are printed to stderr at the end.
+
+static const char *err_names[ERR_CODE_NUM] = {
+        "normal",
+        "mse_nan",
+        "shape_mismatch",
+        "misalign",
+        "windspeed"
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] capture.csv\n"
+            "  -c file   calibration captures taken in calm wind (default: use the first captures of the input)\n"
+            "  -t degC   air temperature, default 20\n"
+            "  -H m      height of reflection plate, default 0.05\n"
+            "  -P m      pitch between transducers, default 0.04\n"
+            "  -f type   band pass filter: 0=ba, 1=sos_f32, 2=sos_q31, 3=sos_q15, default 0\n"
+            "  -n order  order of the band pass filter, 1~2, default 2\n"
+            "  -w        disable the echo window tracking, always search the full window\n"
+            "  -g        disable the time of flight filter, a bad channel rejects the cycle\n"
+            "  -p ms     period between captures, for the wind statistics, default 1000\n"
+            "  -e type   time of flight estimator: 0=shapematch, 1=xcorr, default 0\n"
+            "  -x type   estimator to run in shadow and compare with, default none\n"
+            "  -k shots  coherent stacking, captures averaged in a cycle at most, default 1\n"
+            "  -i        interleaved measurement, the reciprocal pairs nested, E N S W\n"
+            "  -a        adapt the reference echo shape in the background, shape matching only\n"
+            "  -s file   save the calibration blob, as the firmware stores it\n"
+            "  -l file   load the calibration blob and validate it with the calibration captures, instead of calibrating\n"
+            "  -o file   per-capture output, default stdout\n", name);
+}
+
+static void print_prof(int cycles)
+{
+#ifdef ANE_DSP_PROFILE
+    uint64_t sum = 0;
+    fprintf(stderr, "\nstage        calls    avg(us)  max(us)\n");
+    for(int i=0; i<ANE_STAGE_NUM; i++)
+    {
+        uint32_t cnt = ane_dsp_prof.count[i];
+        sum += ane_dsp_prof.total[i];
+        fprintf(stderr, "%-12s %6u %9.2f %8.2f\n", ane_stage_names[i], cnt,
+                cnt ? ane_dsp_prof.total[i] / 1000.0 / cnt : 0, ane_dsp_prof.max[i] / 1000.0);
+    }
+    if(cycles)
+        fprintf(stderr, "per cycle    %6d %9.2f\n", cycles, sum / 1000.0 / cycles);
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    const char *calib_path = NULL, *out_path = NULL;
+    const char *save_path = NULL, *load_path = NULL;
+    float temperature = 20, height = 0.05f, pitch = 0.04f;
+    uint16_t (*frames)[4][ADC_SAMPLE_LEN] = NULL;
+    uint16_t (*calib_frames)[4][ADC_SAMPLE_LEN] = NULL;
+    int num, calib_num;
+    int filter_type = ANE_FILTER_BA, filter_order = 2;
+    int period = 1000;
+    int est_type = ANE_EST_SHAPEMATCH, shadow_type = ANE_EST_NONE;
+    int max_shots = 1;
+    bool is_tracking = true;
+    bool is_gating = true;
+    bool is_interleaved = false;
+    bool is_adapt = false;
+    int opt;
+
+    while((opt = getopt(argc, argv, "c:t:H:P:f:n:wgp:e:x:k:ias:l:o:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'c': calib_path = optarg; break;
+        case 't': temperature = atof(optarg); break;
+        case 'H': height = atof(optarg); break;
+        case 'P': pitch = atof(optarg); break;
+        case 'f': filter_type = atoi(optarg); break;
+        case 'n': filter_order = atoi(optarg); break;
+        case 'w': is_tracking = false; break;
+        case 'g': is_gating = false; break;
+        case 'p': period = atoi(optarg); break;
+        case 'e': est_type = atoi(optarg); break;
+        case 'x': shadow_type = atoi(optarg); break;
+        case 'k': max_shots = atoi(optarg); break;
+        case 'i': is_interleaved = true; break;
+        case 'a': is_adapt = true; break;
+        case 's': save_path = optarg; break;
+        case 'l': load_path = optarg; break;
+        case 'o': out_path = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if(optind >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    num = load_captures(argv[optind], &frames, NULL);
+    if(num <= 0)
+    {
+        fprintf(stderr, "no capture in %s\n", argv[optind]);
+        return 1;
+    }
+    if(calib_path)
+    {
+        calib_num = load_captures(calib_path, &calib_frames, NULL);
+        if(calib_num <= 0)
+        {
+            fprintf(stderr, "no capture in %s\n", calib_path);
+            return 1;
+        }
+    }
+    else
+    {
+        calib_frames = frames;
+        calib_num = num;
+    }
+
+    FILE *out = stdout;
+    if(out_path)
+    {
+        out = fopen(out_path, "w");
+        if(!out)
+        {
+            fprintf(stderr, "cannot open %s\n", out_path);
+            return 1;
+        }
+    }
+
+    static uint16_t adc_buffer[4][ADC_SAMPLE_LEN];
+    static float sig[ADC_SAMPLE_LEN];
+    static float sig2[ADC_SAMPLE_LEN];
+    static ane_calib_t calib;
+    float sig_level[4];
+    float distance[4];
+
+    ane_geometry_t geo;
+    ane_geometry_init(&geo, height, pitch);
+    if(ane_filter_init(&ane_bp_filter, filter_type, filter_order))
+    {
+        fprintf(stderr, "filter type %d order %d is not supported\n", filter_type, filter_order);
+        return 1;
+    }
+    fprintf(stderr, "band pass filter: %s, order %d\n", ane_filter_name(ane_bp_filter.type), ane_bp_filter.sections);
+
+    // calibration, same as the firmware does on boot.
+    hal_stub_source_t src = {.frames = calib_frames, .num = calib_num, .is_loop = true};
+    hal_stub_set_source(&src);
+    float est_c = speed_of_sound_from_T(temperature);
+    float T = ane_propagation_time(&geo, est_c);
+    if(load_path)
+    {
+        static ane_calib_blob_t blob;
+        FILE *f = fopen(load_path, "rb");
+        if(!f)
+        {
+            fprintf(stderr, "cannot open %s\n", load_path);
+            return 1;
+        }
+        size_t len = fread(&blob, 1, sizeof(blob), f);
+        fclose(f);
+        int err = len == sizeof(blob) ? ane_calib_check(&blob, &ane_bp_filter, &geo) : ANE_CALIB_ERR_FORMAT;
+        if(err != ANE_CALIB_OK)
+        {
+            fprintf(stderr, "calibration blob is invalid, error %d\n", err);
+            return 1;
+        }
+        memcpy(&calib, &blob.calib, sizeof(calib));
+        int pass = ane_calib_validate(&calib, &geo, est_c, adc_buffer, ANE_CALIB_CHECK_CYCLES);
+        fprintf(stderr, "calibration loaded, made at %.1f degC, %d/%d measurements passed\n",
+                blob.temperature, pass, ANE_CALIB_CHECK_CYCLES);
+        if(pass < ANE_CALIB_CHECK_PASS)
+        {
+            fprintf(stderr, "calibration does not match\n");
+            return 1;
+        }
+    }
+    else
+    {
+        int count = calibration2((float*)calib.static_zero_cross, (float*)calib.ref_shape, sig, sig2,
+                adc_buffer, distance, cpulse, pulse_len);
+        get_pulse_offset(calib.pulse_offset, calib.static_zero_cross, T);
+        fprintf(stderr, "calibration: %d measurements from %d captures, template channel %s\n",
+                count, calib_num, ane_ch_names[argmaxf(distance, 4)]);
+        if(count == 0)
+        {
+            fprintf(stderr, "calibration failed\n");
+            return 1;
+        }
+    }
+    fprintf(stderr, "propagation time: %.2fus, offset: %.2f, %.2f, %.2f, %.2f\n",
+            T, calib.pulse_offset[NORTH], calib.pulse_offset[EAST], calib.pulse_offset[SOUTH], calib.pulse_offset[WEST]);
+    if(save_path)
+    {
+        static ane_calib_blob_t blob;
+        ane_calib_pack(&blob, &calib, &ane_bp_filter, &geo, temperature);
+        FILE *f = fopen(save_path, "wb");
+        if(!f || fwrite(&blob, sizeof(blob), 1, f) != 1)
+        {
+            fprintf(stderr, "cannot save %s\n", save_path);
+            return 1;
+        }
+        fclose(f);
+    }
+
+    // estimators, referenced with the calibration captures.
+    static ane_est_ctx_t est_ctx, shadow_ctx;
+    ane_shadow_t shadow;
+    const ane_estimator_t *est = ane_est_get(est_type);
+    const ane_estimator_t *shadow_est = ane_est_get(shadow_type);
+    if(!est || ane_est_init(&est_ctx, est, &calib) || ane_est_reference(&est_ctx, est, adc_buffer))
+    {
+        fprintf(stderr, "estimator %d is not available\n", est_type);
+        return 1;
+    }
+    if(shadow_est && (ane_est_init(&shadow_ctx, shadow_est, &calib) || ane_est_reference(&shadow_ctx, shadow_est, adc_buffer)))
+    {
+        fprintf(stderr, "estimator %d is not available\n", shadow_type);
+        return 1;
+    }
+    ane_shadow_reset(&shadow);
+    fprintf(stderr, "estimator: %s, shadow: %s\n", est->name, shadow_est ? shadow_est->name : "none");
+
+    // replay
+#ifdef ANE_DSP_PROFILE
+    memset(&ane_dsp_prof, 0, sizeof(ane_dsp_prof));
+#endif
+    src.frames = frames;
+    src.num = num;
+    src.is_loop = false;
+    hal_stub_set_source(&src);
+
+    int hist[ERR_CODE_NUM] = {0};
+    float c_history = 0;
+    ane_baseline_t baseline[4] = {0};
+    ane_track_t track;
+    int win[4][2];
+    ane_track_reset(&track);
+    ane_tof_filter_t tof;
+    ane_tof_reset(&tof);
+    int num_anchor = 0;
+    double v_sum = 0, c_sum = 0;
+    ane_ch_result_t res[4];
+    ane_wind_t wind;
+    static ane_stats_t stats;
+    ane_stats_init(&stats, period);
+    ane_stack_t stack;
+    ane_stack_reset(&stack, max_shots);
+    int cycles = 0, used = 0, shots_sum = 0;
+    ane_sched_t sched;
+    ane_sched_reset(&sched);
+    ane_diag_t diag;
+    ane_diag_reset(&diag);
+    ane_adapt_t adapt;
+    ane_adapt_reset(&adapt, &calib);
+    is_adapt = is_adapt && est_type == ANE_EST_SHAPEMATCH;
+
+    fprintf(out, "frame,err,dt_n,dt_e,dt_s,dt_w,ns_v,ew_v,v,c,course\n");
+    for(int i=0; used + stack.shots <= num; i++)
+    {
+        float dt[4];
+        int err;
+        memset(&wind, 0, sizeof(wind));
+        ane_track_window(is_tracking ? &track : NULL, calib.pulse_offset, est_c, win);
+        // replayed captures have no timestamp, the interleaved measurement counts the captures instead.
+        if(is_interleaved)
+            num_anchor += ane_sched_measure(&sched, &ane_drv_src, adc_buffer, baseline, sig_level, stack.shots);
+        else
+            num_anchor += ane_measure_stack(adc_buffer, baseline, sig_level, stack.shots);
+        used += stack.shots;
+        shots_sum += stack.shots;
+        cycles++;
+
+        uint32_t t0 = ane_dsp_cycle_get();
+        err = est->process(&est_ctx, adc_buffer, sig_level, win, res);
+        float cost = (ane_dsp_cycle_get() - t0) / 1000.f;
+        ane_diag_cost(&diag, cost);
+        ane_diag_signal(&diag, adc_buffer, sig_level, win, res);
+        if(shadow_est)
+        {
+            ane_ch_result_t shadow_res[4];
+            t0 = ane_dsp_cycle_get();
+            shadow_est->process(&shadow_ctx, adc_buffer, sig_level, win, shadow_res);
+            ane_shadow_update(&shadow, res, shadow_res, cost, (ane_dsp_cycle_get() - t0) / 1000.f);
+        }
+        for(int ch=0; ch<4; ch++)
+            dt[ch] = res[ch].dt;
+        if(is_gating)
+        {
+            if(ane_tof_update(&tof, res, est_c, i * period, dt) < 0)
+                err = (err == NORMAL) ? ERR_MISALIGN : err;
+            else
+                err = NORMAL;
+        }
+        if(err == NORMAL)
+            err = ane_wind_from_dt(&geo, dt, T, &wind);
+        if(err == NORMAL)
+            err = ane_wind_check(&wind, &c_history, est_c);
+        ane_track_update(&track, dt, res, est_c, err == NORMAL);
+        ane_stack_update(&stack, res, err);
+        ane_diag_cycle(&diag, err, false);
+        if(is_adapt)
+        {
+            int event = ane_adapt_update(&adapt, &calib, est_ctx.shape, res, err, wind.v);
+            if(event == ANE_ADAPT_UPDATED)
+                fprintf(stderr, "frame %d: shape updated, mse %.5f -> %.5f\n", i, adapt.mse_ref, adapt.mse_cand);
+            else if(event == ANE_ADAPT_ROLLBACK)
+                fprintf(stderr, "frame %d: shape rolled back, %u cycles rejected in trial\n", i, adapt.trial_err);
+        }
+        if(err == NORMAL)
+        {
+            v_sum += wind.v;
+            c_sum += wind.c;
+            ane_stats_add(&stats, wind.ns_v, wind.ew_v);
+        }
+        hist[err]++;
+
+        fprintf(out, "%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.1f\n", i, err,
+                dt[NORTH], dt[EAST], dt[SOUTH], dt[WEST],
+                wind.ns_v, wind.ew_v, wind.v, wind.c, wind.course);
+    }
+    if(out != stdout)
+        fclose(out);
+
+    // summary
+    fprintf(stderr, "\n%d captures replayed in %d cycles, %.2f shots per cycle\n", used, cycles, (float)shots_sum / cycles);
+    for(int i=0; i<ERR_CODE_NUM; i++)
+        fprintf(stderr, "%-16s %6d %6.1f%%\n", err_names[i], hist[i], 100.0 * hist[i] / cycles);
+    if(hist[NORMAL])
+        fprintf(stderr, "mean wind speed %.3fm/s, mean sound speed %.2fm/s\n",
+                v_sum / hist[NORMAL], c_sum / hist[NORMAL]);
+    ane_stats_result_t r2, r10;
+    ane_stats_window_get(&stats.w2min, &r2);
+    ane_stats_window_get(&stats.w10min, &r10);
+    fprintf(stderr, "last 2min: %.3fm/s, %.1fdeg. last 10min: %.3fm/s, %.1fdeg, std %.1fdeg, 3s gust %.3fm/s\n",
+            r2.speed, r2.course, r10.speed, r10.course, r10.course_std, r10.peak);
+    fprintf(stderr, "cycles in tracking window %u, full window %u\n", track.win_search, track.full_search);
+    if(is_gating)
+        fprintf(stderr, "channels gated %u, cycles rejected by the tof filter %u, accepted as gusts %u\n",
+                tof.gated, tof.rejected, tof.gusts);
+    if(shadow_est)
+    {
+        fprintf(stderr, "shadow %s: %u cycles compared, %u missed, %u disagree, max diff %.2fus, rms %.2fus\n",
+                shadow_est->name, shadow.cycles, shadow.missed, shadow.disagree, shadow.max_diff, ane_shadow_rms(&shadow));
+        fprintf(stderr, "  mean diff %.2f, %.2f, %.2f, %.2f. cost %s %.1fus, %s %.1fus\n",
+                shadow.diff_mean[NORTH], shadow.diff_mean[EAST], shadow.diff_mean[SOUTH], shadow.diff_mean[WEST],
+                est->name, shadow.cost[0], shadow_est->name, shadow.cost[1]);
+    }
+    if(is_interleaved)
+        fprintf(stderr, "interleaved: pair skew to the common instant max %.2f captures\n", sched.skew_max);
+    fprintf(stderr, "pulse-less captures %d of %d channel measurements\n", num_anchor, cycles * 4);
+    if(is_adapt)
+        fprintf(stderr, "shape adaptation: %u updates, %u confirmed, %u rolled back\n",
+                adapt.updates, adapt.confirmed, adapt.rollbacks);
+    fprintf(stderr, "signal quality  snr(dB)  amp(LSB)     mse  peak_off\n");
+    for(int ch=0; ch<4; ch++)
+        fprintf(stderr, "  %-12s %7.1f %9.0f %7.4f %9d\n", ane_ch_names[ch], diag.snr[ch], diag.amp[ch], diag.mse[ch],
+                diag.peak_off[ch]);
+    fprintf(stderr, "processing p50 %uus, p90 %uus, p99 %uus, max %uus\n", ane_diag_percentile(&diag, 0.5f),
+            ane_diag_percentile(&diag, 0.9f), ane_diag_percentile(&diag, 0.99f), diag.cost_max);
+    print_prof(cycles);
+
+    if(calib_frames != frames)
+        free(calib_frames);
+    free(frames);
+    return 0;
+}
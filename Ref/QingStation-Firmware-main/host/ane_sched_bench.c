@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_filter.h"
+#include "anemometer_tracker.h"
+#include "anemometer_estimator.h"
+#include "anemometer_sched.h"
+#include "hal_stub.h"
+
+// Sequential vs interleaved measurement in gusty wind.
+// The captures are synthesized at the instant they are taken: the echo of the 40kHz transducers,
+// delayed by the time of flight of the wind at that instant, plus noise.
+// Each capture takes the settle time of the driver plus the capture itself, with some jitter.
+// The wind of a cycle is compared to the true wind at the instant the cycle stands for:
+// the average of the capture times for the sequential measurement, the common instant for the interleaved one.
+
+#define PI              (3.1415926f)
+#define RESP_LEN        (1025)
+#define ECHO_FREQ       (40000.f)
+#define ECHO_Q          (8.f)
+#define SAMPLE_RATE     (1000000.f)
+#define CAPTURE_US      (4000)      // 3ms settle + 1ms capture
+
+typedef struct _synth_t
+{
+    float resp[RESP_LEN];   // echo of the transducers, normalized
+    float height, pitch;
+    float c;
+    float v0, course;       // mean wind, m/s and deg
+    float gust, freq;       // gust amplitude m/s and frequency Hz
+    float noise;            // ADC LSB
+    uint32_t jitter;        // us
+    uint32_t now;           // us
+    uint32_t seed;
+} synth_t;
+
+static float randu(synth_t *s)
+{
+    s->seed = s->seed * 1103515245u + 12345u;
+    return ((s->seed >> 8) & 0xFFFFFF) / 16777216.f;
+}
+
+static float randn(synth_t *s)
+{
+    float u1 = randu(s) + 1e-7f, u2 = randu(s);
+    return sqrtf(-2 * logf(u1)) * cosf(2 * PI * u2);
+}
+
+// second order peak filter, same as scipy.signal.iirpeak()
+static void peak_filter(float *x, int len)
+{
+    float w0 = 2 * PI * ECHO_FREQ / SAMPLE_RATE;
+    float beta = tanf(w0 / ECHO_Q / 2);
+    float gain = 1 / (1 + beta);
+    float b0 = 1 - gain, a1 = -2 * gain * cosf(w0), a2 = 2 * gain - 1;
+    float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    for(int i=0; i<len; i++)
+    {
+        float y = b0 * (x[i] - x2) - a1 * y1 - a2 * y2;
+        x2 = x1; x1 = x[i];
+        y2 = y1; y1 = y;
+        x[i] = y;
+    }
+}
+
+// 6 cycles then 3 cycles inverted, through the transmitter and the receiver.
+static void synth_init(synth_t *s)
+{
+    float peak = 0;
+    memset(s->resp, 0, sizeof(s->resp));
+    for(int i=0; i<225; i++)
+    {
+        float v = sinf(2 * PI * ECHO_FREQ * i / SAMPLE_RATE);
+        s->resp[i] = (v > 0) - (v < 0);
+        if(i >= 150)
+            s->resp[i] = -s->resp[i];
+    }
+    peak_filter(s->resp, RESP_LEN);
+    peak_filter(s->resp, RESP_LEN);
+    for(int i=0; i<RESP_LEN; i++)
+        peak = fmaxf(peak, fabsf(s->resp[i]));
+    for(int i=0; i<RESP_LEN; i++)
+        s->resp[i] /= peak;
+}
+
+static void synth_wind(synth_t *s, uint32_t t_us, float *ns, float *ew)
+{
+    float t = t_us / 1000000.f;
+    float g = s->gust * sinf(2 * PI * s->freq * t);
+    *ns = (s->v0 + g) * cosf(s->course / 180 * PI);
+    *ew = (s->v0 + g) * sinf(s->course / 180 * PI);
+}
+
+static void synth_capture(synth_t *s, ULTRASONIC_CHANNEL ch, float ns, float ew, uint16_t *adc)
+{
+    float a = atanf(2 * s->height / s->pitch);
+    float L = 2 * s->height / sinf(a);
+    float v = (ch == NORTH || ch == SOUTH) ? ns : ew;
+    float sign = (ch == NORTH || ch == EAST) ? 1 : -1;
+    float delay = L / (s->c + sign * v * cosf(a)) * 1000000.f;
+    for(int i=0; i<ADC_SAMPLE_LEN; i++)
+    {
+        float x = 0, p = i - delay;
+        if(p >= 0 && p < RESP_LEN - 1)
+        {
+            int k = (int)p;
+            x = s->resp[k] + (p - k) * (s->resp[k+1] - s->resp[k]);
+        }
+        adc[i] = (uint16_t)(2048 + 600 * x + s->noise * randn(s));
+    }
+}
+
+static float synth_src_capture(void *user, ULTRASONIC_CHANNEL ch, uint16_t *adc, bool is_calibrate)
+{
+    synth_t *s = user;
+    float ns, ew, sum = 0;
+    s->now += CAPTURE_US + (s->jitter ? (uint32_t)(randu(s) * s->jitter) : 0);
+    synth_wind(s, s->now, &ns, &ew);
+    synth_capture(s, ch, ns, ew, adc);
+    for(int i=0; i<ADC_SAMPLE_LEN; i++)
+        sum += adc[i];
+    return sum / ADC_SAMPLE_LEN;
+}
+
+static uint32_t synth_src_timestamp(void *user)
+{
+    return ((synth_t*)user)->now;
+}
+
+typedef struct _bench_result_t
+{
+    int cycles;
+    int normal;
+    int captures;
+    double err_sq;      // of the wind vector, m/s
+    double err_max;
+    double cost;        // us, measurement and processing on PC
+} bench_result_t;
+
+static void run(synth_t *s, ane_geometry_t *geo, const ane_estimator_t *est, ane_est_ctx_t *ctx,
+        float pulse_offset[4], int cycles, uint32_t period_us, bool is_interleaved, bench_result_t *r)
+{
+    static const ULTRASONIC_CHANNEL order[4] = {NORTH, SOUTH, EAST, WEST};
+    static uint16_t adc[4][ADC_SAMPLE_LEN];
+    const ane_capture_src_t src = {
+            .capture = synth_src_capture,
+            .timestamp = synth_src_timestamp,
+            .user = s,
+    };
+    ane_baseline_t baseline[4] = {0};
+    ane_track_t track;
+    ane_sched_t sched;
+    ane_ch_result_t res[4];
+    float sig_level[4];
+    float c_history = 0;
+    float T = ane_propagation_time(geo, s->c);
+    int win[4][2];
+
+    ane_track_reset(&track);
+    ane_sched_reset(&sched);
+    memset(r, 0, sizeof(bench_result_t));
+    s->now = 0;
+    for(int i=0; i<cycles; i++)
+    {
+        uint32_t ts[4], t_ref;
+        float dt[4];
+        ane_wind_t wind;
+        int err;
+        uint32_t t0 = ane_dsp_cycle_get();
+
+        // the cycles are not in phase with the gust
+        s->now = i * period_us + (uint32_t)(randu(s) * period_us / 2);
+        ane_track_window(&track, pulse_offset, s->c, win);
+        if(is_interleaved)
+        {
+            ane_sched_measure(&sched, &src, adc, baseline, sig_level, 1);
+            t_ref = sched.t_ref;
+        }
+        else
+        {
+            ane_measure_src(&src, order, adc, baseline, sig_level, 1, ts);
+            t_ref = (ts[NORTH] + ts[EAST] + ts[SOUTH] + ts[WEST]) / 4;
+        }
+        err = est->process(ctx, adc, sig_level, win, res);
+        r->captures += 4;
+        // without the time of flight filter, it smooths the gust away.
+        for(int ch=0; ch<4; ch++)
+            dt[ch] = res[ch].dt;
+        if(err == NORMAL)
+            err = ane_wind_from_dt(geo, dt, T, &wind);
+        if(err == NORMAL)
+            err = ane_wind_check(&wind, &c_history, s->c);
+        ane_track_update(&track, dt, res, s->c, err == NORMAL);
+        r->cost += (ane_dsp_cycle_get() - t0) / 1000.0;
+        r->cycles++;
+        if(err != NORMAL)
+            continue;
+
+        float ns, ew;
+        synth_wind(s, t_ref, &ns, &ew);
+        double e = hypot(wind.ns_v - ns, wind.ew_v - ew);
+        r->normal++;
+        r->err_sq += e * e;
+        r->err_max = fmax(r->err_max, e);
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n cycles  cycles of each measurement, default 500\n"
+            "  -v m/s     mean wind speed, default 8\n"
+            "  -d deg     wind direction, default 30\n"
+            "  -g m/s     gust amplitude, default 6\n"
+            "  -f Hz      gust frequency, default 2\n"
+            "  -s lsb     noise of the ADC, default 3\n"
+            "  -j us      jitter of each capture, default 1000\n"
+            "  -p ms      period between cycles, default 250\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+    static synth_t s;
+    static uint16_t frames[8][4][HAL_STUB_CAPTURE_LEN];
+    static uint16_t adc_buffer[4][ADC_SAMPLE_LEN];
+    static float sig[ADC_SAMPLE_LEN], sig2[ADC_SAMPLE_LEN];
+    static ane_calib_t calib;
+    float distance[4];
+    int cycles = 500, period = 250;
+    int opt;
+
+    s.height = 0.05f;
+    s.pitch = 0.04f;
+    s.c = speed_of_sound_from_T(20);
+    s.v0 = 8;
+    s.course = 30;
+    s.gust = 6;
+    s.freq = 2;
+    s.noise = 3;
+    s.jitter = 1000;
+    s.seed = 1;
+    while((opt = getopt(argc, argv, "n:v:d:g:f:s:j:p:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'n': cycles = atoi(optarg); break;
+        case 'v': s.v0 = atof(optarg); break;
+        case 'd': s.course = atof(optarg); break;
+        case 'g': s.gust = atof(optarg); break;
+        case 'f': s.freq = atof(optarg); break;
+        case 's': s.noise = atof(optarg); break;
+        case 'j': s.jitter = atoi(optarg); break;
+        case 'p': period = atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    synth_init(&s);
+
+    ane_geometry_t geo;
+    ane_geometry_init(&geo, s.height, s.pitch);
+    ane_filter_init(&ane_bp_filter, ANE_FILTER_SOS_F32, 2);
+
+    // calibration in calm air, through the stub driver as the firmware does.
+    for(int i=0; i<8; i++)
+        for(int ch=0; ch<4; ch++)
+            synth_capture(&s, ch, 0, 0, frames[i][ch]);
+    hal_stub_source_t calm = {.frames = frames, .num = 8, .is_loop = true};
+    hal_stub_set_source(&calm);
+    int count = calibration2((float*)calib.static_zero_cross, (float*)calib.ref_shape, sig, sig2,
+            adc_buffer, distance, cpulse, pulse_len);
+    get_pulse_offset(calib.pulse_offset, calib.static_zero_cross, ane_propagation_time(&geo, s.c));
+    hal_stub_set_source(NULL);
+    if(count == 0)
+    {
+        fprintf(stderr, "calibration failed\n");
+        return 1;
+    }
+
+    static ane_est_ctx_t ctx;
+    const ane_estimator_t *est = ane_est_get(ANE_EST_SHAPEMATCH);
+    ane_est_init(&ctx, est, &calib);
+
+    printf("wind %.1fm/s %.0fdeg, gust %.1fm/s %.1fHz, noise %.1f, capture %dus + %uus jitter\n",
+            s.v0, s.course, s.gust, s.freq, s.noise, CAPTURE_US, s.jitter);
+    printf("%-12s %7s %8s %9s %9s %11s %10s\n", "", "cycles", "normal", "rms(m/s)", "max(m/s)", "cap/normal", "cost(us)");
+    for(int m=0; m<2; m++)
+    {
+        bench_result_t r;
+        s.seed = 2; // same noise for both
+        memset(ctx.mse_history, 0, sizeof(ctx.mse_history));
+        run(&s, &geo, est, &ctx, calib.pulse_offset, cycles, period * 1000, m == 1, &r);
+        printf("%-12s %7d %7.1f%% %9.3f %9.3f %11.2f %10.1f\n", m ? "interleaved" : "sequential",
+                r.cycles, 100.0 * r.normal / r.cycles, r.normal ? sqrt(r.err_sq / r.normal) : 0, r.err_max,
+                r.normal ? (double)r.captures / r.normal : 0, r.cost / r.cycles);
+    }
+    return 0;
+}
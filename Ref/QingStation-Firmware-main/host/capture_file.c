@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "capture_file.h"
+
+static int grow(uint16_t (**frames)[4][ADC_SAMPLE_LEN], ane_raw_header_t **heads, int *cap, int num)
+{
+    if(num < *cap)
+        return 0;
+    *cap = *cap ? *cap * 2 : 64;
+    *frames = realloc(*frames, sizeof(**frames) * *cap);
+    if(!*frames)
+        return -1;
+    if(heads)
+    {
+        *heads = realloc(*heads, sizeof(**heads) * *cap);
+        if(!*heads)
+            return -1;
+        memset(&(*heads)[num], 0, sizeof(**heads) * (*cap - num));
+    }
+    return 0;
+}
+
+static int load_csv(FILE *f, const char *path, uint16_t (**out)[4][ADC_SAMPLE_LEN], ane_raw_header_t **heads)
+{
+    char line[128];
+    uint16_t (*frames)[4][ADC_SAMPLE_LEN] = NULL;
+    int cap = 0, row = 0, n, s, e, w;
+
+    while(fgets(line, sizeof(line), f))
+    {
+        if(!isdigit((unsigned char)line[0])) // header or empty line
+            continue;
+        if(sscanf(line, "%d,%d,%d,%d", &n, &s, &e, &w) != 4)
+            continue;
+        int fi = row / ADC_SAMPLE_LEN;
+        int j = row % ADC_SAMPLE_LEN;
+        if(j == 0 && grow(&frames, heads, &cap, fi))
+            return -1;
+        frames[fi][NORTH][j] = n;
+        frames[fi][SOUTH][j] = s;
+        frames[fi][EAST][j] = e;
+        frames[fi][WEST][j] = w;
+        row++;
+    }
+    if(row % ADC_SAMPLE_LEN)
+        fprintf(stderr, "%s: %d rows of incomplete capture dropped\n", path, row % ADC_SAMPLE_LEN);
+    *out = frames;
+    return row / ADC_SAMPLE_LEN;
+}
+
+static int load_raw(FILE *f, const char *path, uint16_t (**out)[4][ADC_SAMPLE_LEN], ane_raw_header_t **heads)
+{
+    static uint8_t buf[ANE_RAW_FRAME_MAX];
+    uint16_t (*frames)[4][ADC_SAMPLE_LEN] = NULL;
+    ane_raw_header_t head;
+    int cap = 0, num = 0, bad = 0;
+
+    while(fread(&head, sizeof(head), 1, f) == 1)
+    {
+        if(head.magic != ANE_RAW_MAGIC || head.payload > ANE_RAW_FRAME_MAX - sizeof(head))
+        {
+            fprintf(stderr, "%s: frame %d is broken, the rest is dropped\n", path, num);
+            break;
+        }
+        memcpy(buf, &head, sizeof(head));
+        if(fread(buf + sizeof(head), 1, head.payload, f) != head.payload)
+        {
+            fprintf(stderr, "%s: frame %d is incomplete\n", path, num);
+            break;
+        }
+        if(grow(&frames, heads, &cap, num))
+            return -1;
+        if(ane_raw_decode(buf, sizeof(head) + head.payload, heads ? &(*heads)[num] : &head, frames[num]))
+        {
+            bad++;
+            continue;
+        }
+        num++;
+    }
+    if(bad)
+        fprintf(stderr, "%s: %d frames dropped, crc or format error\n", path, bad);
+    *out = frames;
+    return num;
+}
+
+int load_captures(const char *path, uint16_t (**frames)[4][ADC_SAMPLE_LEN], ane_raw_header_t **heads)
+{
+    uint32_t magic = 0;
+    int num;
+    FILE *f = fopen(path, "rb");
+    if(!f)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    if(heads)
+        *heads = NULL;
+    if(fread(&magic, sizeof(magic), 1, f) != 1)
+        magic = 0;
+    rewind(f);
+    if(magic == ANE_RAW_MAGIC)
+        num = load_raw(f, path, frames, heads);
+    else
+        num = load_csv(f, path, frames, heads);
+    fclose(f);
+    return num;
+}
+
+void write_capture_csv(FILE *f, uint16_t adc[][ADC_SAMPLE_LEN])
+{
+    for(int j=0; j<ADC_SAMPLE_LEN; j++)
+        fprintf(f, "%d,%d,%d,%d\n", adc[NORTH][j], adc[SOUTH][j], adc[EAST][j], adc[WEST][j]);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __CAPTURE_FILE_H__
+#define __CAPTURE_FILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "anemometer_dsp.h"
+#include "anemometer_raw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Captures on PC, from the csv of record_raw() of the old firmware, or the binary frames of anemometer_raw.h.
+// csv: 4 columns North,South,East,West, ADC_SAMPLE_LEN rows per capture, optional header line.
+// frames are indexed by the channel enum. heads is optional, only binary frames have it (zeros for csv).
+// return the number of capture loaded, -1 if failed.
+int load_captures(const char *path, uint16_t (**frames)[4][ADC_SAMPLE_LEN], ane_raw_header_t **heads);
+
+// a capture as the csv rows.
+void write_capture_csv(FILE *f, uint16_t adc[][ADC_SAMPLE_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPTURE_FILE_H__ */
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "data_format.h"
+
+// Number formatting of the data pool against printf.
+// The benchmark formats sensor-like values in each precision by both.
+// -x compares every float bit pattern (or every step-th) in each precision with printf("%.*f"),
+// and the integers with printf("%d") and printf("%u"), any difference is printed.
+
+#define BENCH_NUM   (200000)
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -x        exhaustive round-trip check instead of the benchmark\n"
+            "  -p prec   only this precision, default 0~%d\n"
+            "  -s step   check every step-th bit pattern, default 1\n"
+            "  -n num    values in the benchmark, default %d\n", name, 7, BENCH_NUM);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t rng_state = 1;
+static uint32_t rand_u32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int check(uint32_t step, int prec_min, int prec_max)
+{
+    char ref[400], out[FORMAT_FLOAT_LEN + 16];
+    uint64_t checked = 0, failed = 0;
+    uint64_t u = 0;
+    do {
+        union {float f; uint32_t u;} x = {.u = (uint32_t)u};
+        for(int p=prec_min; p<=prec_max; p++)
+        {
+            int len = format_float(out, x.f, p);
+            snprintf(ref, sizeof(ref), "%.*f", p, (double)x.f);
+            checked++;
+            if(strcmp(ref, out) != 0 || len != (int)strlen(out))
+            {
+                if(failed++ < 20)
+                    printf("0x%08x %%.%df: printf %s, format %s\n", x.u, p, ref, out);
+            }
+        }
+        format_int(out, (int32_t)x.u);
+        snprintf(ref, sizeof(ref), "%d", (int32_t)x.u);
+        if(strcmp(ref, out) != 0 && failed++ < 20)
+            printf("%%d: printf %s, format %s\n", ref, out);
+        format_uint(out, x.u);
+        snprintf(ref, sizeof(ref), "%u", x.u);
+        if(strcmp(ref, out) != 0 && failed++ < 20)
+            printf("%%u: printf %s, format %s\n", ref, out);
+        checked += 2;
+        if((u & 0x0FFFFFFF) < step)
+        {
+            fprintf(stderr, "\r0x%08x", (uint32_t)u);
+            fflush(stderr);
+        }
+        u += step;
+    } while(u <= UINT32_MAX);
+    fprintf(stderr, "\n");
+    printf("%llu checked, %llu different\n", (unsigned long long)checked, (unsigned long long)failed);
+    return failed ? 1 : 0;
+}
+
+static void bench(int num, int prec_min, int prec_max)
+{
+    float *values = malloc(sizeof(float) * num);
+    char buf[400];
+    volatile int sink = 0;
+    if(!values)
+        return;
+    // mostly the range of the sensors, some of any magnitude.
+    for(int i=0; i<num; i++)
+    {
+        if(i % 8)
+            values[i] = ((int32_t)rand_u32() / 2147483648.f) * 1000;
+        else
+        {
+            union {float f; uint32_t u;} x = {.u = rand_u32() & 0xBFFFFFFF}; // finite, below 2^65
+            values[i] = x.f;
+        }
+    }
+    printf("prec  printf(ns)  format(ns)  speedup\n");
+    for(int p=prec_min; p<=prec_max; p++)
+    {
+        double t0 = now_ns();
+        for(int i=0; i<num; i++)
+            sink += snprintf(buf, sizeof(buf), "%.*f", p, (double)values[i]);
+        double t1 = now_ns();
+        for(int i=0; i<num; i++)
+            sink += format_float(buf, values[i], p);
+        double t2 = now_ns();
+        printf("%4d %11.1f %11.1f %8.1fx\n", p, (t1 - t0) / num, (t2 - t1) / num, (t1 - t0) / (t2 - t1));
+    }
+    double t0 = now_ns();
+    for(int i=0; i<num; i++)
+        sink += snprintf(buf, sizeof(buf), "%d", (int32_t)rand_u32());
+    double t1 = now_ns();
+    for(int i=0; i<num; i++)
+        sink += format_int(buf, (int32_t)rand_u32());
+    double t2 = now_ns();
+    printf(" int %11.1f %11.1f %8.1fx\n", (t1 - t0) / num, (t2 - t1) / num, (t1 - t0) / (t2 - t1));
+    free(values);
+}
+
+int main(int argc, char* argv[])
+{
+    int prec_min = 0, prec_max = 7;
+    uint32_t step = 1;
+    int num = BENCH_NUM;
+    int is_check = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "xp:s:n:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'x': is_check = 1; break;
+        case 'p': prec_min = prec_max = atoi(optarg); break;
+        case 's': step = strtoul(optarg, NULL, 0); break;
+        case 'n': num = atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if(step == 0 || prec_min < 0 || prec_max > FORMAT_PREC_MAX || num <= 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if(is_check)
+        return check(step, prec_min, prec_max);
+    bench(num, prec_min, prec_max);
+    return 0;
+}
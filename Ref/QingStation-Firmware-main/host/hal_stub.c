@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_anemometer.h"
+#include "hal_stub.h"
+
+// Replacement of drv_anemometer.c on PC.
+// The "ADC" returns the captures of a replay source, one capture per channel.
+// A source frame holds all 4 channels, the next frame is loaded when a channel is requested twice.
+
+static hal_stub_source_t *source = NULL;
+static uint32_t served = 0;     // channels taken from the current frame, 1 bit per channel
+
+void hal_stub_set_source(hal_stub_source_t *src)
+{
+    source = src;
+    served = 0;
+    if(source)
+        source->cursor = 0;
+}
+
+static uint16_t *next_capture(ULTRASONIC_CHANNEL ch)
+{
+    if(!source || source->num == 0)
+        return NULL;
+    if(served & (1 << ch))
+    {
+        served = 0;
+        source->cursor++;
+        if(source->cursor >= source->num)
+            source->cursor = source->is_loop ? 0 : source->num - 1;
+    }
+    served |= 1 << ch;
+    return source->frames[source->cursor][ch];
+}
+
+void analog_power_request(bool flag)
+{
+    (void)flag;
+}
+
+void ane_drv_init(uint32_t freq, bool flag)
+{
+    (void)freq; (void)flag;
+}
+
+void ane_pwr_control(uint32_t freq, bool flag)
+{
+    (void)freq; (void)flag;
+}
+
+bool ane_check_busy()
+{
+    return false;
+}
+
+// same behaviour as the driver: the returned signal level is the average of the capture.
+// recorded data do not have the pulse-less capture, so the pulsed capture is used instead.
+float ane_measure_ch(ULTRASONIC_CHANNEL ch, const uint16_t *pulse, const uint16_t pulse_len,
+        uint16_t* adc_buf, uint32_t adc_len, bool is_calibrate)
+{
+    float sig_level = 0;
+    uint16_t *cap;
+    (void)pulse; (void)pulse_len;
+
+    cap = next_capture(ch);
+    if(cap)
+        memcpy(adc_buf, cap, sizeof(uint16_t) * MIN(adc_len, HAL_STUB_CAPTURE_LEN));
+    else
+        memset(adc_buf, 0, sizeof(uint16_t) * adc_len);
+
+    if(is_calibrate)
+    {
+        for(int i=0; i<adc_len; i++)
+            sig_level += adc_buf[i];
+        sig_level /= adc_len;
+    }
+    return sig_level;
+}
+
+int adc_sample(ULTRASONIC_CHANNEL ch, uint16_t* adc_buf, uint32_t adc_len)
+{
+    uint16_t pulse[1]={0};
+    ane_measure_ch(ch, pulse, 1, adc_buf, adc_len, false);
+    return 0;
+}
+
+// the cycle counter for profiling, in ns on PC.
+uint32_t ane_dsp_cycle_get(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __HAL_STUB_H__
+#define __HAL_STUB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// same as ADC_SAMPLE_LEN
+#define HAL_STUB_CAPTURE_LEN (1000)
+
+// captures that the stub driver will return.
+// frames are indexed by the channel enum (NORTH, EAST, SOUTH, WEST)
+typedef struct _hal_stub_source_t
+{
+    uint16_t (*frames)[4][HAL_STUB_CAPTURE_LEN];
+    uint32_t num;
+    uint32_t cursor;
+    bool is_loop;       // restart from the first frame when it reach the end
+} hal_stub_source_t;
+
+void hal_stub_set_source(hal_stub_source_t *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HAL_STUB_H__ */
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "data_format.h"
+#include "record_bin.h"
+
+// Binary records (.qrec) to csv, the same as thread_record() writes them.
+// With -e, the other way: a record csv to a binary record, to compare the sizes.
+
+#define LINE_SIZE   (4096)
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] file\n"
+            "  -i        print the columns and each block to stderr\n"
+            "  -u        the time as UTC seconds with us, instead of YYYYMMDDhhmmss\n"
+            "  -e        encode a record csv to a binary record\n"
+            "  -p ms     period of the rows when encoding, default 1000\n"
+            "  -a ms     a block is written at this age when encoding, as the recorder reopens, default 2000, 0 = when full\n"
+            "  -o file   output, default stdout\n", name);
+}
+
+static uint8_t* load_file(const char *path, long *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    if(!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(*len + 1);
+    if(buf && fread(buf, 1, *len, f) != *len)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+static const char *type_names[] = {"float", "int", "uint", "bool"};
+
+static int decode(const uint8_t *buf, long len, FILE *out, bool is_info, bool is_us)
+{
+    static record_bin_reader_t r;
+    static char line[LINE_SIZE];
+    long pos, skipped = 0;
+    int blocks = 0, bad = 0;
+    uint64_t rows = 0;
+
+    int size = record_bin_open(&r, buf, len);
+    if(size < 0)
+    {
+        fprintf(stderr, "not a record, %s\n", size == -2 ? "crc error" : "no header");
+        return 1;
+    }
+    if(is_info)
+    {
+        fprintf(stderr, "%u columns, period %u ms\n", r.num, r.period);
+        for(uint32_t i=0; i<r.num; i++)
+            fprintf(stderr, "  %-14s %-5s %d\n", r.fields[i].name, type_names[r.fields[i].type & 3], r.fields[i].precision);
+    }
+
+    fprintf(out, "timestamp");
+    for(uint32_t i=0; i<r.num; i++)
+        fprintf(out, ",%s", r.fields[i].name);
+    fprintf(out, "\n");
+
+    // blocks one after another, a damaged one is skipped to the next sync word.
+    pos = size;
+    while(pos < len)
+    {
+        size = record_bin_read_block(&r, &buf[pos], len - pos);
+        if(size < 0)
+        {
+            if(size == -2)
+                bad++;
+            pos++;
+            skipped++;
+            continue;
+        }
+        if(is_info)
+        {
+            time_t t = r.utc_us / 1000000;
+            char str[32];
+            strftime(str, sizeof(str), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+            fprintf(stderr, "block %d at %ld: %s, %u rows, %d bytes\n", blocks, pos, str, r.rows, size);
+        }
+        while(record_bin_read_row(&r))
+        {
+            int index = 0;
+            time_t sec = r.utc_us / 1000000;
+            if(is_us)
+                index += snprintf(line, LINE_SIZE, "%lld.%06lld", (long long)sec, (long long)(r.utc_us % 1000000));
+            else
+            {
+                struct tm tm;
+                index += strftime(line, LINE_SIZE, "%Y%m%d%H%M%S", gmtime_r(&sec, &tm));
+            }
+            for(uint32_t i=0; i<r.num && index < LINE_SIZE - FORMAT_FLOAT_LEN - 2; i++)
+            {
+                line[index++] = ',';
+                index += record_bin_print(&r, i, &line[index]);
+            }
+            line[index++] = '\n';
+            fwrite(line, 1, index, out);
+            rows++;
+        }
+        blocks++;
+        pos += size;
+    }
+    if(is_info || skipped)
+        fprintf(stderr, "%d blocks, %llu rows, %d crc errors, %ld bytes skipped\n",
+                blocks, (unsigned long long)rows, bad, skipped);
+    return 0;
+}
+
+// a record csv, the type and the decimals of each column from all its values.
+static int encode(char *csv, FILE *out, uint32_t period, uint32_t age)
+{
+    static record_bin_field_t fields[RECORD_BIN_FIELD_MAX];
+    static record_bin_t b;
+    static uint32_t value[RECORD_BIN_FIELD_MAX];
+    const uint8_t *data;
+    uint32_t num = 0, size;
+    uint64_t bytes = 0, text = 0, rows = 0;
+    int64_t block_utc = 0;
+    char *save, *body, *tok;
+
+    body = strchr(csv, '\n');
+    if(!body)
+        return 1;
+    *body++ = 0;
+    text += strlen(csv) + 1;
+    // the first column is the time.
+    strtok_r(csv, ",\r", &save);
+    while((tok = strtok_r(NULL, ",\r", &save)) && num < RECORD_BIN_FIELD_MAX)
+    {
+        strncpy(fields[num].name, tok, RECORD_BIN_NAME_LEN - 1);
+        fields[num].type = RECORD_BIN_BOOL;
+        fields[num].precision = 0;
+        num++;
+    }
+    // the widest type of the values.
+    for(char *p = body; *p; )
+    {
+        char *end = strchr(p, '\n');
+        uint32_t i = 0;
+        char *s = strchr(p, ',');
+        while(s && (!end || s < end) && i < num)
+        {
+            char *v = s + 1;
+            char *dot = NULL;
+            s = strchr(v, ',');
+            char *stop = s && (!end || s < end) ? s : (end ? end : v + strlen(v));
+            for(char *c = v; c < stop; c++)
+                if(*c == '.')
+                    dot = c;
+            if(dot)
+            {
+                fields[i].type = RECORD_BIN_FLOAT;
+                if(stop - dot - 1 > fields[i].precision)
+                    fields[i].precision = stop - dot - 1;
+            }
+            else if(fields[i].type != RECORD_BIN_FLOAT && *v != 't' && *v != 'f')
+            {
+                if(*v == '-')
+                    fields[i].type = RECORD_BIN_INT;
+                else if(fields[i].type == RECORD_BIN_BOOL)
+                    fields[i].type = RECORD_BIN_UINT;
+            }
+            i++;
+        }
+        if(!end)
+            break;
+        p = end + 1;
+    }
+
+    record_bin_init(&b, fields, num, period);
+    size = record_bin_header(&b, &data);
+    fwrite(data, 1, size, out);
+    bytes += size;
+    while((tok = strtok_r(body, "\n", &save)))
+    {
+        char *vsave, *v;
+        struct tm tm = {0};
+        body = NULL;
+        text += strlen(tok) + 1;
+        v = strtok_r(tok, ",\r", &vsave);
+        if(!v || sscanf(v, "%4d%2d%2d%2d%2d%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+            continue;
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        for(uint32_t i=0; i<num; i++)
+        {
+            v = strtok_r(NULL, ",\r", &vsave);
+            value[i] = 0;
+            if(!v)
+                continue;
+            switch(fields[i].type)
+            {
+            case RECORD_BIN_FLOAT:
+            {
+                union {uint32_t u; float f;} x = {.f = strtof(v, NULL)};
+                value[i] = x.u;
+                break;
+            }
+            case RECORD_BIN_INT: value[i] = strtol(v, NULL, 10); break;
+            case RECORD_BIN_UINT: value[i] = strtoul(v, NULL, 10); break;
+            default: value[i] = *v == 't'; break;
+            }
+        }
+        int64_t utc = (int64_t)timegm(&tm) * 1000000;
+        if(!record_bin_add(&b, utc, value))
+        {
+            size = record_bin_block(&b, &data);
+            fwrite(data, 1, size, out);
+            bytes += size;
+            record_bin_add(&b, utc, value);
+            block_utc = utc;
+        }
+        if(b.rows == 1)
+            block_utc = utc;
+        // the same partial blocks as thread_record().
+        if(age && utc - block_utc >= (int64_t)age * 1000)
+        {
+            size = record_bin_block(&b, &data);
+            fwrite(data, 1, size, out);
+            bytes += size;
+        }
+        rows++;
+    }
+    size = record_bin_block(&b, &data);
+    fwrite(data, 1, size, out);
+    bytes += size;
+    fprintf(stderr, "%llu rows, %u columns, csv %llu bytes, binary %llu bytes, %.1f times smaller\n",
+            (unsigned long long)rows, num, (unsigned long long)text, (unsigned long long)bytes,
+            bytes ? (double)text / bytes : 0);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char *out_path = NULL;
+    bool is_info = false, is_us = false, is_encode = false;
+    uint32_t period = 1000, age = 2000;
+    int opt, ret;
+    long len;
+
+    while((opt = getopt(argc, argv, "iuep:a:o:h")) != -1)
+    {
+        switch(opt)
+        {
+        case 'i': is_info = true; break;
+        case 'u': is_us = true; break;
+        case 'e': is_encode = true; break;
+        case 'p': period = atoi(optarg); break;
+        case 'a': age = atoi(optarg); break;
+        case 'o': out_path = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if(optind >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t *buf = load_file(argv[optind], &len);
+    if(!buf)
+    {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 1;
+    }
+    FILE *out = stdout;
+    if(out_path)
+    {
+        out = fopen(out_path, is_encode ? "wb" : "w");
+        if(!out)
+        {
+            fprintf(stderr, "cannot open %s\n", out_path);
+            free(buf);
+            return 1;
+        }
+    }
+
+    if(is_encode)
+    {
+        buf[len] = 0;
+        ret = encode((char *)buf, out, period, age);
+    }
+    else
+        ret = decode(buf, len, out, is_info, is_us);
+
+    if(out != stdout)
+        fclose(out);
+    free(buf);
+    return ret;
+}
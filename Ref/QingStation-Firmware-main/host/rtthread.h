@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#ifndef __RTTHREAD_STUB_H__
+#define __RTTHREAD_STUB_H__
+
+#include <assert.h>
+
+// The few RT-Thread calls of data_pool.c, to run it on PC. A single thread, no scheduler.
+
+#define RT_ASSERT(x)            assert(x)
+#define INIT_ENV_EXPORT(f)
+
+static inline void rt_enter_critical(void) {}
+static inline void rt_exit_critical(void) {}
+static inline void rt_thread_delay(int tick) { (void)tick; }
+static inline int rt_thread_yield(void) { return 0; }
+
+#endif /* __RTTHREAD_STUB_H__ */
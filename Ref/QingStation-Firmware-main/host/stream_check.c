@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "data_pool.h"
+
+// Checks of the sample streams of the data pool.
+// The producer is a sensor thread or an interrupt, on a single core it is preempted by the reader
+// in the middle of a sample, or it preempts the reader in the middle of a copy.
+// The first is done by hand here, the second by a timer signal.
+
+typedef struct _check_t
+{
+    sensor_info_t info;
+    uint32_t n;
+    uint32_t copy[7];           // all n, a sample cut by a write has a different one
+} check_t;
+
+static check_t inst;
+static volatile uint32_t written;
+static int errors;
+
+static void produce(void)
+{
+    data_begin_write(&inst.info);
+    inst.n = ++written;
+    for(int i=0; i<7; i++)
+        inst.copy[i] = inst.n;
+    data_updated_at(&inst.info, inst.n);
+}
+
+// the samples read are whole and in order, from first. return the next n expected.
+static uint32_t verify(data_stream_t *s, const void *out, int num, uint32_t first)
+{
+    uint32_t next = first;
+    for(int i=0; i<num; i++)
+    {
+        const check_t *c = data_stream_sample(s, out, i);
+        int bad = 0;
+        for(int k=0; k<7; k++)
+            bad |= c->copy[k] != c->n;
+        if(bad || c->n < next || (i == 0 && c->n != first) || data_stream_us(s, out, i) != c->n)
+        {
+            printf("sample %u is broken or out of order, %u expected\n", c->n, next);
+            errors++;
+        }
+        next = c->n + 1;
+    }
+    return next;
+}
+
+// the producer is preempted after a part of a sample, in the slot of the oldest one.
+static void check_mid_write(void)
+{
+    static uint8_t out[DATA_STREAM_LEN * sizeof(check_t) + 8];
+    data_stream_reader_t rd;
+    data_stream_t *s = inst.info.stream;
+    int e = errors;
+
+    for(uint32_t cut = 1; cut < s->size; cut += 5)
+    {
+        data_stream_reader_init(s, &rd);
+        for(uint32_t i=0; i<s->len; i++)
+            produce();
+        uint8_t *slot = s->buf + (s->head & (s->len - 1)) * s->slot;
+        memset(slot, 0xA5, cut);
+
+        // the n of the sample at head is head+1.
+        int num = data_stream_read(s, &rd, out, DATA_STREAM_LEN);
+        if(num != s->len - 1 || rd.lost != 1)
+        {
+            printf("mid-write, cut %u: %d read, %u lost, %u and 1 expected\n", cut, num, rd.lost, s->len - 1);
+            errors++;
+        }
+        verify(s, out, num, s->head - s->len + 2);
+        // finish the write.
+        produce();
+    }
+    printf("mid-write: %s\n", errors > e ? "failed" : "ok");
+}
+
+static void on_timer(int sig)
+{
+    (void)sig;
+    for(int i=0; i<5; i++)
+        produce();
+}
+
+// the producer writes while the reader copies.
+static void check_preempt(void)
+{
+    static uint8_t out[DATA_STREAM_LEN * sizeof(check_t) + 8];
+    struct itimerval t = {{0, 50}, {0, 50}};
+    data_stream_reader_t rd;
+    data_stream_t *s = inst.info.stream;
+    uint32_t start = written, next = written + 1, total = 0;
+    int e = errors;
+
+    data_stream_reader_init(s, &rd);
+    signal(SIGALRM, on_timer);
+    setitimer(ITIMER_REAL, &t, NULL);
+    while(written - start < 1000000)
+    {
+        int num = data_stream_read(s, &rd, out, 1 + rand() % DATA_STREAM_LEN);
+        if(num && ((check_t *)out)->n < next)
+        {
+            printf("sample %u read again, %u expected\n", ((check_t *)out)->n, next);
+            errors++;
+        }
+        if(num)
+            next = verify(s, out, num, ((check_t *)out)->n);
+        total += num;
+    }
+    memset(&t, 0, sizeof(t));
+    setitimer(ITIMER_REAL, &t, NULL);
+    total += data_stream_read(s, &rd, out, DATA_STREAM_LEN);
+    // every sample is read or counted as lost.
+    if(total + rd.lost != written - start)
+    {
+        printf("preempted: %u read and %u lost of %u\n", total, rd.lost, written - start);
+        errors++;
+    }
+    printf("preempted: %u read, %u lost, %s\n", total, rd.lost, errors > e ? "failed" : "ok");
+}
+
+int main(void)
+{
+    if(!data_stream_open(&inst.info, sizeof(inst), DATA_STREAM_LEN))
+        return 1;
+    check_mid_write();
+    check_preempt();
+    return errors ? 1 : 0;
+}
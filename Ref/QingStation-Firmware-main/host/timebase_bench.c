@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "timebase.h"
+
+// The timebase on PC.
+// - the cost and the resolution of timebase_us(), and that it never goes back.
+// - the resolution of the former float ms timestamp over the uptime, against 1us.
+// - the date conversion against timegm(), the formatting against printf.
+// - the choice of the time sources.
+
+#define READ_NUM    (2000000)
+
+static uint32_t rng_state = 1;
+static uint32_t rand_u32(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int clock_check(void)
+{
+    uint64_t first = timebase_us();
+    uint64_t last = first, step_min = UINT64_MAX;
+    int back = 0;
+    for(int i=0; i<READ_NUM; i++)
+    {
+        uint64_t now = timebase_us();
+        if(now < last)
+            back++;
+        else if(now > last && now - last < step_min)
+            step_min = now - last;
+        last = now;
+    }
+    printf("timebase_us: %.1f ns a read, step %llu us, %d times back\n",
+            (last - first) * 1000.0 / READ_NUM, (unsigned long long)step_min, back);
+    return back ? 1 : 0;
+}
+
+static void float_resolution(void)
+{
+    const float hours[] = {1, 4.66f, 24, 24 * 7, 24 * 49};
+    printf("uptime(h)  float ms step(ms)  rate error at 10Hz\n");
+    for(int i=0; i<sizeof(hours)/sizeof(hours[0]); i++)
+    {
+        float t = hours[i] * 3600 * 1000;
+        float step = nextafterf(t, INFINITY) - t;
+        printf("%9.2f %18.3f %18.1f%%\n", hours[i], step, step / 100 * 100);
+    }
+}
+
+static int date_check(void)
+{
+    int failed = 0;
+    char buf[TIMEBASE_FORMAT_LEN], ref[64];
+    for(int i=0; i<1000000; i++)
+    {
+        time_t t = rand_u32() % 4102444800u;   // to 2100
+        int us = rand_u32() % 1000000;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        int64_t utc = timebase_make_utc(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                tm.tm_hour, tm.tm_min, tm.tm_sec, us);
+        if(utc != (int64_t)timegm(&tm) * 1000000 + us && failed++ < 10)
+            printf("%04d-%02d-%02d: %lld\n", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, (long long)utc);
+        timebase_format(buf, utc);
+        snprintf(ref, sizeof(ref), "%lld.%06d", (long long)t, us);
+        if(strcmp(buf, ref) != 0 && failed++ < 10)
+            printf("format %s, printf %s\n", buf, ref);
+    }
+    printf("dates: %d different\n", failed);
+    return failed ? 1 : 0;
+}
+
+extern uint64_t timebase_stub_skip;
+
+static int source_check(void)
+{
+    int failed = 0;
+    uint64_t mono = timebase_us();
+    // the RTC before any source.
+    int64_t rtc = timebase_utc_us(mono) / 1000000;
+    failed += timebase_source() != TIMEBASE_SRC_RTC || llabs(rtc - time(NULL)) > 1;
+    // a better source is taken, a worse one is not until the better one expires.
+    timebase_sync(1000000000, mono + 1000, TIMEBASE_SRC_NTP);
+    timebase_sync(2000000000, mono + 2000, TIMEBASE_SRC_GNSS);
+    timebase_sync(3000000000, mono + 3000, TIMEBASE_SRC_NTP);
+    failed += timebase_source() != TIMEBASE_SRC_GNSS || timebase_utc_us(mono + 2000) != 2000000000;
+    timebase_sync(3000000000, mono + 2000 + TIMEBASE_SYNC_EXPIRE, TIMEBASE_SRC_NTP);
+    failed += timebase_source() != TIMEBASE_SRC_NTP || timebase_utc_us(mono + 2000 + TIMEBASE_SYNC_EXPIRE + 5) != 3000000005;
+    // no source for another TIMEBASE_SYNC_EXPIRE, back to the RTC.
+    timebase_stub_skip += 2000 + 2 * TIMEBASE_SYNC_EXPIRE;
+    rtc = timebase_utc_us(timebase_us()) / 1000000;
+    failed += timebase_source() != TIMEBASE_SRC_RTC || llabs(rtc - time(NULL)) > 1;
+    printf("sources: %s\n", failed ? "failed" : "ok");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int failed = 0;
+    failed += clock_check();
+    float_resolution();
+    failed += date_check();
+    failed += source_check();
+    return failed ? 1 : 0;
+}
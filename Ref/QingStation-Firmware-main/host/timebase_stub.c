@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2020-2021, Jianjia Ma
+ * majianjia@live.com
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author           Notes
+ * 2026-10-16     Jianjia Ma       the first version
+ */
+#include <stdint.h>
+#include <time.h>
+
+#include "timebase.h"
+
+// Replacement of drv_timebase.c on PC, the monotonic clock since the first call.
+
+uint64_t timebase_stub_skip = 0;    // us, the benches move the clock forward by it.
+
+uint64_t timebase_us(void)
+{
+    static uint64_t start = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    if(start == 0)
+        start = ns;
+    return (ns - start) / 1000 + timebase_stub_skip;
+}
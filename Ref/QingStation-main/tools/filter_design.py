@@ -1,4 +1,6 @@
-from scipy.signal import butter, lfilter
+import sys
+import numpy as np
+from scipy.signal import butter, lfilter, sosfreqz
 
 
 def butter_bandpass(lowcut, highcut, fs, order=5):
@@ -9,14 +11,44 @@ def butter_bandpass(lowcut, highcut, fs, order=5):
     return b, a
 
 
+def butter_bandpass_sos(lowcut, highcut, fs, order=5):
+    nyq = 0.5 * fs
+    sos = butter(order, [lowcut / nyq, highcut / nyq], btype='band', output='sos')
+    # scale each section to unity gain at the centre frequency, so the signal level stays the same
+    # between sections. This is needed by the fixed-point filters.
+    f0 = np.sqrt(lowcut * highcut)
+    for s in sos:
+        _, h = sosfreqz(s.reshape(1, 6), worN=[f0], fs=fs)
+        s[:3] /= abs(h[0])
+    return sos
+
+
+# print in the format of the anemometer_filter.c: {{b0,b1,b2,a1,a2}, ...}
+def export_sos(name, sos):
+    line = '#define {0} {{'.format(name)
+    for i, s in enumerate(sos):
+        line += "{{{0:.9g},{1:.9g},{2:.9g},{3:.9g},{4:.9g}}}".format(s[0], s[1], s[2], s[4], s[5])
+        if(i < len(sos)-1):
+            line += ','
+    line += '}'
+    print(line)
+
+
 def butter_bandpass_filter(data, lowcut, highcut, fs, order=5):
     b, a = butter_bandpass(lowcut, highcut, fs, order=order)
     y = lfilter(b, a, data)
     return y
 
 # ref: https://stackoverflow.com/questions/12093594/how-to-implement-band-pass-butterworth-filter-with-scipy-signal-butter
-if __name__ == "__main__":
-    import numpy as np
+if __name__ == "__main__" and len(sys.argv) > 1 and sys.argv[1] == 'sos':
+    # coefficient tables of the second-order-section filters used by the firmware.
+    fs = 1000000.0
+    for bw in [2, 10]:
+        for order in [1, 2, 3]:
+            sos = butter_bandpass_sos(40000.0 - bw*500, 40000.0 + bw*500, fs, order=order)
+            export_sos('SOS_40K_{0}K_BP_{1}ORDER'.format(bw, order), sos)
+
+elif __name__ == "__main__":
     import matplotlib.pyplot as plt
     from scipy.signal import freqz
 